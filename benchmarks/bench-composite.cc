@@ -0,0 +1,152 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/7.
+//
+
+// composite command execution
+
+#include "bench.hh"
+
+#include <algorithm>
+#include <functional>
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::list_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool groups = true;
+};
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Composite = undo_cxx::composite_cmd_t<State>;
+  using Cmd = dp::undo::bench::ValueCmd<State>;
+
+  M::CmdSP make_composite(std::int64_t children) {
+    auto c = std::make_shared<Composite>();
+    for (std::int64_t i = 0; i < children; i++)
+      c->add_command(std::make_shared<Cmd>((int) i));
+    return c;
+  }
+
+  // invoke a composite of state.range(0) children: execute them all,
+  // and save a composite memento.
+  void BM_composite_invoke(benchmark::State &state) {
+    M mgr;
+    mgr.max_size(1024);
+    auto cmd = make_composite(state.range(0));
+    for (auto _ : state)
+      mgr.invoke(cmd);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // the baseline: the same children invoked one by one
+  void BM_flat_invoke(benchmark::State &state) {
+    M mgr;
+    mgr.max_size(1024);
+    std::vector<M::CmdSP> cmds;
+    for (std::int64_t i = 0; i < state.range(0); i++)
+      cmds.push_back(std::make_shared<Cmd>((int) i));
+    for (auto _ : state) {
+      for (auto &cmd : cmds)
+        mgr.invoke(cmd);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // undo+redo a composite memento through the command
+  void BM_composite_undo_redo(benchmark::State &state) {
+    M mgr;
+    auto cmd = make_composite(state.range(0));
+    mgr.invoke(cmd);
+    auto &memento = *mgr.newest_item();
+    M::ContextT ctx{mgr};
+    for (auto _ : state) {
+      cmd->undo(cmd, ctx, memento);
+      cmd->redo(cmd, ctx, memento);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+  }
+
+  // a batch of range(0) commands as one entry: a composite built by
+  // hand, then invoked
+  void BM_batch_composite(benchmark::State &state) {
+    M mgr;
+    mgr.max_size(16);
+    for (auto _ : state) {
+      auto cmd = make_composite(state.range(0));
+      mgr.invoke(cmd);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  // the same batch invoked in a group
+  void BM_batch_group(benchmark::State &state) {
+    M mgr;
+    mgr.max_size(16);
+    for (auto _ : state) {
+      auto tx = mgr.begin_group("batch");
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<Cmd>((int) i);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // range(0) children in composites of 100, nested in one; closed if range(1)
+  M::CmdSP make_nested(std::int64_t children, bool closed) {
+    auto c = std::make_shared<Composite>();
+    for (std::int64_t i = 0; i < children; i += 100)
+      c->add_command(make_composite(std::min<std::int64_t>(100, children - i)));
+    if (closed)
+      c->close();
+    return c;
+  }
+
+  // the composite memento of a nested or flattened composite, the
+  // same pairs either way
+  void BM_nested_invoke(benchmark::State &state) {
+    M mgr;
+    mgr.max_size(16);
+    auto cmd = make_nested(state.range(0), state.range(1) != 0);
+    for (auto _ : state)
+      mgr.invoke(cmd);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // a scan over the leaves: recursive when nested, linear once closed
+  void BM_nested_scan(benchmark::State &state) {
+    auto closed = state.range(1) != 0;
+    auto cmd = make_nested(state.range(0), closed);
+    auto &c = static_cast<Composite &>(*cmd);
+    for (auto _ : state) {
+      std::size_t n = 0;
+      std::function<void(M::CmdSP &)> visit = [&](M::CmdSP &child) {
+        if (auto *nested = dynamic_cast<Composite *>(child.get()))
+          nested->for_each(visit);
+        else
+          n += child.use_count();
+      };
+      if (closed)
+        c.for_each([&n](M::CmdSP &child) { n += child.use_count(); });
+      else
+        c.for_each(visit);
+      benchmark::DoNotOptimize(n);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+} // namespace
+
+BENCHMARK(BM_composite_invoke)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK(BM_flat_invoke)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK(BM_composite_undo_redo)->RangeMultiplier(10)->Range(1, 1000);
+BENCHMARK(BM_batch_composite)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK(BM_batch_group)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK(BM_nested_invoke)->Args({100000, 0})->Args({100000, 1})->ArgNames({"children", "closed"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_nested_scan)->Args({100000, 0})->Args({100000, 1})->ArgNames({"children", "closed"})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
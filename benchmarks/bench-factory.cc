@@ -0,0 +1,132 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/7.
+//
+
+// factory create() by id
+
+#include "undo_cxx.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <tuple>
+
+namespace {
+  namespace fct = undo_cxx::util::factory;
+
+  struct product {
+    virtual ~product() {}
+    virtual int run() const = 0;
+  };
+
+  // id_name<T>() drops the template arguments, so the products must
+  // be distinct classes rather than the instances of a template.
+#define BENCH_PRODUCT(n) \
+  struct product_##n : public product { \
+    int run() const override { return 0; } \
+  };
+#define BENCH_PRODUCTS_16(x) \
+  BENCH_PRODUCT(x##0)        \
+  BENCH_PRODUCT(x##1)        \
+  BENCH_PRODUCT(x##2)        \
+  BENCH_PRODUCT(x##3)        \
+  BENCH_PRODUCT(x##4)        \
+  BENCH_PRODUCT(x##5)        \
+  BENCH_PRODUCT(x##6)        \
+  BENCH_PRODUCT(x##7)        \
+  BENCH_PRODUCT(x##8)        \
+  BENCH_PRODUCT(x##9)        \
+  BENCH_PRODUCT(x##a)        \
+  BENCH_PRODUCT(x##b)        \
+  BENCH_PRODUCT(x##c)        \
+  BENCH_PRODUCT(x##d)        \
+  BENCH_PRODUCT(x##e)        \
+  BENCH_PRODUCT(x##f)
+#define BENCH_LIST_16(x)                                                    \
+  product_##x##0, product_##x##1, product_##x##2, product_##x##3,           \
+          product_##x##4, product_##x##5, product_##x##6, product_##x##7,   \
+          product_##x##8, product_##x##9, product_##x##a, product_##x##b,   \
+          product_##x##c, product_##x##d, product_##x##e, product_##x##f
+
+  BENCH_PRODUCTS_16(0)
+  BENCH_PRODUCTS_16(1)
+  BENCH_PRODUCTS_16(2)
+  BENCH_PRODUCTS_16(3)
+
+#define BENCH_LIST_64 \
+  BENCH_LIST_16(0), BENCH_LIST_16(1), BENCH_LIST_16(2), BENCH_LIST_16(3)
+
+  using factory_16 = fct::factory<product, BENCH_LIST_16(0)>;
+  using factory_64 = fct::factory<product, BENCH_LIST_64>;
+
+  // the former create(): a fold over a tuple built per call
+  template<typename... products>
+  struct legacy_factory {
+    template<typename T>
+    struct clz_name_t {
+      undo_cxx::id_type id = undo_cxx::id_name<T>();
+      std::unique_ptr<product> gen() const { return std::make_unique<T>(); }
+    };
+    static std::unique_ptr<product> create(undo_cxx::id_type const &id) {
+      std::unique_ptr<product> result{};
+      std::apply([&](auto &&...it) {
+        ((it.id == id ? result = it.gen() : result), ...);
+      },
+                 std::tuple<clz_name_t<products>...>{});
+      return result;
+    }
+  };
+  using legacy_16 = legacy_factory<BENCH_LIST_16(0)>;
+  using legacy_64 = legacy_factory<BENCH_LIST_64>;
+
+  // create the first or the last product by id
+  template<typename Factory, typename Product>
+  void BM_factory_create(benchmark::State &state) {
+    auto id = undo_cxx::id_name<Product>();
+    for (auto _ : state) {
+      auto p = Factory::create(id);
+      benchmark::DoNotOptimize(p);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  template<typename Factory, typename Product>
+  void BM_factory_make_shared(benchmark::State &state) {
+    auto id = undo_cxx::id_name<Product>();
+    for (auto _ : state) {
+      auto p = Factory::make_shared(id);
+      benchmark::DoNotOptimize(p);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  // the baseline: no lookup at all
+  void BM_make_unique(benchmark::State &state) {
+    for (auto _ : state) {
+      std::unique_ptr<product> p = std::make_unique<product_00>();
+      benchmark::DoNotOptimize(p);
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+
+} // namespace
+
+BENCHMARK(BM_make_unique);
+BENCHMARK_TEMPLATE(BM_factory_create, legacy_16, product_00);
+BENCHMARK_TEMPLATE(BM_factory_create, legacy_16, product_0f);
+BENCHMARK_TEMPLATE(BM_factory_create, legacy_64, product_00);
+BENCHMARK_TEMPLATE(BM_factory_create, legacy_64, product_3f);
+BENCHMARK_TEMPLATE(BM_factory_create, factory_16, product_00);
+BENCHMARK_TEMPLATE(BM_factory_create, factory_16, product_0f);
+BENCHMARK_TEMPLATE(BM_factory_create, factory_64, product_00);
+BENCHMARK_TEMPLATE(BM_factory_create, factory_64, product_3f);
+BENCHMARK_TEMPLATE(BM_factory_make_shared, factory_64, product_00);
+BENCHMARK_TEMPLATE(BM_factory_make_shared, factory_64, product_3f);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/4.
+//
+
+// undo/redo latency versus the history depth
+
+#include "bench.hh"
+
+namespace {
+  using dp::undo::bench::fixture;
+
+  // one undo and one redo at the newest end of a history of
+  // state.range(0) entries, the latency should be flat.
+  template<typename State>
+  void BM_undo_redo(benchmark::State &state) {
+    fixture<State> f(state.range(0));
+    for (auto _ : state) {
+      f.mgr->undo(f.cmd);
+      f.mgr->redo(f.cmd);
+      benchmark::DoNotOptimize(f.mgr->position());
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+  }
+
+  // the delta versions consult position() for the range checks.
+  template<typename State>
+  void BM_undo_redo_delta(benchmark::State &state) {
+    fixture<State> f(state.range(0));
+    for (auto _ : state) {
+      f.mgr->undo(f.cmd, 1);
+      f.mgr->redo(f.cmd, 1);
+      benchmark::DoNotOptimize(f.mgr->position());
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+  }
+
+  // multi-step: undo state.range(1) steps and redo them, in a history
+  // of state.range(0) entries.
+  template<typename State>
+  void BM_undo_redo_steps(benchmark::State &state) {
+    fixture<State> f(state.range(0));
+    auto steps = (int) state.range(1);
+    for (auto _ : state) {
+      f.mgr->undo(f.cmd, steps);
+      f.mgr->redo(f.cmd, steps);
+      benchmark::DoNotOptimize(f.mgr->position());
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+  }
+
+  // revert to a checkpoint state.range(0) steps back, and back again.
+  template<typename State>
+  void BM_undo_to_checkpoint(benchmark::State &state) {
+    fixture<State> f(state.range(0));
+    auto newest = f.mgr->size();
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(f.mgr->undo_to(0));
+      benchmark::DoNotOptimize(f.mgr->redo_to(newest));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+  }
+
+  template<typename State>
+  void BM_can_undo_redo(benchmark::State &state) {
+    fixture<State> f(state.range(0));
+    f.mgr->undo(f.cmd);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(f.mgr->can_undo());
+      benchmark::DoNotOptimize(f.mgr->can_redo());
+      benchmark::DoNotOptimize(f.mgr->position());
+    }
+  }
+
+} // namespace
+
+using dp::undo::bench::intrusive_state;
+using dp::undo::bench::list_state;
+using dp::undo::bench::pmr_state;
+using dp::undo::bench::ring_state;
+
+BENCHMARK_TEMPLATE(BM_undo_redo, list_state)->RangeMultiplier(10)->Range(10, 1000000);
+BENCHMARK_TEMPLATE(BM_undo_redo, ring_state)->RangeMultiplier(10)->Range(10, 1000000);
+BENCHMARK_TEMPLATE(BM_undo_redo, intrusive_state)->RangeMultiplier(10)->Range(10, 1000000);
+BENCHMARK_TEMPLATE(BM_undo_redo_delta, list_state)->RangeMultiplier(10)->Range(10, 1000000);
+BENCHMARK_TEMPLATE(BM_undo_redo_delta, ring_state)->RangeMultiplier(10)->Range(10, 1000000);
+BENCHMARK_TEMPLATE(BM_undo_redo_steps, list_state)->ArgsProduct({{1000, 100000}, {10, 100, 1000}});
+BENCHMARK_TEMPLATE(BM_undo_redo_steps, ring_state)->ArgsProduct({{1000, 100000}, {10, 100, 1000}});
+BENCHMARK_TEMPLATE(BM_undo_to_checkpoint, list_state)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK_TEMPLATE(BM_undo_to_checkpoint, ring_state)->RangeMultiplier(10)->Range(10, 10000);
+BENCHMARK_TEMPLATE(BM_can_undo_redo, list_state)->RangeMultiplier(10)->Range(10, 1000000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+// the inline history entries: inline_cmd_system_t against the
+// virtual commands and the state_t mementos of undoable_cmd_system_t
+
+#include "bench.hh"
+
+#include <array>
+
+namespace dp { namespace undo { namespace bench {
+
+  // Bytes of payload, inline if it fits the 64 bytes of an entry
+  template<std::size_t Bytes>
+  struct PayloadOp {
+    int value;
+    std::array<char, Bytes> payload{};
+
+    template<typename C>
+    void execute(C &) { benchmark::DoNotOptimize(value); }
+    template<typename C>
+    list_state save_state(C &) const { return {value}; }
+    template<typename C>
+    void undo(C &, list_state &s) { benchmark::DoNotOptimize(s); }
+    template<typename C>
+    void redo(C &, list_state &s) { benchmark::DoNotOptimize(s); }
+  };
+
+  using inline_manager_t = undo_cxx::inline_cmd_system_t<list_state, 64>;
+
+}}} // namespace dp::undo::bench
+
+namespace {
+  using dp::undo::bench::list_state;
+  using dp::undo::bench::PayloadOp;
+  using M = dp::undo::bench::manager_t<list_state>;
+  using I = dp::undo::bench::inline_manager_t;
+  using Cmd = dp::undo::bench::ValueCmd<list_state>;
+
+  // invoke range(0) commands
+  void BM_invoke_virtual(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<Cmd>((int) i);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  // the small commands are inline, the big ones on the heap
+  template<std::size_t Bytes>
+  void BM_invoke_inline(benchmark::State &state) {
+    for (auto _ : state) {
+      I mgr;
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<PayloadOp<Bytes>>((int) i);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // a scan of range(0) entries, reading every memento
+  void BM_scan_virtual(benchmark::State &state) {
+    dp::undo::bench::fixture<list_state> f{state.range(0)};
+    for (auto _ : state) {
+      long sum = 0;
+      for (auto it = f.mgr->oldest_iterator(); it != f.mgr->newest_iterator(); ++it)
+        sum += (**it)().value;
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  void BM_scan_inline(benchmark::State &state) {
+    I mgr;
+    for (std::int64_t i = 0; i < state.range(0); i++)
+      mgr.invoke<PayloadOp<8>>((int) i);
+    for (auto _ : state) {
+      long sum = 0;
+      for (std::size_t i = 0; i < mgr.size(); i++)
+        sum += mgr.at(i).state.value;
+      benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+} // namespace
+
+BENCHMARK(BM_invoke_virtual)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_invoke_inline, 8)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_invoke_inline, 128)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_scan_virtual)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_scan_inline)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
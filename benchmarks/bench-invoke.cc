@@ -0,0 +1,245 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/7.
+//
+
+// invoke+save throughput, and the memory per history entry
+
+#include "bench.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(__clang__)
+// the replaced operator new/delete below pair malloc with free
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// counts the heap usage, to report the memory per entry. Atomic, since
+// the workers of the asynchronous save allocate concurrently.
+static std::atomic<std::size_t> heap_bytes{0};
+static std::atomic<std::size_t> heap_allocs{0};
+
+void *operator new(std::size_t n) {
+  heap_bytes.fetch_add(n, std::memory_order_relaxed);
+  heap_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// a large document, the memento of which is expensive to build
+namespace dp { namespace undo { namespace bench {
+
+  struct big_state {
+    std::vector<int> data;
+    friend std::ostream &operator<<(std::ostream &os, big_state const &o) { return os << o.data.size(); }
+  };
+
+  template<typename State>
+  class BigCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~BigCmd() {}
+    BigCmd(std::shared_ptr<std::vector<int> const> doc)
+        : _doc(std::move(doc)) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(BigCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override { return build(sender, *_doc); }
+    MementoFn capture_state_impl(CmdSP &sender, ContextT &) override {
+      if (!async) return {};
+      return [sender, doc = _doc]() mutable { return build(sender, *doc); };
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+    static MementoPtr build(CmdSP &sender, std::vector<int> const &doc) {
+      State s{doc};
+      std::partial_sum(s.data.begin(), s.data.end(), s.data.begin());
+      return std::make_unique<Memento>(sender, std::move(s));
+    }
+
+  public:
+    static inline bool async = false;
+
+  private:
+    std::shared_ptr<std::vector<int> const> _doc;
+  };
+
+  struct text_state {
+    std::string text;
+    friend std::ostream &operator<<(std::ostream &os, text_state const &o) { return os << o.text; }
+  };
+
+  // a keystroke, the ones of a word are merged
+  template<typename State>
+  class TypeCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TypeCmd() {}
+    TypeCmd(char c)
+        : _text(1, c) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TypeCmd, undo_cxx::cmd_t);
+
+    bool merge_with(TypeCmd const &next) {
+      if (next._text[0] == ' ')
+        return false;
+      _text += next._text;
+      return true;
+    }
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text;
+  };
+
+}}} // namespace dp::undo::bench
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::big_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool async_save = true;
+};
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::text_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool merge = true;
+};
+
+namespace {
+  using dp::undo::bench::make_manager;
+  using dp::undo::bench::ValueCmd;
+
+  // record state.range(0) commands into a fresh history.
+  template<typename State>
+  void BM_invoke(benchmark::State &state) {
+    for (auto _ : state) {
+      auto mgr = make_manager<State>();
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr->template invoke<ValueCmd<State>>((int) i);
+      mgr->clear();
+      benchmark::DoNotOptimize(mgr->size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // invoke into a bounded history, so each invoke evicts the oldest one.
+  template<typename State>
+  void BM_invoke_bounded(benchmark::State &state) {
+    auto mgr = make_manager<State>();
+    mgr->max_size((std::size_t) state.range(0));
+    int i = 0;
+    for (auto _ : state)
+      mgr->template invoke<ValueCmd<State>>(i++);
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  // the heap usage per entry, reported as counters. The arena grows
+  // by chunks, so its bytes are amortized.
+  template<typename State>
+  void BM_memory_per_entry(benchmark::State &state) {
+    auto n = state.range(0);
+    double bytes = 0, allocs = 0, footprint = 0;
+    for (auto _ : state) {
+      std::size_t b0 = heap_bytes, a0 = heap_allocs;
+      auto mgr = make_manager<State>();
+      for (std::int64_t i = 0; i < n; i++)
+        mgr->template invoke<ValueCmd<State>>((int) i);
+      bytes = (double) (heap_bytes - b0) / (double) n;
+      allocs = (double) (heap_allocs - a0) / (double) n;
+      footprint = (double) mgr->memory_usage() / (double) n;
+    }
+    state.counters["heap_bytes_per_entry"] = bytes;
+    state.counters["heap_allocs_per_entry"] = allocs;
+    state.counters["footprint_per_entry"] = footprint;
+  }
+
+  // the latency of invoke() for a command whose memento is expensive,
+  // saved synchronously (range(1) == 0) or on a worker pool.
+  void BM_invoke_big_memento(benchmark::State &state) {
+    using State = dp::undo::bench::big_state;
+    using Cmd = dp::undo::bench::BigCmd<State>;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    auto doc = std::make_shared<std::vector<int> const>((std::size_t) state.range(0), 1);
+    undo_cxx::util::worker_pool_t pool{1};
+    M mgr;
+    mgr.max_size(64);
+    Cmd::async = state.range(1) != 0;
+    if (Cmd::async)
+      mgr.async_save(&pool);
+    int i = 0;
+    for (auto _ : state) {
+      mgr.invoke<Cmd>(doc);
+      if (++i % 64 == 0) {
+        state.PauseTiming();
+        mgr.wait_pending();
+        state.ResumeTiming();
+      }
+    }
+    mgr.wait_pending();
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  // type range(0) keystrokes, words of 7 letters and a space, with the
+  // merging on (range(1) != 0) or off.
+  void BM_typing(benchmark::State &state) {
+    using State = dp::undo::bench::text_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    double entries = 0, bytes = 0, allocs = 0;
+    for (auto _ : state) {
+      std::size_t b0 = heap_bytes, a0 = heap_allocs;
+      M mgr;
+      if (!state.range(1))
+        mgr.merge_window(std::chrono::milliseconds{0});
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<dp::undo::bench::TypeCmd<State>>(i % 8 == 7 ? ' ' : (char) ('a' + i % 8));
+      entries = (double) mgr.size();
+      bytes = (double) (heap_bytes - b0) / (double) state.range(0);
+      allocs = (double) (heap_allocs - a0) / (double) state.range(0);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["entries"] = entries;
+    state.counters["heap_bytes_per_key"] = bytes;
+    state.counters["heap_allocs_per_key"] = allocs;
+  }
+
+} // namespace
+
+using dp::undo::bench::intrusive_state;
+using dp::undo::bench::list_state;
+using dp::undo::bench::pmr_state;
+using dp::undo::bench::ring_state;
+
+BENCHMARK_TEMPLATE(BM_invoke, list_state)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_invoke, ring_state)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_invoke, pmr_state)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_invoke, intrusive_state)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_invoke_bounded, list_state)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_invoke_bounded, ring_state)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_invoke_bounded, pmr_state)->Arg(1000);
+BENCHMARK(BM_typing)->ArgsProduct({{100000}, {0, 1}})->ArgNames({"keys", "merge"});
+BENCHMARK(BM_invoke_big_memento)->ArgsProduct({{1 << 16, 1 << 20}, {0, 1}})->ArgNames({"ints", "async"});
+BENCHMARK_TEMPLATE(BM_memory_per_entry, list_state)->Arg(10000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_memory_per_entry, ring_state)->Arg(10000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_memory_per_entry, pmr_state)->Arg(10000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_memory_per_entry, intrusive_state)->Arg(10000)->Iterations(3);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,96 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/11.
+//
+
+// the journal: append throughput, and the restart time of a session
+
+#include "bench.hh"
+
+#include <filesystem>
+
+// no padding and no pointers, its bytes can be journaled
+template<>
+struct undo_cxx::is_journal_pod<dp::undo::bench::list_state> : std::true_type {};
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::list_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool journal = true;
+};
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Cmd = dp::undo::bench::ValueCmd<State>;
+  using J = undo_cxx::journal_t<State>;
+
+  std::filesystem::path journal_path() {
+    return std::filesystem::temp_directory_path() / "undo-cxx-bench.journal";
+  }
+
+  // invoke with a journal attached, range(1) != 0 to fsync each group.
+  void BM_journal_append(benchmark::State &state) {
+    auto path = journal_path();
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::filesystem::remove(path);
+      state.ResumeTiming();
+      {
+        J j{path, undo_cxx::journal_options_t{64 * 1024, state.range(1) != 0}};
+        M mgr;
+        mgr.journal(&j);
+        for (std::int64_t i = 0; i < state.range(0); i++)
+          mgr.invoke<Cmd>((int) i);
+      } // commit
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["journal_bytes"] = (double) std::filesystem::file_size(path);
+    std::filesystem::remove(path);
+  }
+
+  // the baseline: no journal
+  void BM_no_journal(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<Cmd>((int) i);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // restart: replay a session of range(0) entries with some undo/redo.
+  void BM_journal_replay(benchmark::State &state) {
+    auto path = journal_path();
+    std::filesystem::remove(path);
+    {
+      J j{path};
+      M mgr;
+      mgr.journal(&j);
+      for (std::int64_t i = 0; i < state.range(0); i++) {
+        mgr.invoke<Cmd>((int) i);
+        if (i % 16 == 15)
+          mgr.undo_to(mgr.size() - 2);
+      }
+    }
+    for (auto _ : state) {
+      J j{path};
+      M mgr;
+      benchmark::DoNotOptimize(mgr.replay(j));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    std::filesystem::remove(path);
+  }
+
+} // namespace
+
+BENCHMARK(BM_journal_append)->ArgsProduct({{1 << 20}, {0, 1}})->ArgNames({"entries", "fsync"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_no_journal)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_journal_replay)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,97 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/9.
+//
+
+// the throughput of the concurrent producers: cmd_queue_t against a
+// manager wrapped in a mutex
+
+#include "bench.hh"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Cmd = dp::undo::bench::ValueCmd<State>;
+
+  constexpr std::int64_t commands = 1 << 16;
+
+  // runs fn(producer, count) on state.range(0) threads, which share
+  // the commands evenly.
+  template<typename Fn>
+  void run_producers(std::int64_t producers, Fn &&fn) {
+    std::vector<std::thread> threads;
+    threads.reserve((std::size_t) producers);
+    for (std::int64_t p = 0; p < producers; p++)
+      threads.emplace_back(fn, p, commands / producers);
+    for (auto &t : threads)
+      t.join();
+  }
+
+  // the producers post into a cmd_queue_t, one applier thread invokes.
+  void BM_queue(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      mgr.max_size(1024);
+      {
+        undo_cxx::cmd_queue_t<M> q{mgr};
+        run_producers(state.range(0), [&q](std::int64_t, std::int64_t n) {
+          for (std::int64_t i = 0; i < n; i++)
+            q.post(std::make_shared<Cmd>((int) i));
+        });
+      } // stop(): everything is applied
+      benchmark::DoNotOptimize(mgr.size());
+    }
+    state.SetItemsProcessed(state.iterations() * commands);
+  }
+
+  // the producers submit, and wait for the last one.
+  void BM_queue_submit_wait(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      mgr.max_size(1024);
+      undo_cxx::cmd_queue_t<M> q{mgr};
+      run_producers(state.range(0), [&q](std::int64_t, std::int64_t n) {
+        undo_cxx::completion_t last;
+        for (std::int64_t i = 0; i < n; i++)
+          last = q.submit<Cmd>((int) i);
+        last.wait();
+      });
+    }
+    state.SetItemsProcessed(state.iterations() * commands);
+  }
+
+  // the baseline: every producer invokes under a mutex.
+  void BM_mutex(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      mgr.max_size(1024);
+      std::mutex m;
+      run_producers(state.range(0), [&mgr, &m](std::int64_t, std::int64_t n) {
+        for (std::int64_t i = 0; i < n; i++) {
+          M::CmdSP cmd = std::make_shared<Cmd>((int) i);
+          std::lock_guard<std::mutex> lk(m);
+          mgr.invoke(cmd);
+        }
+      });
+      benchmark::DoNotOptimize(mgr.size());
+    }
+    state.SetItemsProcessed(state.iterations() * commands);
+  }
+
+} // namespace
+
+BENCHMARK(BM_queue)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_queue_submit_wait)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_mutex)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
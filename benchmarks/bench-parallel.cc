@@ -0,0 +1,110 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+// parallel_composite_cmd_t: "apply a style to 20k objects", by 1 to 32
+// workers of a stealing_pool_t
+
+#include "bench.hh"
+
+#include <cmath>
+#include <vector>
+
+namespace dp { namespace undo { namespace bench {
+
+  /** @brief an object of the document, with some work to style it */
+  struct object_t {
+    double weight;
+  };
+
+  template<typename State>
+  class StyleCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~StyleCmd() {}
+    StyleCmd(std::vector<object_t> *objects, std::size_t id)
+        : _objects(objects)
+        , _id(id) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(StyleCmd, undo_cxx::cmd_t);
+
+    void footprint(undo_cxx::footprint_t &fp) const { fp.write(_id); }
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      auto &o = (*_objects)[_id];
+      _before = o.weight;
+      for (int i = 0; i < 200; i++)
+        o.weight = std::sqrt(o.weight + i);
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{(int) _before});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override { (*_objects)[_id].weight = _before; }
+    void redo_impl(CmdSP &sender, ContextT &ctx, Memento &) override { do_execute(sender, ctx); }
+
+  private:
+    std::vector<object_t> *_objects;
+    std::size_t _id;
+    double _before{};
+  };
+
+}}} // namespace dp::undo::bench
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Parallel = undo_cxx::parallel_composite_cmd_t<State>;
+  using Style = dp::undo::bench::StyleCmd<State>;
+
+  constexpr std::size_t objects = 20000;
+
+  // invoke the composite of 20k styles, by range(0) workers (0: in turn)
+  void BM_style_invoke(benchmark::State &state) {
+    std::vector<dp::undo::bench::object_t> doc(objects, {1.0});
+    std::unique_ptr<undo_cxx::util::stealing_pool_t> pool;
+    if (state.range(0))
+      pool = std::make_unique<undo_cxx::util::stealing_pool_t>((std::size_t) state.range(0));
+    auto c = std::make_shared<Parallel>(pool.get());
+    for (std::size_t i = 0; i < objects; i++)
+      c->add_command(std::make_shared<Style>(&doc, i));
+    M::CmdSP cmd = c;
+    M mgr;
+    mgr.max_size(16);
+    for (auto _ : state)
+      mgr.invoke(cmd);
+    state.SetItemsProcessed(state.iterations() * (std::int64_t) objects);
+  }
+
+  // undo+redo the composite memento
+  void BM_style_undo_redo(benchmark::State &state) {
+    std::vector<dp::undo::bench::object_t> doc(objects, {1.0});
+    std::unique_ptr<undo_cxx::util::stealing_pool_t> pool;
+    if (state.range(0))
+      pool = std::make_unique<undo_cxx::util::stealing_pool_t>((std::size_t) state.range(0));
+    auto c = std::make_shared<Parallel>(pool.get());
+    for (std::size_t i = 0; i < objects; i++)
+      c->add_command(std::make_shared<Style>(&doc, i));
+    M::CmdSP cmd = c;
+    M mgr;
+    mgr.invoke(cmd);
+    auto &memento = *mgr.newest_item();
+    M::ContextT ctx{mgr};
+    for (auto _ : state) {
+      cmd->undo(cmd, ctx, memento);
+      cmd->redo(cmd, ctx, memento);
+    }
+    state.SetItemsProcessed(state.iterations() * (std::int64_t) objects * 2);
+  }
+
+} // namespace
+
+BENCHMARK(BM_style_invoke)->Arg(0)->RangeMultiplier(2)->Range(1, 32)->ArgName("workers")->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_style_undo_redo)->Arg(0)->RangeMultiplier(2)->Range(1, 32)->ArgName("workers")->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
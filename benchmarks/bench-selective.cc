@@ -0,0 +1,94 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+// the selective undo: the dependency check versus the history depth,
+// and the cost of indexing the footprints on invoke
+
+#include "bench.hh"
+
+namespace dp { namespace undo { namespace bench {
+
+  // writes the cell value % cells
+  template<typename State>
+  class CellCmd : public ValueCmd<State> {
+  public:
+    CellCmd(int value, int cells)
+        : ValueCmd<State>(value)
+        , _cell((std::uint64_t) (value % cells)) {}
+    void footprint(undo_cxx::footprint_t &fp) const { fp.write(_cell); }
+
+  private:
+    std::uint64_t _cell;
+  };
+
+}}} // namespace dp::undo::bench
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::list_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool selective = true;
+};
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Cmd = dp::undo::bench::ValueCmd<State>;
+  using CellCmd = dp::undo::bench::CellCmd<State>;
+
+  // can_undo_entry() of an entry in the middle of a history of range(0)
+  // entries, each one writes one of range(1) cells.
+  void BM_can_undo_entry(benchmark::State &state) {
+    M mgr;
+    auto depth = (int) state.range(0);
+    M::Iterator mid;
+    for (int i = 0; i < depth; i++) {
+      mgr.invoke<CellCmd>(i, (int) state.range(1));
+      if (i == depth / 2)
+        mid = std::prev(mgr.newest_iterator());
+    }
+    for (auto _ : state)
+      benchmark::DoNotOptimize(mgr.can_undo_entry(mid));
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  // invoke range(0) commands, with (range(1) != 0) or without footprints
+  void BM_invoke(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      for (std::int64_t i = 0; i < state.range(0); i++) {
+        if (state.range(1))
+          mgr.invoke<CellCmd>((int) i, 1 << 20);
+        else
+          mgr.invoke<Cmd>((int) i);
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // invoke into a history capped at range(0) entries, all of them
+  // write one hot cell: each push evicts the oldest one of the cell
+  void BM_invoke_hot_key(benchmark::State &state) {
+    M mgr;
+    mgr.max_size((M::size_type) state.range(0));
+    for (std::int64_t i = 0; i < state.range(0); i++)
+      mgr.invoke<CellCmd>((int) i, 1);
+    int i = 0;
+    for (auto _ : state)
+      mgr.invoke<CellCmd>(i++, 1);
+    state.SetItemsProcessed(state.iterations());
+  }
+
+} // namespace
+
+BENCHMARK(BM_can_undo_entry)->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {1 << 20}})->ArgNames({"depth", "cells"});
+BENCHMARK(BM_invoke)->ArgsProduct({{1 << 16}, {0, 1}})->ArgNames({"entries", "footprint"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_invoke_hot_key)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+
+BENCHMARK_MAIN();
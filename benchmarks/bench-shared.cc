@@ -0,0 +1,68 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+// the shared history pool: the cost of charging the pool on invoke,
+// and a server of many documents under one global budget
+
+#include "bench.hh"
+
+#include <vector>
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::list_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool shared_pool = true;
+};
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Cmd = dp::undo::bench::ValueCmd<State>;
+
+  // invoke range(0) commands on one document, in a pool (range(1) != 0)
+  // or alone
+  void BM_invoke(benchmark::State &state) {
+    for (auto _ : state) {
+      undo_cxx::history_pool_t pool;
+      auto mgr = state.range(1) ? std::make_unique<M>(pool) : std::make_unique<M>();
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr->invoke<Cmd>((int) i);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // range(0) documents edited in turn, 64 commands each per round, 16
+  // rounds; in a pool of 1 MiB (range(1) != 0) or unbounded. The
+  // counter is the resident footprint of the histories.
+  void BM_documents(benchmark::State &state) {
+    std::size_t bytes{};
+    for (auto _ : state) {
+      undo_cxx::history_pool_t pool{1 << 20};
+      std::vector<std::unique_ptr<M>> docs;
+      for (std::int64_t d = 0; d < state.range(0); d++)
+        docs.push_back(state.range(1) ? std::make_unique<M>(pool) : std::make_unique<M>());
+      for (int round = 0; round < 16; round++)
+        for (auto &doc : docs)
+          for (int i = 0; i < 64; i++)
+            doc->invoke<Cmd>(i);
+      bytes = 0;
+      for (auto &doc : docs)
+        bytes += doc->memory_usage();
+    }
+    state.counters["bytes"] = (double) bytes;
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 16 * 64);
+  }
+
+} // namespace
+
+BENCHMARK(BM_invoke)->ArgsProduct({{1 << 16}, {0, 1}})->ArgNames({"entries", "pooled"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_documents)->ArgsProduct({{64, 1024}, {0, 1}})->ArgNames({"documents", "pooled"})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,177 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/12.
+//
+
+// the tiered history: the resident memory of a long session, the cost
+// of walking back into the spilled mementos, and the built-in codec
+
+#include "bench.hh"
+
+#include <string>
+#include <string_view>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace dp { namespace undo { namespace bench {
+
+  /** @brief about 4 KiB of text, which differs by n */
+  inline std::string text_of(int n) {
+    static char const *const words[] = {"undo", "redo", "the", "document", "memento", "history", "command", "state"};
+    std::string s;
+    s.reserve(4200);
+    for (unsigned k = 0; s.size() < 4096; k++) {
+      s += words[(k * 7 + (unsigned) n) % 8];
+      s += k % 12 == 11 ? '\n' : ' ';
+    }
+    s += std::to_string(n);
+    return s;
+  }
+
+  /** @brief a 4 KiB memento */
+  struct blob_state {
+    std::string data;
+
+    void serialize(std::string &out) const { out += data; }
+    bool deserialize(std::string_view in) {
+      data.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, blob_state const &o) { return os << o.data.size(); }
+  };
+
+  template<typename State>
+  class BlobCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~BlobCmd() {}
+    BlobCmd(int value)
+        : _value(value) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(BlobCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{text_of(_value)});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    int _value{};
+  };
+
+}}} // namespace dp::undo::bench
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::blob_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+  static constexpr bool spill = true;
+};
+
+namespace {
+  using State = dp::undo::bench::blob_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using Cmd = dp::undo::bench::BlobCmd<State>;
+
+  // the heap in use, in bytes
+  double heap_in_use() {
+#if defined(__GLIBC__)
+    return (double) ::mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+  }
+
+  // the cold stores of range(1): 0 for no spilling, 1 for a spill file,
+  // 2 for the compressed memory, 3 for it with the compression on a
+  // worker thread.
+  struct stores {
+    explicit stores(M &mgr, std::int64_t kind) {
+      undo_cxx::cold_store_t *s[] = {nullptr, &file, &inline_lz, &background_lz};
+      if (kind)
+        mgr.spill(s[kind], undo_cxx::spill_options_t{256, 0});
+    }
+    undo_cxx::util::worker_pool_t pool{1};
+    undo_cxx::spill_file_t file{};
+    undo_cxx::compressed_store_t inline_lz{};
+    undo_cxx::compressed_store_t background_lz{&pool};
+  };
+
+  // record a session of range(0) entries, the hot window is 256.
+  void BM_session(benchmark::State &state) {
+    double heap = 0;
+    for (auto _ : state) {
+      M mgr;
+      stores cold{mgr, state.range(1)};
+      auto before = heap_in_use();
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<Cmd>((int) i);
+      cold.background_lz.flush();
+      heap = heap_in_use() - before;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["heap_MiB"] = heap / (1 << 20);
+  }
+
+  // undo back to the oldest memento and redo, step by step: the cold
+  // ones are paged in and spilled again by the next invoke().
+  void BM_walk_cold(benchmark::State &state) {
+    M mgr;
+    stores cold{mgr, state.range(1)};
+    for (std::int64_t i = 0; i < state.range(0); i++)
+      mgr.invoke<Cmd>((int) i);
+    M::CmdSP cmd = std::make_shared<Cmd>(0);
+    for (auto _ : state) {
+      for (std::int64_t i = 0; i < state.range(0) - 1; i++)
+        mgr.undo(cmd);
+      benchmark::DoNotOptimize((*mgr.focused_item())().data.data());
+      for (std::int64_t i = 0; i < state.range(0) - 1; i++)
+        mgr.redo(cmd);
+      mgr.erase();
+      mgr.undo(cmd);
+      mgr.erase();
+      mgr.invoke<Cmd>(0); // spill the paged-in ones again
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * (state.range(0) - 1));
+  }
+
+  void BM_lz_compress(benchmark::State &state) {
+    undo_cxx::lz_codec_t lz;
+    auto text = dp::undo::bench::text_of(1);
+    std::string z;
+    for (auto _ : state) {
+      z.clear();
+      lz.compress(text, z);
+      benchmark::DoNotOptimize(z.data());
+    }
+    state.SetBytesProcessed(state.iterations() * (std::int64_t) text.size());
+    state.counters["ratio"] = (double) text.size() / (double) z.size();
+  }
+
+  void BM_lz_decompress(benchmark::State &state) {
+    undo_cxx::lz_codec_t lz;
+    auto text = dp::undo::bench::text_of(1);
+    std::string z, out;
+    lz.compress(text, z);
+    for (auto _ : state) {
+      out.clear();
+      benchmark::DoNotOptimize(lz.decompress(z, text.size(), out));
+    }
+    state.SetBytesProcessed(state.iterations() * (std::int64_t) text.size());
+  }
+
+} // namespace
+
+BENCHMARK(BM_session)->ArgsProduct({{20000}, {0, 1, 2, 3}})->ArgNames({"entries", "store"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_walk_cold)->ArgsProduct({{20000}, {0, 1, 2}})->ArgNames({"entries", "store"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_lz_compress);
+BENCHMARK(BM_lz_decompress);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,102 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+// the undo tree: undo/redo steps, branch switches and goto_node()
+
+#include "bench.hh"
+
+#include <vector>
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::list_state> : undo_cxx::default_history_traits_t {
+  static constexpr bool tree = true;
+};
+
+namespace {
+  using dp::undo::bench::list_state;
+  using State = list_state;
+  using M = dp::undo::bench::manager_t<State>;
+  using Cmd = dp::undo::bench::ValueCmd<State>;
+
+  // a trunk of range(0) entries, and range(1) branches of 16 entries
+  // forking off its middle.
+  struct bush {
+    explicit bush(benchmark::State const &state) {
+      mgr.tree_mode(true);
+      auto depth = state.range(0);
+      for (std::int64_t i = 0; i < depth; i++)
+        mgr.invoke<Cmd>((int) i);
+      for (std::int64_t b = 0; b < state.range(1); b++) {
+        mgr.undo_to((M::size_type) (depth / 2));
+        for (int i = 0; i < 16; i++)
+          mgr.invoke<Cmd>(i);
+        leaves.push_back(mgr.current_node());
+      }
+    }
+
+    M mgr;
+    std::vector<M::node_id> leaves{};
+  };
+
+  // single-step undo/redo in the tree mode, one item is a step
+  void BM_tree_undo_redo(benchmark::State &state) {
+    bush b{state};
+    M::CmdSP cmd = std::make_shared<Cmd>(0);
+    for (auto _ : state) {
+      b.mgr.undo(cmd);
+      b.mgr.redo(cmd);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+  }
+
+  // switch between the two branches of 16 entries at the fork
+  void BM_switch_branch(benchmark::State &state) {
+    bush b{state};
+    b.mgr.undo_to(b.mgr.size() - 16);
+    std::size_t i = 0;
+    for (auto _ : state)
+      benchmark::DoNotOptimize(b.mgr.switch_branch(1 + (i++ & 1)));
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  // goto_node() between the leaves of the branches, through the fork
+  void BM_goto_node(benchmark::State &state) {
+    bush b{state};
+    std::size_t i = 0;
+    for (auto _ : state)
+      benchmark::DoNotOptimize(b.mgr.goto_node(b.leaves[i++ % b.leaves.size()]));
+    state.SetItemsProcessed(state.iterations());
+  }
+
+  // a session of range(0) commands with an undo of 2 steps every 8
+  // ones, the tree is bounded by max_nodes(range(1)).
+  void BM_tree_session(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      mgr.tree_mode(true);
+      mgr.max_nodes((M::size_type) state.range(1));
+      for (std::int64_t i = 0; i < state.range(0); i++) {
+        mgr.invoke<Cmd>((int) i);
+        if (i % 8 == 7)
+          mgr.undo_to(mgr.position() - 2);
+      }
+      benchmark::DoNotOptimize(mgr.tree()->size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+} // namespace
+
+BENCHMARK(BM_tree_undo_redo)->ArgsProduct({{1 << 10, 1 << 16}, {2}})->ArgNames({"depth", "branches"});
+BENCHMARK(BM_switch_branch)->ArgsProduct({{1 << 10, 1 << 16}, {2}})->ArgNames({"depth", "branches"});
+BENCHMARK(BM_goto_node)->ArgsProduct({{1 << 10, 1 << 16}, {2, 64}})->ArgNames({"depth", "branches"});
+BENCHMARK(BM_tree_session)->ArgsProduct({{1 << 16}, {1 << 12, 1 << 20}})->ArgNames({"entries", "max_nodes"})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+// the closed command set: variant_cmd_system_t (std::variant by value,
+// std::visit) against the virtual commands behind shared_ptr
+
+#include "bench.hh"
+
+namespace dp { namespace undo { namespace bench {
+
+  // the value commands of a closed set, like ValueCmd
+  template<int Kind>
+  struct ValueOp {
+    int value;
+
+    template<typename C>
+    void execute(C &) { benchmark::DoNotOptimize(value); }
+    template<typename C>
+    list_state save_state(C &) const { return {value + Kind}; }
+    template<typename C>
+    void undo(C &, list_state &s) { benchmark::DoNotOptimize(s); }
+    template<typename C>
+    void redo(C &, list_state &s) { benchmark::DoNotOptimize(s); }
+  };
+
+  using variant_manager_t = undo_cxx::variant_cmd_system_t<list_state, ValueOp<0>, ValueOp<1>, ValueOp<2>, ValueOp<3>>;
+
+}}} // namespace dp::undo::bench
+
+namespace {
+  using dp::undo::bench::list_state;
+  using dp::undo::bench::ValueOp;
+  using M = dp::undo::bench::manager_t<list_state>;
+  using V = dp::undo::bench::variant_manager_t;
+  using Cmd = dp::undo::bench::ValueCmd<list_state>;
+
+  // invoke range(0) commands
+  void BM_invoke_virtual(benchmark::State &state) {
+    for (auto _ : state) {
+      M mgr;
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        mgr.invoke<Cmd>((int) i);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+  void BM_invoke_variant(benchmark::State &state) {
+    for (auto _ : state) {
+      V mgr;
+      for (std::int64_t i = 0; i < state.range(0); i++) {
+        switch (i & 3) {
+          case 0: mgr.invoke<ValueOp<0>>((int) i); break;
+          case 1: mgr.invoke<ValueOp<1>>((int) i); break;
+          case 2: mgr.invoke<ValueOp<2>>((int) i); break;
+          default: mgr.invoke<ValueOp<3>>((int) i); break;
+        }
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  // a full undo walk and a full redo walk over range(0) entries, one
+  // step at a time. The virtual manager moves its cursor, the variant
+  // one calls the undo/redo hooks of the commands, too.
+  void BM_undo_redo_virtual(benchmark::State &state) {
+    dp::undo::bench::fixture<list_state> f{state.range(0)};
+    for (auto _ : state) {
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        f.mgr->undo(f.cmd);
+      for (std::int64_t i = 0; i < state.range(0); i++)
+        f.mgr->redo(f.cmd);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+  }
+  void BM_undo_redo_variant(benchmark::State &state) {
+    V mgr;
+    for (std::int64_t i = 0; i < state.range(0); i++)
+      mgr.invoke(V::CmdT{std::in_place_index<1>, ValueOp<1>{(int) i}});
+    for (auto _ : state) {
+      while (mgr.undo()) {}
+      while (mgr.redo()) {}
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+  }
+
+} // namespace
+
+BENCHMARK(BM_invoke_virtual)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_invoke_variant)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_undo_redo_virtual)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_undo_redo_variant)->Arg(1 << 16)->ArgName("entries")->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
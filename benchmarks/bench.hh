@@ -0,0 +1,114 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/7.
+//
+
+#ifndef UNDO_CXX_BENCH_HH
+#define UNDO_CXX_BENCH_HH
+
+#include "undo_cxx.hh"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <type_traits>
+
+// the states and commands shared by the benchmarks
+namespace dp { namespace undo { namespace bench {
+
+  /** @brief the default history: std::list */
+  struct list_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, list_state const &o) { return os << o.value; }
+  };
+  /** @brief the history is a ring_buffer_t */
+  struct ring_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, ring_state const &o) { return os << o.value; }
+  };
+  /** @brief the history is a std::pmr::list in an arena */
+  struct pmr_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, pmr_state const &o) { return os << o.value; }
+  };
+
+  /** @brief the default history, the commands are held by intrusive_ptr */
+  struct intrusive_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, intrusive_state const &o) { return os << o.value; }
+  };
+
+  /** @brief the base class of the commands */
+  template<typename State>
+  using cmd_base_t = std::conditional_t<std::is_same_v<State, intrusive_state>,
+                                        undo_cxx::intrusive_base_cmd_t<undo_cxx::single_thread_ref_count_t>,
+                                        undo_cxx::base_cmd_t>;
+
+  template<typename State>
+  class ValueCmd : public undo_cxx::cmd_t<State, cmd_base_t<State>> {
+  public:
+    ~ValueCmd() {}
+    ValueCmd() {}
+    ValueCmd(int value)
+        : _value(value) {}
+    UNDO_CXX_DEFINE_BASED_CMD_TYPES(ValueCmd, undo_cxx::cmd_t, cmd_base_t<State>);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override { benchmark::DoNotOptimize(_value); }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_value});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    int _value{};
+  };
+
+  template<typename State>
+  using manager_t = undo_cxx::undoable_cmd_system_t<State, undo_cxx::context_t<State, cmd_base_t<State>>, cmd_base_t<State>>;
+
+  /** @brief a manager, with an arena for pmr_state */
+  template<typename State>
+  inline std::unique_ptr<manager_t<State>> make_manager() {
+    if constexpr (std::is_same_v<State, pmr_state>)
+      return std::make_unique<manager_t<State>>(std::pmr::new_delete_resource());
+    else
+      return std::make_unique<manager_t<State>>();
+  }
+
+  /** @brief a manager with a history of depth entries */
+  template<typename State>
+  struct fixture {
+    using M = manager_t<State>;
+    using Cmd = ValueCmd<State>;
+
+    explicit fixture(std::int64_t depth) {
+      for (std::int64_t i = 0; i < depth; i++)
+        mgr->template invoke<Cmd>((int) i);
+    }
+
+    std::unique_ptr<M> mgr{make_manager<State>()};
+    typename M::CmdSP cmd{undo_cxx::cmd_handle_traits_t<cmd_base_t<State>>::template make<Cmd>(0)};
+  };
+
+}}} // namespace dp::undo::bench
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::ring_state> : undo_cxx::default_history_traits_t {
+  template<typename T>
+  using container = undo_cxx::util::ring_buffer_t<T>;
+};
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::bench::pmr_state> : undo_cxx::pmr_history_traits_t {};
+
+#endif //UNDO_CXX_BENCH_HH
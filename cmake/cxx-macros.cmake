@@ -720,6 +720,13 @@ set(${PROJ_NAME}_LIBRARIES ${PROJ_NAME})
 			endif ()
 		endif ()
 		
+		option(${PROJ_PREFIX}_BUILD_BENCHMARKS "build benchmarks (needs google benchmark)" ON)
+		if (${${PROJ_PREFIX}_BUILD_BENCHMARKS} AND (${CMAKE_CURRENT_SOURCE_DIR} STREQUAL CMAKE_SOURCE_DIR))
+			if (EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/benchmarks/")
+				add_subdirectory(benchmarks/)
+			endif ()
+		endif ()
+		
 		if (NOT EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/docs/")
 			set(diclp_ARG_BUILD_DOCS OFF)
 		endif ()
@@ -1237,7 +1244,7 @@ function (define_example_program name)
 	#target_compile_definitions(${_proj_name}-${name} PRIVATE)
 	target_compile_definitions(${_proj_name} PRIVATE
 			${_${_proj_name}CXXDEFS}
-			${define_test_program_ARG_CXXDEFINITIONS}
+			${define_example_program_ARG_CXXDEFINITIONS}
 	)
 	
 	set_target_properties(${_proj_name} PROPERTIES LINKER_LANGUAGE CXX)
@@ -484,6 +484,12 @@ namespace undo_cxx::traits {
   template<class T>
   constexpr inline bool has_empty_v<T, void_t<decltype(std::declval<T>().empty())>>{true};
 
+  template<class T, class = void>
+  constexpr inline bool has_memory_usage_v{false};
+
+  template<class T>
+  constexpr inline bool has_memory_usage_v<T, void_t<decltype(std::declval<T>().memory_usage())>>{true};
+
 #if 0
     namespace detail {
         
@@ -0,0 +1,361 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/13.
+//
+
+#ifndef UNDO_CXX_UNDO_CODEC_HH
+#define UNDO_CXX_UNDO_CODEC_HH
+
+#include "undo-pool.hh"
+#include "undo-tier.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// ------------------- codec_t, lz_codec_t
+namespace undo_cxx {
+
+  /**
+   * @brief a compressor of the cold mementos, see compressed_store_t.
+   * @details The methods may be called by several threads at once.
+   */
+  class codec_t {
+  public:
+    virtual ~codec_t() = default;
+    /** @brief append the compressed in to out */
+    virtual void compress(std::string_view in, std::string &out) const = 0;
+    /** @brief append the raw_size bytes decompressed from in to out, false if in is malformed */
+    virtual bool decompress(std::string_view in, std::size_t raw_size, std::string &out) const = 0;
+  };
+
+  /**
+   * @brief the built-in byte-oriented LZ77 codec, in the spirit of LZ4.
+   * @details A sequence is a token byte (the literal length in the high
+   * nibble, the match length - 4 in the low one, 15 means more length
+   * bytes follow, each one adds up to 255), the literals, and the match
+   * as a 16-bit little-endian offset back into the output. The last
+   * sequence has the literals only. The matches are found by a hash of
+   * the 4-byte prefixes, the search speeds up over the incompressible
+   * runs.
+   */
+  class lz_codec_t : public codec_t {
+  public:
+    static constexpr std::size_t min_match = 4;
+    static constexpr std::size_t max_offset = 65535;
+    static constexpr unsigned hash_bits = 12;
+
+    void compress(std::string_view in, std::string &out) const override {
+      auto const *src = reinterpret_cast<std::uint8_t const *>(in.data());
+      std::size_t n = in.size(), anchor = 0, i = 0;
+      std::uint32_t table[1u << hash_bits]{};
+      out.reserve(out.size() + n + n / 255 + 16);
+      while (n >= min_match && i <= n - min_match) {
+        auto h = hash(src + i);
+        std::size_t cand = table[h];
+        table[h] = (std::uint32_t) i;
+        if (cand < i && i - cand <= max_offset && std::memcmp(src + cand, src + i, min_match) == 0) {
+          std::size_t len = min_match;
+          while (i + len < n && src[cand + len] == src[i + len])
+            len++;
+          put_sequence(out, in.substr(anchor, i - anchor), i - cand, len);
+          i += len;
+          anchor = i;
+        } else {
+          i += 1 + ((i - anchor) >> 6);
+        }
+      }
+      put_sequence(out, in.substr(anchor), 0, 0);
+    }
+
+    bool decompress(std::string_view in, std::size_t raw_size, std::string &out) const override {
+      auto const *ip = reinterpret_cast<std::uint8_t const *>(in.data());
+      auto const *end = ip + in.size();
+      auto base = out.size();
+      out.resize(base + raw_size);
+      auto *op = reinterpret_cast<std::uint8_t *>(&out[base]);
+      std::size_t produced = 0;
+      while (ip < end) {
+        auto token = *ip++;
+        std::size_t lit = token >> 4, len = token & 15u;
+        if (!get_length(ip, end, lit) || (std::size_t) (end - ip) < lit || raw_size - produced < lit)
+          return false;
+        std::memcpy(op + produced, ip, lit);
+        ip += lit;
+        produced += lit;
+        if (ip == end)
+          break;
+        if (end - ip < 2)
+          return false;
+        std::size_t offset = ip[0] | (std::size_t) ip[1] << 8;
+        ip += 2;
+        if (!get_length(ip, end, len))
+          return false;
+        len += min_match;
+        if (offset == 0 || offset > produced || raw_size - produced < len)
+          return false;
+        // an overlapped match repeats the last offset bytes, it's
+        // copied in the growing multiples of them.
+        auto *dst = op + produced;
+        auto const *from = dst - offset;
+        for (std::size_t copied = 0, n; copied < len; copied += n) {
+          n = std::min(len - copied, copied + offset);
+          std::memcpy(dst + copied, from, n);
+        }
+        produced += len;
+      }
+      return produced == raw_size;
+    }
+
+  private:
+    static std::uint32_t hash(std::uint8_t const *p) {
+      std::uint32_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return (v * 2654435761u) >> (32 - hash_bits);
+    }
+    static void put_length(std::string &out, std::size_t n) {
+      for (; n >= 255; n -= 255)
+        out.push_back((char) 255);
+      out.push_back((char) n);
+    }
+    static bool get_length(std::uint8_t const *&ip, std::uint8_t const *end, std::size_t &n) {
+      if (n != 15)
+        return true;
+      for (;;) {
+        if (ip == end)
+          return false;
+        auto b = *ip++;
+        n += b;
+        if (b != 255)
+          return true;
+      }
+    }
+    // the literals, and a match of len bytes at offset back (len is 0 for the last one)
+    static void put_sequence(std::string &out, std::string_view lit, std::size_t offset, std::size_t len) {
+      auto ml = len ? len - min_match : 0;
+      out.push_back((char) ((std::min<std::size_t>(lit.size(), 15) << 4) | std::min<std::size_t>(ml, 15)));
+      if (lit.size() >= 15)
+        put_length(out, lit.size() - 15);
+      out.append(lit);
+      if (!len)
+        return;
+      out.push_back((char) (offset & 0xff));
+      out.push_back((char) (offset >> 8));
+      if (ml >= 15)
+        put_length(out, ml - 15);
+    }
+  };
+
+} // namespace undo_cxx
+
+// ------------------- compressed_store_t
+namespace undo_cxx {
+
+  struct compressed_store_options_t {
+    /** @brief the new entries are compressed in batches of this many raw bytes */
+    std::size_t batch_bytes{256 * 1024};
+  };
+
+  /**
+   * @brief a cold store in memory: the bytes are compressed by a codec,
+   * lz_codec_t by default.
+   * @details The new entries are kept raw until a batch of them is
+   * collected, then the batch is compressed on the worker pool, or on
+   * the calling thread if there's no pool. get() decompresses, or
+   * copies the raw bytes of an entry not compressed yet. The entries
+   * which don't shrink are kept raw.
+   * @code{c++}
+   * undo_cxx::util::worker_pool_t pool{1};
+   * undo_cxx::compressed_store_t cold{&pool};
+   * mgr.spill(&cold, undo_cxx::spill_options_t{256});
+   * ...
+   * auto sz = cold.sizes(*mgr.cold_ticket(*mgr.oldest_iterator()));
+   * @endcode
+   * The pool and the codec must outlive the store.
+   */
+  class compressed_store_t : public cold_store_t {
+  public:
+    /** @brief the raw and the compressed (or raw, if not compressed yet) sizes */
+    struct sizes_t {
+      std::uint64_t raw;
+      std::uint64_t stored;
+    };
+
+    explicit compressed_store_t(util::worker_pool_t *pool = nullptr, codec_t const *codec = nullptr, compressed_store_options_t opts = {})
+        : _pool(pool)
+        , _codec(codec ? codec : &default_codec())
+        , _opts(opts) {}
+    ~compressed_store_t() override { wait(); }
+    compressed_store_t(compressed_store_t const &) = delete;
+    compressed_store_t &operator=(compressed_store_t const &) = delete;
+
+    ticket_t put(std::string_view bytes) override {
+      std::unique_lock<std::mutex> lk(_m);
+      std::size_t id;
+      if (_free.empty()) {
+        id = _slots.size();
+        _slots.emplace_back();
+      } else {
+        id = _free.back();
+        _free.pop_back();
+      }
+      auto &s = _slots[id];
+      s.raw = std::make_shared<std::string const>(bytes);
+      s.gen++;
+      _raw_bytes += bytes.size();
+      _stored_bytes += bytes.size();
+      _count++;
+      _batch.push_back(item_t{id, s.gen, s.raw});
+      _batch_bytes += bytes.size();
+      if (_batch_bytes >= _opts.batch_bytes) {
+        lk.unlock();
+        flush_batch();
+      }
+      return {id, bytes.size()};
+    }
+    void get(ticket_t const &t, std::string &out) override {
+      std::lock_guard<std::mutex> lk(_m);
+      auto &s = _slots[(std::size_t) t.offset];
+      out.clear();
+      if (s.raw)
+        out.assign(*s.raw);
+      else if (!s.packed)
+        out.assign(s.data);
+      else if (!_codec->decompress(s.data, (std::size_t) t.size, out))
+        throw std::runtime_error("a compressed memento is corrupted");
+    }
+    void release(ticket_t const &t) override {
+      std::lock_guard<std::mutex> lk(_m);
+      auto &s = _slots[(std::size_t) t.offset];
+      _raw_bytes -= t.size;
+      _stored_bytes -= s.raw ? s.raw->size() : s.data.size();
+      _count--;
+      s.raw.reset();
+      s.data = std::string{};
+      s.packed = false;
+      s.gen++;
+      _free.push_back((std::size_t) t.offset);
+    }
+
+    /** @brief the sizes of an entry, see undoable_cmd_system_t::cold_ticket() */
+    sizes_t sizes(ticket_t const &t) const {
+      std::lock_guard<std::mutex> lk(_m);
+      auto &s = _slots[(std::size_t) t.offset];
+      return {t.size, s.raw ? s.raw->size() : s.data.size()};
+    }
+    /** @brief the raw bytes of all the entries */
+    std::uint64_t raw_bytes() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _raw_bytes;
+    }
+    /** @brief the bytes held for all the entries */
+    std::uint64_t stored_bytes() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _stored_bytes;
+    }
+    /** @brief the number of the entries */
+    std::size_t size() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _count;
+    }
+
+    /** @brief compress the collected entries now, and wait for the pool */
+    void flush() {
+      flush_batch();
+      wait();
+    }
+
+  private:
+    struct slot_t {
+      std::shared_ptr<std::string const> raw{}; // not compressed yet
+      std::string data{};
+      bool packed{};
+      std::uint64_t gen{};
+    };
+    struct item_t {
+      std::size_t id;
+      std::uint64_t gen;
+      std::shared_ptr<std::string const> raw;
+    };
+
+    static codec_t const &default_codec() {
+      static lz_codec_t codec;
+      return codec;
+    }
+
+    void flush_batch() {
+      std::vector<item_t> batch;
+      {
+        std::lock_guard<std::mutex> lk(_m);
+        batch.swap(_batch);
+        _batch_bytes = 0;
+        if (batch.empty())
+          return;
+        if (_pool)
+          _inflight++;
+      }
+      if (!_pool) {
+        run(batch);
+        return;
+      }
+      _pool->submit([this, batch = std::move(batch)] {
+        run(batch);
+        std::lock_guard<std::mutex> lk(_m);
+        if (--_inflight == 0)
+          _cv.notify_all();
+      });
+    }
+    void run(std::vector<item_t> const &batch) {
+      std::string out;
+      for (auto const &item : batch) {
+        out.clear();
+        _codec->compress(*item.raw, out);
+        std::lock_guard<std::mutex> lk(_m);
+        auto &s = _slots[item.id];
+        if (s.gen != item.gen)
+          continue; // released meanwhile
+        bool packed = out.size() < item.raw->size();
+        s.data.assign(packed ? std::string_view{out} : std::string_view{*item.raw}); // no slack
+        s.packed = packed;
+        s.raw.reset();
+        _stored_bytes = _stored_bytes - item.raw->size() + s.data.size();
+      }
+    }
+    void wait() {
+      std::unique_lock<std::mutex> lk(_m);
+      _cv.wait(lk, [this] { return _inflight == 0; });
+    }
+
+  private:
+    util::worker_pool_t *_pool;
+    codec_t const *_codec;
+    compressed_store_options_t _opts;
+    mutable std::mutex _m{};
+    std::condition_variable _cv{};
+    std::vector<slot_t> _slots{};
+    std::vector<std::size_t> _free{};
+    std::vector<item_t> _batch{};
+    std::size_t _batch_bytes{};
+    std::size_t _inflight{};
+    std::uint64_t _raw_bytes{};
+    std::uint64_t _stored_bytes{};
+    std::size_t _count{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_CODEC_HH
@@ -15,6 +15,7 @@
 
 #include "detail/undo-if.hh"
 
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <tuple>
@@ -0,0 +1,147 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/6.
+//
+
+#ifndef UNDO_CXX_UNDO_COW_HH
+#define UNDO_CXX_UNDO_COW_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// ------------------- fixed_chunker_t
+namespace undo_cxx {
+
+  /**
+   * @brief splits a contiguous Document (std::string, std::vector, ...)
+   * into the chunks of N elements.
+   * @details A chunker tells cow_state_t how to take a Document apart
+   * and put it together again:
+   * @code{c++}
+   * struct my_chunker {
+   *   using chunk_type = ...;
+   *   static std::size_t count(Document const &doc);
+   *   // is the i-th chunk of doc equal to c? (without building it)
+   *   static bool equals(Document const &doc, std::size_t i, chunk_type const &c);
+   *   static chunk_type make(Document const &doc, std::size_t i);
+   *   static void append(Document &doc, chunk_type const &c);
+   * };
+   * @endcode
+   */
+  template<typename Document, std::size_t N = 4096>
+  struct fixed_chunker_t {
+    static_assert(N > 0, "fixed_chunker_t needs a positive chunk size");
+    using chunk_type = Document;
+
+    static std::size_t count(Document const &doc) { return (doc.size() + N - 1) / N; }
+    static bool equals(Document const &doc, std::size_t i, chunk_type const &c) {
+      auto first = doc.begin() + (std::ptrdiff_t) (i * N);
+      auto last = doc.begin() + (std::ptrdiff_t) std::min(doc.size(), (i + 1) * N);
+      return std::equal(first, last, c.begin(), c.end());
+    }
+    static chunk_type make(Document const &doc, std::size_t i) {
+      auto first = doc.begin() + (std::ptrdiff_t) (i * N);
+      auto last = doc.begin() + (std::ptrdiff_t) std::min(doc.size(), (i + 1) * N);
+      return chunk_type(first, last);
+    }
+    static void append(Document &doc, chunk_type const &c) { doc.insert(doc.end(), c.begin(), c.end()); }
+  };
+
+} // namespace undo_cxx
+
+// ------------------- cow_state_t
+namespace undo_cxx {
+
+  /**
+   * @brief a copy-on-write, structurally-shared snapshot of a Document.
+   * @tparam Document
+   * @tparam Chunker see also fixed_chunker_t
+   * @details Use it as the State of undoable_cmd_system_t. A snapshot
+   * is a vector of immutable, reference-counted chunks, so copying a
+   * cow_state_t copies the pointers only, and the consecutive
+   * snapshots share their unchanged chunks.
+   *
+   * A command takes the snapshot in save_state_impl() against the
+   * previous one, only the modified chunks are allocated:
+   * @code{c++}
+   * MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) override {
+   *   return std::make_unique&lt;Memento>(sender, State::snapshot(document, ctx.mgr.previous_state()));
+   * }
+   * @endcode
+   * Or edit a snapshot in place of the document with set().
+   */
+  template<typename Document, typename Chunker = fixed_chunker_t<Document>>
+  class cow_state_t {
+  public:
+    using document_type = Document;
+    using chunker = Chunker;
+    using chunk_type = typename Chunker::chunk_type;
+    using chunk_ptr = std::shared_ptr<chunk_type const>;
+
+    cow_state_t() = default;
+
+    /**
+     * @brief take a snapshot of doc, sharing the chunks which are
+     * unchanged since prev.
+     */
+    static cow_state_t snapshot(Document const &doc, cow_state_t const *prev = nullptr) {
+      cow_state_t s;
+      auto n = Chunker::count(doc);
+      s._chunks.reserve(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        if (prev && i < prev->size() && Chunker::equals(doc, i, *prev->_chunks[i]))
+          s._chunks.push_back(prev->_chunks[i]);
+        else
+          s._chunks.push_back(std::make_shared<chunk_type const>(Chunker::make(doc, i)));
+      }
+      return s;
+    }
+
+    /** @brief rebuild the document */
+    Document document() const {
+      Document doc{};
+      for (auto const &c : _chunks)
+        Chunker::append(doc, *c);
+      return doc;
+    }
+
+    /** @brief a new snapshot with the i-th chunk replaced, the others are shared */
+    cow_state_t set(std::size_t i, chunk_type c) const {
+      cow_state_t s{*this};
+      s._chunks[i] = std::make_shared<chunk_type const>(std::move(c));
+      return s;
+    }
+
+    std::size_t size() const { return _chunks.size(); }
+    bool empty() const { return _chunks.empty(); }
+    chunk_type const &chunk(std::size_t i) const { return *_chunks[i]; }
+    chunk_ptr const &chunk_ref(std::size_t i) const { return _chunks[i]; }
+
+    /** @brief how many chunks are shared with another snapshot */
+    std::size_t shared_with(cow_state_t const &o) const {
+      std::size_t n = 0;
+      for (std::size_t i = 0; i < size() && i < o.size(); ++i)
+        n += _chunks[i] == o._chunks[i] ? 1 : 0;
+      return n;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, cow_state_t const &o) {
+      return os << "cow{" << o.size() << " chunks}";
+    }
+
+  private:
+    std::vector<chunk_ptr> _chunks{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_COW_HH
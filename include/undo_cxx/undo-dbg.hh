@@ -11,7 +11,9 @@
 #ifndef UNDO_CXX_UNDO_DBG_HH
 #define UNDO_CXX_UNDO_DBG_HH
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace undo_cxx {
@@ -95,6 +95,19 @@ inline void UNUSED([[maybe_unused]] Args &&...args) {
   clz &operator=(clz &&) noexcept = delete
 #endif
 
+#ifndef UNDO_CXX_NO_UNIQUE_ADDRESS
+#if defined(_MSC_VER)
+#define UNDO_CXX_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#elif defined(__has_cpp_attribute)
+#if __has_cpp_attribute(no_unique_address)
+#define UNDO_CXX_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+#endif
+#ifndef UNDO_CXX_NO_UNIQUE_ADDRESS
+#define UNDO_CXX_NO_UNIQUE_ADDRESS
+#endif
+#endif
+
 ////////////////////////////////////////////////////////////////////////
 
 #include <stdlib.h>
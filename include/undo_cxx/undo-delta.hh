@@ -0,0 +1,98 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/5.
+//
+
+#ifndef UNDO_CXX_UNDO_DELTA_HH
+#define UNDO_CXX_UNDO_DELTA_HH
+
+#include "detail/undo-if.hh"
+
+#include <optional>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+// ------------------- patch_traits_t, delta_state_t
+namespace undo_cxx {
+
+  /**
+   * @brief how a Patch is applied to a Document.
+   * @details The default one calls `void Patch::apply(Document &) const`.
+   * Specialize it if your patch type is a plain structure or comes
+   * from a 3rd-party library.
+   */
+  template<typename Document, typename Patch>
+  struct patch_traits_t {
+    static void apply(Document &doc, Patch const &patch) { patch.apply(doc); }
+  };
+
+  /**
+   * @brief a delta memento: the forward/backward patches against the
+   * previous state, and optionally a full copy of the document (a
+   * keyframe).
+   * @tparam Document the full state of your originator
+   * @tparam Patch    the difference between two documents
+   * @details Use it as the State of undoable_cmd_system_t, so that a
+   * history of N edits holds N patches and a few keyframes rather
+   * than N documents.
+   *
+   * A command records a delta_state_t in its save_state_impl(). It
+   * should be a keyframe if `ctx.mgr.keyframe_due()` is true, so the
+   * cost of rebuilding a document is bounded by the keyframe interval
+   * (see history_traits_t). The manager rebuilds the document at any
+   * position by materialize(pos), and keeps the oldest entry a
+   * keyframe while it's evicting.
+   * @code{c++}
+   * MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) override {
+   *   State s{forward_patch, backward_patch};
+   *   if (ctx.mgr.keyframe_due())
+   *     s.keyframe = document;
+   *   return std::make_unique&lt;Memento>(sender, s);
+   * }
+   * @endcode
+   */
+  template<typename Document, typename Patch,
+           typename PatchTraits = patch_traits_t<Document, Patch>>
+  struct delta_state_t {
+    using document_type = Document;
+    using patch_type = Patch;
+    using patch_traits = PatchTraits;
+
+    /** @brief the previous document to this one */
+    Patch forward{};
+    /** @brief this document to the previous one */
+    Patch backward{};
+    /** @brief the full document after the command, if it's a keyframe */
+    std::optional<Document> keyframe{};
+
+    bool is_keyframe() const { return keyframe.has_value(); }
+    void apply_forward(Document &doc) const { patch_traits::apply(doc, forward); }
+    void apply_backward(Document &doc) const { patch_traits::apply(doc, backward); }
+
+    friend std::ostream &operator<<(std::ostream &os, delta_state_t const &o) {
+      if (o.is_keyframe())
+        os << "[keyframe] ";
+      if constexpr (traits::is_streamable<Patch>::value) {
+        return os << o.forward;
+      } else {
+        return os << "patch";
+      }
+    }
+  };
+
+  template<typename T>
+  struct is_delta_state : std::false_type {};
+  template<typename Document, typename Patch, typename PatchTraits>
+  struct is_delta_state<delta_state_t<Document, Patch, PatchTraits>> : std::true_type {};
+  template<typename T>
+  constexpr inline bool is_delta_state_v = is_delta_state<T>::value;
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_DELTA_HH
@@ -0,0 +1,242 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_UNDO_FOOTPRINT_HH
+#define UNDO_CXX_UNDO_FOOTPRINT_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ------------------- footprint_t
+namespace undo_cxx {
+
+  /**
+   * @brief the keys of the document a command reads and writes, see
+   * undoable_cmd_system_t::undo_entry().
+   * @details A key is anything the application identifies a part of
+   * its document by, in 64 bits: a paragraph id, a cell address, the
+   * hash of an object name, and so on. A command declares its
+   * footprint by a non-virtual hook:
+   * @code{c++}
+   * void footprint(undo_cxx::footprint_t &fp) const {
+   *   fp.read(_source_cell);
+   *   fp.write(_target_cell);
+   * }
+   * @endcode
+   */
+  struct footprint_t {
+    std::vector<std::uint64_t> reads{};
+    std::vector<std::uint64_t> writes{};
+
+    void read(std::uint64_t key) { reads.push_back(key); }
+    void write(std::uint64_t key) { writes.push_back(key); }
+  };
+
+} // namespace undo_cxx
+
+// ------------------- footprint_index_t
+namespace undo_cxx {
+
+  /**
+   * @brief the footprints of the history entries, indexed by the keys.
+   * @details The entries are identified by their addresses, and ordered
+   * by a sequence number given when they're inserted or activated. An
+   * entry E depends on an entry S if E comes later and reads or writes
+   * a key S writes. An opaque entry (one without a footprint) reads and
+   * writes everything.
+   *
+   * Each key keeps the sorted sequence numbers of the active entries
+   * touching it, so depends() is O(k) for k keys written by S (plus
+   * O(log n) for the opaque ones), rather than a scan over the later
+   * entries. The oldest and the newest numbers of a key are added and
+   * removed in O(1), so a capped history with a hot key doesn't pay
+   * O(n) per eviction.
+   */
+  class footprint_index_t {
+  public:
+    using seq_t = std::uint64_t;
+
+    /** @brief the number of the entries, the inactive ones included */
+    std::size_t size() const { return _entries.size(); }
+    bool contains(void const *id) const { return _entries.count(id) != 0; }
+    /** @brief the sequence number of id, 0 if it isn't there */
+    seq_t seq(void const *id) const {
+      auto it = _entries.find(id);
+      return it == _entries.end() ? 0 : it->second.seq;
+    }
+
+    /**
+     * @brief set the footprint of id, opaque if fp is nullptr. A new
+     * entry is active, after all the others; an existing one keeps
+     * its place.
+     */
+    void insert(void const *id, footprint_t const *fp) {
+      auto [it, fresh] = _entries.try_emplace(id);
+      auto &e = it->second;
+      if (!fresh && e.active)
+        unindex(e);
+      e.keys.clear();
+      e.writes = 0;
+      e.opaque = !fp;
+      if (fp) {
+        e.keys = fp->writes;
+        std::sort(e.keys.begin(), e.keys.end());
+        e.keys.erase(std::unique(e.keys.begin(), e.keys.end()), e.keys.end());
+        e.writes = e.keys.size();
+        for (auto k : fp->reads) {
+          if (!std::binary_search(e.keys.begin(), e.keys.begin() + (std::ptrdiff_t) e.writes, k))
+            e.keys.push_back(k);
+        }
+        std::sort(e.keys.begin() + (std::ptrdiff_t) e.writes, e.keys.end());
+        e.keys.erase(std::unique(e.keys.begin() + (std::ptrdiff_t) e.writes, e.keys.end()), e.keys.end());
+      }
+      if (fresh) {
+        e.seq = ++_clock;
+        e.active = true;
+        _active.insert(e.seq);
+      }
+      if (e.active)
+        index(e);
+    }
+    void erase(void const *id) {
+      auto it = _entries.find(id);
+      if (it == _entries.end())
+        return;
+      deactivate(it->second);
+      _entries.erase(it);
+    }
+    /** @brief an entry leaves the history for a while (a branch of the undo tree) */
+    void deactivate(void const *id) {
+      if (auto it = _entries.find(id); it != _entries.end())
+        deactivate(it->second);
+    }
+    /** @brief an entry (re)joins the history after all the others */
+    void activate(void const *id) {
+      auto it = _entries.find(id);
+      if (it == _entries.end() || it->second.active)
+        return;
+      auto &e = it->second;
+      e.seq = ++_clock;
+      e.active = true;
+      _active.insert(e.seq);
+      index(e);
+    }
+
+    /**
+     * @brief true if a later active entry depends on id, or id isn't
+     * there (an unknown entry is opaque).
+     */
+    bool depends(void const *id) const {
+      auto it = _entries.find(id);
+      if (it == _entries.end() || !it->second.active)
+        return true;
+      auto const &e = it->second;
+      if (e.opaque)
+        return *_active.rbegin() > e.seq;
+      if (!_opaque.empty() && *_opaque.rbegin() > e.seq)
+        return true;
+      for (std::size_t i = 0; i < e.writes; i++) {
+        if (_keys.find(e.keys[i])->second.back() > e.seq)
+          return true;
+      }
+      return false;
+    }
+
+    void clear() {
+      _entries.clear();
+      _keys.clear();
+      _active.clear();
+      _opaque.clear();
+    }
+
+  private:
+    struct entry_t {
+      seq_t seq{};
+      std::vector<std::uint64_t> keys{}; // the writes, then the reads
+      std::size_t writes{};
+      bool opaque{};
+      bool active{};
+    };
+
+    // the sorted sequence numbers of a key, in [head, end) of a vector:
+    // the oldest one is dropped by moving the head, and the dropped
+    // prefix is compacted once it's the larger half, so it's amortized
+    // O(1) at either end.
+    class seqs_t {
+    public:
+      bool empty() const { return _head == _v.size(); }
+      seq_t back() const { return _v.back(); }
+      void insert(seq_t s) {
+        if (empty() || _v.back() < s)
+          _v.push_back(s);
+        else
+          _v.insert(std::upper_bound(_v.begin() + (std::ptrdiff_t) _head, _v.end(), s), s);
+      }
+      void erase(seq_t s) {
+        if (_v[_head] == s)
+          _head++;
+        else if (_v.back() == s)
+          _v.pop_back();
+        else
+          _v.erase(std::lower_bound(_v.begin() + (std::ptrdiff_t) _head, _v.end(), s));
+        if (empty()) {
+          _v.clear();
+          _head = 0;
+        } else if (_head * 2 >= _v.size()) {
+          _v.erase(_v.begin(), _v.begin() + (std::ptrdiff_t) _head);
+          _head = 0;
+        }
+      }
+
+    private:
+      std::vector<seq_t> _v{};
+      std::size_t _head{};
+    };
+
+    void index(entry_t const &e) {
+      for (auto k : e.keys)
+        _keys[k].insert(e.seq);
+      if (e.opaque)
+        _opaque.insert(e.seq);
+    }
+    void unindex(entry_t const &e) {
+      for (auto k : e.keys) {
+        auto kt = _keys.find(k);
+        kt->second.erase(e.seq);
+        if (kt->second.empty())
+          _keys.erase(kt);
+      }
+      if (e.opaque)
+        _opaque.erase(e.seq);
+    }
+    void deactivate(entry_t &e) {
+      if (!e.active)
+        return;
+      unindex(e);
+      _active.erase(e.seq);
+      e.active = false;
+    }
+
+  private:
+    std::unordered_map<void const *, entry_t> _entries{};
+    std::unordered_map<std::uint64_t, seqs_t> _keys{};
+    std::set<seq_t> _active{};
+    std::set<seq_t> _opaque{};
+    seq_t _clock{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_FOOTPRINT_HH
@@ -0,0 +1,263 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_UNDO_INLINE_HH
+#define UNDO_CXX_UNDO_INLINE_HH
+
+#include "undo-ring.hh"
+#include "undo-value.hh"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// ------------------- inline_cmd_system_t
+namespace undo_cxx {
+
+  /**
+   * @brief an undo manager whose history entries hold the command and
+   * its memento inline: the command is type-erased in a small buffer of
+   * InlineBytes, and falls back to the heap if it doesn't fit.
+   * @tparam State the memento of a command, default constructible
+   * @tparam InlineBytes the room for a command in an entry
+   * @details The entries are kept in one contiguous util::ring_buffer_t,
+   * so recording a small command allocates nothing once the ring has
+   * grown (or has reached max_size()), and a scan of the history walks
+   * one block of memory. Compare undoable_cmd_system_t, where each
+   * command is a make_shared&lt;>() block and each memento a state_t
+   * with its own vector of pairs.
+   *
+   * The commands have the non-virtual hooks of variant_cmd_system_t,
+   * and the linear history is the same detail::value_history_t. Unlike
+   * it, the command set is open: any type with the hooks can be invoked.
+   * @code{c++}
+   * struct InsertCmd {
+   *   template&lt;typename C> void execute(C &ctx);
+   *   template&lt;typename C> State save_state(C &ctx) const;
+   *   template&lt;typename C> void undo(C &ctx, State &memento);
+   *   template&lt;typename C> void redo(C &ctx, State &memento);
+   *   bool can_be_memento() const; // optional
+   * };
+   * undo_cxx::inline_cmd_system_t&lt;State, 48> mgr;
+   * mgr.invoke&lt;InsertCmd>(...);
+   * @endcode
+   */
+  template<typename State, std::size_t InlineBytes = 64>
+  class inline_cmd_system_t : public detail::value_history_t<inline_cmd_system_t<State, InlineBytes>> {
+  public:
+    using StateT = State;
+    using size_type = std::size_t;
+    static constexpr std::size_t inline_bytes = InlineBytes;
+
+    static_assert(InlineBytes >= sizeof(void *), "the buffer holds a pointer at least");
+    static_assert(std::is_default_constructible_v<State>, "the memento is built in place");
+
+    struct ContextT {
+      inline_cmd_system_t &mgr;
+    };
+
+    /** @brief true if a T is stored inline */
+    template<typename T>
+    static constexpr bool fits = sizeof(T) <= InlineBytes && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<T>;
+
+  private:
+    // the type-erased operations of a command type
+    struct ops_t {
+      void (*undo)(void *buf, ContextT &ctx, StateT &s);
+      void (*redo)(void *buf, ContextT &ctx, StateT &s);
+      void (*move)(void *dst, void *src) noexcept;
+      void (*destroy)(void *buf) noexcept;
+      std::size_t heap_bytes;
+    };
+
+    template<typename T>
+    static T *cmd_of(void *buf) {
+      if constexpr (fits<T>)
+        return std::launder(reinterpret_cast<T *>(buf));
+      else
+        return *reinterpret_cast<T **>(buf);
+    }
+    template<typename T>
+    static ops_t const *ops_of() {
+      static constexpr ops_t ops{
+              [](void *buf, ContextT &ctx, StateT &s) { cmd_of<T>(buf)->undo(ctx, s); },
+              [](void *buf, ContextT &ctx, StateT &s) { cmd_of<T>(buf)->redo(ctx, s); },
+              [](void *dst, void *src) noexcept {
+                if constexpr (fits<T>)
+                  ::new (dst) T(std::move(*cmd_of<T>(src)));
+                else
+                  ::new (dst) T *(std::exchange(*reinterpret_cast<T **>(src), nullptr));
+              },
+              [](void *buf) noexcept {
+                if constexpr (fits<T>)
+                  cmd_of<T>(buf)->~T();
+                else
+                  delete *reinterpret_cast<T **>(buf);
+              },
+              fits<T> ? 0 : sizeof(T),
+      };
+      return &ops;
+    }
+
+  public:
+    /** @brief a history entry: the command, inline or on the heap, and its memento */
+    class entry_t {
+    public:
+      template<typename T, typename... Args>
+      explicit entry_t(std::in_place_type_t<T>, Args &&...args) {
+        if constexpr (fits<T>)
+          ::new (static_cast<void *>(_buf)) T{std::forward<Args>(args)...};
+        else
+          ::new (static_cast<void *>(_buf)) T *(new T{std::forward<Args>(args)...});
+        _ops = ops_of<T>();
+      }
+      ~entry_t() { _ops->destroy(_buf); }
+      entry_t(entry_t &&o) noexcept
+          : state(std::move(o.state))
+          , _ops(o._ops) { _ops->move(_buf, o._buf); }
+      entry_t &operator=(entry_t &&o) noexcept {
+        if (this != &o) {
+          _ops->destroy(_buf);
+          _ops = o._ops;
+          _ops->move(_buf, o._buf);
+          state = std::move(o.state);
+        }
+        return *this;
+      }
+      entry_t(entry_t const &) = delete;
+      entry_t &operator=(entry_t const &) = delete;
+
+      /** @brief the command if it's a T, or nullptr */
+      template<typename T>
+      T *command() { return _ops == ops_of<T>() ? cmd_of<T>(_buf) : nullptr; }
+      /** @brief false if the command is on the heap */
+      bool is_inline() const { return _ops->heap_bytes == 0; }
+
+      StateT state{};
+
+    private:
+      friend class inline_cmd_system_t;
+      ops_t const *_ops;
+      alignas(std::max_align_t) unsigned char _buf[InlineBytes];
+    };
+    using Container = util::ring_buffer_t<entry_t>;
+
+  private:
+    friend class detail::value_history_t<inline_cmd_system_t>;
+
+  public:
+    inline_cmd_system_t() = default;
+    ~inline_cmd_system_t() = default;
+    inline_cmd_system_t(inline_cmd_system_t const &) = delete;
+    inline_cmd_system_t &operator=(inline_cmd_system_t const &) = delete;
+
+    /**
+     * @brief construct a ConcreteCmd in a new entry, and invoke it.
+     * @details The entry is built, executed and saved aside, then the
+     * redo tail is discarded and the entry is moved into the history,
+     * which may evict the oldest one of a full history. The ring makes
+     * room for it before the command runs, so a command that throws
+     * leaves the history unchanged. A command whose can_be_memento() is
+     * false isn't recorded.
+     */
+    template<typename ConcreteCmd, typename... Args>
+    void invoke(Args &&...args) {
+      if constexpr (traits::has_can_be_memento_v<ConcreteCmd>) {
+        ConcreteCmd cmd{std::forward<Args>(args)...};
+        if (!cmd.can_be_memento()) {
+          cmd.execute(_ctx);
+          return;
+        }
+        record<ConcreteCmd>(std::move(cmd));
+      } else {
+        record<ConcreteCmd>(std::forward<Args>(args)...);
+      }
+    }
+
+    /** @brief the statistics of the history */
+    struct counters_t {
+      size_type entries;
+      /** @brief the entries whose command is on the heap */
+      size_type spilled;
+      /** @brief the ring of entries plus the commands on the heap */
+      std::size_t bytes;
+    };
+    counters_t counters() const {
+      return {this->size(), _spilled, _history.capacity() * sizeof(entry_t) + _heap_bytes};
+    }
+
+    using detail::value_history_t<inline_cmd_system_t>::max_size;
+    /** @brief bound the history, the oldest entries are evicted in O(1) */
+    void max_size(size_type max_value) {
+      auto keep = max_value ? max_value : 1;
+      auto dropped = _history.size() > keep ? _history.size() - keep : 0;
+      for (size_type i = 0; i < dropped; i++)
+        forget(_history[i]);
+      _history.max_size(max_value);
+      _cursor = _cursor > dropped ? _cursor - dropped : 0;
+    }
+
+    void clear() {
+      _history.clear();
+      _cursor = 0;
+      _spilled = 0;
+      _heap_bytes = 0;
+    }
+
+  private:
+    void undo_entry(entry_t &e) { e._ops->undo(e._buf, _ctx, e.state); }
+    void redo_entry(entry_t &e) { e._ops->redo(e._buf, _ctx, e.state); }
+
+    template<typename T, typename... Args>
+    void record(Args &&...args) {
+      // the growth is the only step which may throw after the command
+      // has run, take it first
+      if (_cursor == _history.capacity())
+        _history.reserve(_cursor ? _cursor * 2 : 8);
+      entry_t aside{std::in_place_type<T>, std::forward<Args>(args)...};
+      auto *cmd = cmd_of<T>(aside._buf);
+      cmd->execute(_ctx);
+      aside.state = std::as_const(*cmd).save_state(_ctx);
+
+      while (_history.size() > _cursor) {
+        forget(_history.back());
+        _history.pop_back();
+      }
+      if (_history.full() && !_history.empty()) {
+        forget(_history.front());
+        --_cursor;
+      }
+      auto &e = _history.emplace_back(std::move(aside));
+      if (!e.is_inline()) {
+        _spilled++;
+        _heap_bytes += e._ops->heap_bytes;
+      }
+      _cursor = _history.size();
+    }
+    // an entry is going to be removed
+    void forget(entry_t const &e) {
+      if (!e.is_inline()) {
+        _spilled--;
+        _heap_bytes -= e._ops->heap_bytes;
+      }
+    }
+
+  private:
+    Container _history{};
+    size_type _cursor{};
+    size_type _spilled{};
+    std::size_t _heap_bytes{};
+    ContextT _ctx{*this};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_INLINE_HH
@@ -0,0 +1,183 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/8.
+//
+
+#ifndef UNDO_CXX_UNDO_INTRUSIVE_HH
+#define UNDO_CXX_UNDO_INTRUSIVE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// ------------------- ref count policies
+namespace undo_cxx {
+
+  /** @brief a plain counter, for the commands used by one thread only */
+  struct single_thread_ref_count_t {
+    using counter_type = std::uint32_t;
+    static void add_ref(counter_type &c) { ++c; }
+    /** @return true if it's the last reference */
+    static bool release(counter_type &c) { return --c == 0; }
+    static std::size_t load(counter_type const &c) { return c; }
+  };
+
+  /** @brief an atomic counter */
+  struct multi_thread_ref_count_t {
+    using counter_type = std::atomic<std::uint32_t>;
+    static void add_ref(counter_type &c) { c.fetch_add(1, std::memory_order_relaxed); }
+    static bool release(counter_type &c) { return c.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    static std::size_t load(counter_type const &c) { return c.load(std::memory_order_relaxed); }
+  };
+
+} // namespace undo_cxx
+
+// ------------------- intrusive_ptr
+namespace undo_cxx {
+
+  /**
+   * @brief a smart pointer to an object which holds its own reference
+   * count, found by ADL: `intrusive_ptr_add_ref(T *)` and
+   * `intrusive_ptr_release(T *)`.
+   * @details It's a pointer in size, and copying it touches the
+   * counter inside the object only.
+   */
+  template<typename T>
+  class intrusive_ptr {
+  public:
+    using element_type = T;
+
+    intrusive_ptr() = default;
+    intrusive_ptr(std::nullptr_t) {}
+    explicit intrusive_ptr(T *p, bool add_ref = true)
+        : _p(p) {
+      if (_p && add_ref) intrusive_ptr_add_ref(_p);
+    }
+    intrusive_ptr(intrusive_ptr const &o)
+        : _p(o._p) {
+      if (_p) intrusive_ptr_add_ref(_p);
+    }
+    intrusive_ptr(intrusive_ptr &&o) noexcept
+        : _p(std::exchange(o._p, nullptr)) {}
+    template<typename U, std::enable_if_t<std::is_convertible_v<U *, T *>, int> = 0>
+    intrusive_ptr(intrusive_ptr<U> const &o)
+        : _p(o.get()) {
+      if (_p) intrusive_ptr_add_ref(_p);
+    }
+    template<typename U, std::enable_if_t<std::is_convertible_v<U *, T *>, int> = 0>
+    intrusive_ptr(intrusive_ptr<U> &&o) noexcept
+        : _p(o.detach()) {}
+    ~intrusive_ptr() {
+      if (_p) intrusive_ptr_release(_p);
+    }
+
+    intrusive_ptr &operator=(intrusive_ptr o) noexcept {
+      swap(o);
+      return *this;
+    }
+
+    void reset() { intrusive_ptr{}.swap(*this); }
+    void reset(T *p) { intrusive_ptr{p}.swap(*this); }
+    void swap(intrusive_ptr &o) noexcept { std::swap(_p, o._p); }
+    /** @brief give up the ownership without releasing it */
+    T *detach() noexcept { return std::exchange(_p, nullptr); }
+
+    T *get() const { return _p; }
+    T &operator*() const { return *_p; }
+    T *operator->() const { return _p; }
+    explicit operator bool() const { return _p != nullptr; }
+
+    template<typename U>
+    friend bool operator==(intrusive_ptr const &a, intrusive_ptr<U> const &b) { return a.get() == b.get(); }
+    template<typename U>
+    friend bool operator!=(intrusive_ptr const &a, intrusive_ptr<U> const &b) { return a.get() != b.get(); }
+    friend bool operator==(intrusive_ptr const &a, std::nullptr_t) { return !a; }
+    friend bool operator!=(intrusive_ptr const &a, std::nullptr_t) { return !!a; }
+    friend bool operator<(intrusive_ptr const &a, intrusive_ptr const &b) { return std::less<T *>{}(a.get(), b.get()); }
+
+  private:
+    T *_p{};
+  };
+
+  template<typename T, typename... Args>
+  inline intrusive_ptr<T> make_intrusive(Args &&...args) {
+    return intrusive_ptr<T>{new T(std::forward<Args>(args)...)};
+  }
+
+} // namespace undo_cxx
+
+template<typename T>
+struct std::hash<undo_cxx::intrusive_ptr<T>> {
+  std::size_t operator()(undo_cxx::intrusive_ptr<T> const &p) const { return std::hash<T *>{}(p.get()); }
+};
+
+// ------------------- intrusive_base_cmd_t
+namespace undo_cxx {
+
+  /**
+   * @brief the base class of the commands with an intrusive reference
+   * count. Use it as the BaseCmdT of undoable_cmd_system_t, and the
+   * CmdSP of the whole system becomes intrusive_ptr.
+   * @tparam Policy single_thread_ref_count_t or multi_thread_ref_count_t
+   * @details See also intrusive_cmd_system_t.
+   */
+  template<typename Policy = multi_thread_ref_count_t>
+  class intrusive_base_cmd_t {
+  public:
+    using ref_count_policy = Policy;
+
+    virtual ~intrusive_base_cmd_t() = default;
+    intrusive_base_cmd_t() = default;
+    // a copy is a new object, with no references yet
+    intrusive_base_cmd_t(intrusive_base_cmd_t const &) {}
+    intrusive_base_cmd_t &operator=(intrusive_base_cmd_t const &) { return *this; }
+
+    std::size_t use_count() const { return Policy::load(_refs); }
+
+    friend void intrusive_ptr_add_ref(intrusive_base_cmd_t const *p) { Policy::add_ref(p->_refs); }
+    friend void intrusive_ptr_release(intrusive_base_cmd_t const *p) {
+      if (Policy::release(p->_refs))
+        delete p;
+    }
+
+  private:
+    mutable typename Policy::counter_type _refs{0};
+  };
+
+  /**
+   * @brief how a command is held, by BaseCmdT: std::shared_ptr by
+   * default, or intrusive_ptr if BaseCmdT has a ref_count_policy.
+   */
+  template<typename BaseCmdT, typename = void>
+  struct cmd_handle_traits_t {
+    /** @brief true if the handles may be copied and released on any thread */
+    static constexpr bool thread_safe = true;
+    template<typename T>
+    using handle = std::shared_ptr<T>;
+    template<typename T, typename... Args>
+    static handle<T> make(Args &&...args) { return std::make_shared<T>(std::forward<Args>(args)...); }
+  };
+  template<typename BaseCmdT>
+  struct cmd_handle_traits_t<BaseCmdT, std::void_t<typename BaseCmdT::ref_count_policy>> {
+    static constexpr bool thread_safe = std::is_same_v<typename BaseCmdT::ref_count_policy, multi_thread_ref_count_t>;
+    template<typename T>
+    using handle = intrusive_ptr<T>;
+    template<typename T, typename... Args>
+    static handle<T> make(Args &&...args) { return make_intrusive<T>(std::forward<Args>(args)...); }
+  };
+
+  template<typename BaseCmdT, typename T>
+  using cmd_handle_t = typename cmd_handle_traits_t<BaseCmdT>::template handle<T>;
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_INTRUSIVE_HH
@@ -0,0 +1,332 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/11.
+//
+
+#ifndef UNDO_CXX_UNDO_JOURNAL_HH
+#define UNDO_CXX_UNDO_JOURNAL_HH
+
+#include "undo-tier.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ------------------- journal_t
+namespace undo_cxx {
+
+  struct journal_options_t {
+    /** @brief the records are buffered and written in groups of this size */
+    std::size_t group_bytes{64 * 1024};
+    /** @brief fsync after writing each group; or only by commit() and on close */
+    bool fsync_groups{false};
+  };
+
+  /**
+   * @brief an append-only, write-ahead journal of an undo history.
+   * @tparam State the state of the mementos, written by state_serializer_t
+   * @details Attach it to a manager by `mgr.journal(&j)`. Each saved
+   * memento is appended as a length-prefixed, checksummed record of
+   * its states, and the cursor movements, erase(), clear(), the
+   * evictions and the limit changes as tiny records. The records are buffered and
+   * written in groups (see journal_options_t), commit() writes and
+   * fsyncs the buffered ones, e.g. at the idle time of the app.
+   *
+   * On restart, `mgr.replay(j)` rebuilds the history from the journal
+   * by mmapping it. A torn or corrupted tail (from a crash) is cut
+   * off. The replayed mementos carry no commands, only the states.
+   * @code{c++}
+   * undo_cxx::journal_t&lt;State> j{"doc.journal"};
+   * M mgr;
+   * mgr.replay(j);       // the history of the last session
+   * mgr.journal(&j);     // and continue to write it
+   * @endcode
+   * The records are in the native byte order.
+   */
+  template<typename State>
+  class journal_t {
+  public:
+    using serializer = state_serializer_t<State>;
+    static constexpr std::size_t header_size = 9; // u32 length, u32 checksum, u8 type
+
+    explicit journal_t(std::filesystem::path path, journal_options_t opts = {})
+        : _path(std::move(path))
+        , _opts(opts) {
+      _file = std::fopen(_path.string().c_str(), "ab");
+      if (!_file)
+        throw std::runtime_error("can't open the journal: " + _path.string());
+    }
+    ~journal_t() {
+      try {
+        commit();
+      } catch (...) {
+        // a destructor must not throw, call commit() first to see the errors
+      }
+      std::fclose(_file);
+    }
+    journal_t(journal_t const &) = delete;
+    journal_t &operator=(journal_t const &) = delete;
+
+    template<typename Memento>
+    void save(Memento const &m) {
+      auto at = begin_record(journal_event_t::save);
+      std::uint32_t count = 0;
+      auto count_at = _buf.size();
+      put(count);
+      m.for_each_state([this, &count](State const &s) {
+        auto len_at = _buf.size();
+        put(std::uint32_t{});
+        serializer::write(_buf, s);
+        auto len = (std::uint32_t) (_buf.size() - len_at - sizeof(std::uint32_t));
+        std::memcpy(&_buf[len_at], &len, sizeof(len));
+        count++;
+      });
+      std::memcpy(&_buf[count_at], &count, sizeof(count));
+      end_record(at);
+    }
+    void cursor(std::uint64_t pos) { record(journal_event_t::cursor, pos); }
+    void erase(std::uint64_t n) { record(journal_event_t::erase, n); }
+    void clear() {
+      auto at = begin_record(journal_event_t::clear);
+      end_record(at);
+    }
+    void limits(std::uint64_t max_size, std::uint64_t max_bytes) { record(journal_event_t::limits, max_size, max_bytes); }
+    void evict(std::uint64_t n) { record(journal_event_t::evict, n); }
+
+    /**
+     * @brief write the buffered records, and fsync them.
+     * @details It throws std::runtime_error if the journal can't be
+     * written or synced. The destructor commits as well, but swallows
+     * the errors.
+     */
+    void commit() {
+      flush();
+      sync();
+    }
+
+    /**
+     * @brief read the journal from the beginning.
+     * @param fn `fn(journal_event_t e, std::uint64_t a, std::uint64_t b, std::unique_ptr<Memento> m)`,
+     * m is for journal_event_t::save only, a and b are the arguments of the others.
+     * @return the number of the valid records; the ones after them are cut off.
+     */
+    template<typename Memento, typename Fn>
+    std::size_t read(Fn &&fn) {
+      commit();
+      mapped_t file{_path};
+      std::string_view data = file.view();
+      std::size_t off = 0, n = 0;
+      while (off + header_size <= data.size()) {
+        std::uint32_t len, sum;
+        std::memcpy(&len, data.data() + off, sizeof(len));
+        std::memcpy(&sum, data.data() + off + 4, sizeof(sum));
+        if (off + header_size + len > data.size())
+          break; // torn
+        auto body = data.substr(off + 8, len + 1);
+        if (checksum(body) != sum || !decode<Memento>(body, fn))
+          break; // corrupted
+        off += header_size + len;
+        n++;
+      }
+      if (off < data.size()) {
+        file.close();
+        std::filesystem::resize_file(_path, off);
+      }
+      return n;
+    }
+
+    std::filesystem::path const &path() const { return _path; }
+    /** @brief the bytes appended by this object, including the buffered ones */
+    std::uint64_t bytes() const { return _written + _buf.size(); }
+    std::uint64_t records() const { return _records; }
+
+  private:
+    std::size_t begin_record(journal_event_t e) {
+      auto at = _buf.size();
+      _buf.append(header_size - 1, '\0');
+      _buf.push_back((char) e);
+      return at;
+    }
+    void end_record(std::size_t at) {
+      auto len = (std::uint32_t) (_buf.size() - at - header_size);
+      auto sum = checksum(std::string_view{_buf}.substr(at + 8));
+      std::memcpy(&_buf[at], &len, sizeof(len));
+      std::memcpy(&_buf[at + 4], &sum, sizeof(sum));
+      _records++;
+      if (_buf.size() >= _opts.group_bytes) {
+        flush();
+        if (_opts.fsync_groups)
+          sync();
+      }
+    }
+    template<typename... Args>
+    void record(journal_event_t e, Args... args) {
+      auto at = begin_record(e);
+      (put(args), ...);
+      end_record(at);
+    }
+    template<typename T>
+    void put(T v) { _buf.append(reinterpret_cast<char const *>(&v), sizeof(v)); }
+    template<typename T>
+    static bool get(std::string_view &in, T &v) {
+      if (in.size() < sizeof(T)) return false;
+      std::memcpy(&v, in.data(), sizeof(T));
+      in.remove_prefix(sizeof(T));
+      return true;
+    }
+
+    // FNV-1a
+    static std::uint32_t checksum(std::string_view s) {
+      std::uint32_t h = 2166136261u;
+      for (auto c : s)
+        h = (h ^ (std::uint8_t) c) * 16777619u;
+      return h;
+    }
+
+    template<typename Memento, typename Fn>
+    static bool decode(std::string_view body, Fn &fn) {
+      auto e = (journal_event_t) body[0];
+      body.remove_prefix(1);
+      std::uint64_t a{}, b{};
+      switch (e) {
+        case journal_event_t::save: {
+          std::uint32_t count{};
+          if (!get(body, count) || count == 0) return false;
+          auto m = std::make_unique<Memento>();
+          typename Memento::CmdSP none{};
+          for (std::uint32_t i = 0; i < count; i++) {
+            std::uint32_t len{};
+            State s{};
+            if (!get(body, len) || body.size() < len || !serializer::read(body.substr(0, len), s))
+              return false;
+            body.remove_prefix(len);
+            m->emplace_back(none, std::move(s));
+          }
+          fn(e, a, b, std::move(m));
+          return true;
+        }
+        case journal_event_t::cursor:
+        case journal_event_t::erase:
+        case journal_event_t::evict:
+          if (!get(body, a)) return false;
+          break;
+        case journal_event_t::clear:
+          break;
+        case journal_event_t::limits:
+          if (!get(body, a) || !get(body, b)) return false;
+          break;
+        default:
+          return false;
+      }
+      fn(e, a, b, std::unique_ptr<Memento>{});
+      return true;
+    }
+
+    void flush() {
+      if (_buf.empty()) return;
+      if (std::fwrite(_buf.data(), 1, _buf.size(), _file) != _buf.size() || std::fflush(_file) != 0) {
+        std::clearerr(_file);
+        throw std::runtime_error("can't write the journal: " + _path.string());
+      }
+      _written += _buf.size();
+      _buf.clear();
+    }
+    void sync() {
+#if defined(_WIN32)
+      auto rc = ::_commit(::_fileno(_file));
+#else
+      auto rc = ::fsync(::fileno(_file));
+#endif
+      if (rc != 0)
+        throw std::runtime_error("can't sync the journal: " + _path.string());
+    }
+
+    // a read-only view of the whole file, mmapped where possible
+    class mapped_t {
+    public:
+      explicit mapped_t(std::filesystem::path const &path) {
+#if defined(_WIN32)
+        if (auto *f = std::fopen(path.string().c_str(), "rb")) {
+          char chunk[64 * 1024];
+          for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), f)) > 0;)
+            _copy.append(chunk, n);
+          std::fclose(f);
+        }
+        _data = _copy.data();
+        _size = _copy.size();
+#else
+        _fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st {};
+        if (_fd >= 0 && ::fstat(_fd, &st) == 0 && st.st_size > 0) {
+          _size = (std::size_t) st.st_size;
+          auto *p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+          if (p == MAP_FAILED)
+            _size = 0;
+          else {
+            _data = static_cast<char const *>(p);
+            ::madvise(p, _size, MADV_SEQUENTIAL);
+          }
+        }
+#endif
+      }
+      ~mapped_t() { close(); }
+      mapped_t(mapped_t const &) = delete;
+      mapped_t &operator=(mapped_t const &) = delete;
+
+      std::string_view view() const { return {_data, _size}; }
+      void close() {
+#if !defined(_WIN32)
+        if (_data)
+          ::munmap(const_cast<char *>(_data), _size);
+        if (_fd >= 0)
+          ::close(_fd);
+        _fd = -1;
+#endif
+        _data = nullptr;
+        _size = 0;
+      }
+
+    private:
+      char const *_data{};
+      std::size_t _size{};
+#if defined(_WIN32)
+      std::string _copy{};
+#else
+      int _fd{-1};
+#endif
+    };
+
+  private:
+    std::filesystem::path _path;
+    journal_options_t _opts;
+    std::FILE *_file{};
+    std::string _buf{};
+    std::uint64_t _written{};
+    std::uint64_t _records{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_JOURNAL_HH
@@ -0,0 +1,314 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/9.
+//
+
+#ifndef UNDO_CXX_UNDO_MPSC_HH
+#define UNDO_CXX_UNDO_MPSC_HH
+
+#include "undo-intrusive.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// ------------------- mpsc_queue_t
+namespace undo_cxx::util {
+
+  /**
+   * @brief an unbounded, lock-free, multi-producer single-consumer
+   * queue (the intrusive node-based one by Dmitry Vyukov).
+   * @details push() is wait-free: one atomic exchange and one store.
+   * pop() must be called by one consumer thread at a time. pop() may
+   * miss an element whose push() is still in progress, it's seen by
+   * the next pop() once the producer returns.
+   */
+  template<typename T>
+  class mpsc_queue_t {
+    struct node_t {
+      std::atomic<node_t *> next{nullptr};
+      T value{};
+    };
+
+  public:
+    mpsc_queue_t()
+        : _head(&_stub)
+        , _tail(&_stub) {}
+    ~mpsc_queue_t() {
+      T value{};
+      while (pop(value)) {}
+    }
+    mpsc_queue_t(mpsc_queue_t const &) = delete;
+    mpsc_queue_t &operator=(mpsc_queue_t const &) = delete;
+
+    void push(T value) {
+      auto *n = new node_t{};
+      n->value = std::move(value);
+      link(n);
+    }
+
+    /** @brief by the consumer only */
+    bool pop(T &value) {
+      node_t *tail = _tail;
+      node_t *next = tail->next.load(std::memory_order_acquire);
+      if (tail == &_stub) {
+        if (!next) return false;
+        _tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+      }
+      if (next) {
+        _tail = next;
+        value = std::move(tail->value);
+        delete tail;
+        return true;
+      }
+      if (tail != _head.load(std::memory_order_acquire))
+        return false; // a push() is in progress
+      link(&_stub);
+      next = tail->next.load(std::memory_order_acquire);
+      if (next) {
+        _tail = next;
+        value = std::move(tail->value);
+        delete tail;
+        return true;
+      }
+      return false;
+    }
+
+    /** @brief a hint, exact for the consumer if no push() is in progress */
+    bool empty() const {
+      return _tail == _head.load(std::memory_order_seq_cst) && _tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+  private:
+    void link(node_t *n) {
+      n->next.store(nullptr, std::memory_order_relaxed);
+      node_t *prev = _head.exchange(n, std::memory_order_seq_cst);
+      prev->next.store(n, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<node_t *> _head;
+    node_t *_tail; // by the consumer only
+    node_t _stub{};
+  };
+
+} // namespace undo_cxx::util
+
+// ------------------- completion_t
+namespace undo_cxx {
+
+  /**
+   * @brief a handle to wait for a command submitted to a cmd_queue_t.
+   * @details An empty handle (from cmd_queue_t::post()) is always done.
+   */
+  class completion_t {
+    struct shared_t {
+      std::atomic<bool> done{false};
+      std::exception_ptr error{};
+      std::mutex m{};
+      std::condition_variable cv{};
+    };
+
+  public:
+    completion_t() = default;
+
+    bool valid() const { return _state != nullptr; }
+    bool done() const { return !_state || _state->done.load(std::memory_order_acquire); }
+    /** @brief blocks until the command has been executed and saved */
+    void wait() const {
+      if (done()) return;
+      std::unique_lock<std::mutex> lk(_state->m);
+      _state->cv.wait(lk, [this] { return _state->done.load(std::memory_order_acquire); });
+    }
+    /** @brief wait(), and rethrow the exception from the command, if any */
+    void get() const {
+      wait();
+      if (_state && _state->error)
+        std::rethrow_exception(_state->error);
+    }
+
+  private:
+    template<typename Mgr>
+    friend class cmd_queue_t;
+
+    static completion_t make() {
+      completion_t c;
+      c._state = std::make_shared<shared_t>();
+      return c;
+    }
+    void complete(std::exception_ptr error) const {
+      if (!_state) return;
+      _state->error = std::move(error);
+      {
+        std::lock_guard<std::mutex> lk(_state->m);
+        _state->done.store(true, std::memory_order_release);
+      }
+      _state->cv.notify_all();
+    }
+
+  private:
+    std::shared_ptr<shared_t> _state{};
+  };
+
+} // namespace undo_cxx
+
+// ------------------- cmd_queue_t
+namespace undo_cxx {
+
+  /**
+   * @brief a concurrent front end of an undo manager: any thread
+   * pushes the commands into a lock-free queue, and one applier runs
+   * `mgr.invoke(cmd)` (execute and save) for them in order.
+   * @tparam Mgr undoable_cmd_system_t<...>
+   * @details The applier is a background thread owned by the queue, or,
+   * with `cmd_queue_t(mgr, false)`, whichever thread calls drain().
+   * The manager must not be touched by the other threads while the
+   * queue is running; inspect it in a command, or after stop().
+   * @code{c++}
+   * M mgr;
+   * undo_cxx::cmd_queue_t<M> q{mgr};
+   * // on any thread:
+   * q.post(cmd);
+   * auto done = q.submit<FontStyleCmdT>("italic");
+   * done.wait();
+   * @endcode
+   * The commands are created on the producer threads, so they aren't
+   * allocated from the (unsynchronized) arena of the manager; and they're
+   * released on the applier, so they must be held by std::shared_ptr or
+   * counted by multi_thread_ref_count_t.
+   */
+  template<typename Mgr>
+  class cmd_queue_t {
+  public:
+    using CmdSP = typename Mgr::CmdSP;
+    using BaseCmdT = typename Mgr::ContextT::BaseCmdT;
+    // the commands are handed over between the threads
+    static_assert(cmd_handle_traits_t<BaseCmdT>::thread_safe,
+                  "cmd_queue_t needs std::shared_ptr or multi_thread_ref_count_t commands");
+
+    explicit cmd_queue_t(Mgr &mgr, bool start_applier = true)
+        : _mgr(mgr) {
+      if (start_applier)
+        _applier = std::thread([this] { run(); });
+    }
+    ~cmd_queue_t() { stop(); }
+    cmd_queue_t(cmd_queue_t const &) = delete;
+    cmd_queue_t &operator=(cmd_queue_t const &) = delete;
+
+    /** @brief queue a command, fire and forget */
+    void post(CmdSP cmd) { enqueue(std::move(cmd), completion_t{}); }
+    /** @brief queue a command, and get a handle to wait for it */
+    completion_t submit(CmdSP cmd) {
+      auto c = completion_t::make();
+      enqueue(std::move(cmd), c);
+      return c;
+    }
+    template<typename ConcreteCmd, typename... Args>
+    completion_t submit(Args &&...args) {
+      return submit(CmdSP{cmd_handle_traits_t<BaseCmdT>::template make<ConcreteCmd>(std::forward<Args>(args)...)});
+    }
+
+    /**
+     * @brief apply the queued commands on this thread, for a queue
+     * without the applier thread.
+     * @return the number of commands applied
+     */
+    std::size_t drain() {
+      std::size_t n = 0;
+      item_t item;
+      while (_queue.pop(item)) {
+        apply(item);
+        n++;
+      }
+      return n;
+    }
+
+    /** @brief apply the pending commands and stop the applier thread */
+    void stop() {
+      if (_applier.joinable()) {
+        {
+          std::lock_guard<std::mutex> lk(_m);
+          _stopping.store(true, std::memory_order_seq_cst);
+        }
+        _cv.notify_one();
+        _applier.join();
+      }
+      drain();
+    }
+
+    /** @brief the number of commands applied so far */
+    std::size_t applied() const { return _applied.load(std::memory_order_relaxed); }
+    Mgr &manager() { return _mgr; }
+
+  private:
+    struct item_t {
+      CmdSP cmd{};
+      completion_t done{};
+    };
+
+    void enqueue(CmdSP &&cmd, completion_t c) {
+      _queue.push(item_t{std::move(cmd), std::move(c)});
+      // the exchange in push() and the load below pair with the store
+      // and the empty() in run(), all seq_cst: either the applier sees
+      // this item before it sleeps, or we see it sleeping.
+      if (_sleeping.load(std::memory_order_seq_cst)) {
+        { std::lock_guard<std::mutex> lk(_m); }
+        _cv.notify_one();
+      }
+    }
+
+    void apply(item_t &item) {
+      std::exception_ptr error{};
+      try {
+        _mgr.invoke(item.cmd);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      _applied.fetch_add(1, std::memory_order_relaxed);
+      item.done.complete(std::move(error));
+    }
+
+    void run() {
+      static constexpr int spins = 64;
+      for (;;) {
+        for (int i = 0; i < spins; i++) {
+          if (drain())
+            i = 0;
+          else
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lk(_m);
+        _sleeping.store(true, std::memory_order_seq_cst);
+        _cv.wait(lk, [this] { return !_queue.empty() || _stopping.load(std::memory_order_seq_cst); });
+        _sleeping.store(false, std::memory_order_relaxed);
+        if (_stopping.load(std::memory_order_seq_cst) && _queue.empty())
+          break;
+      }
+    }
+
+  private:
+    Mgr &_mgr;
+    util::mpsc_queue_t<item_t> _queue{};
+    std::atomic<std::size_t> _applied{0};
+    std::atomic<bool> _sleeping{false};
+    std::atomic<bool> _stopping{false};
+    std::mutex _m{};
+    std::condition_variable _cv{};
+    std::thread _applier{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_MPSC_HH
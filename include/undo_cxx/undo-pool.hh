@@ -0,0 +1,266 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/10.
+//
+
+#ifndef UNDO_CXX_UNDO_POOL_HH
+#define UNDO_CXX_UNDO_POOL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ------------------- worker_pool_t
+namespace undo_cxx::util {
+
+  /**
+   * @brief a fixed set of worker threads running the submitted tasks
+   * in FIFO order.
+   * @details The destructor runs the pending tasks and joins the
+   * workers. A pool can be shared by many managers.
+   */
+  class worker_pool_t {
+  public:
+    using task_t = std::function<void()>;
+
+    explicit worker_pool_t(std::size_t n = std::max(1u, std::thread::hardware_concurrency())) {
+      _workers.reserve(n);
+      for (std::size_t i = 0; i < n; i++)
+        _workers.emplace_back([this] { run(); });
+    }
+    ~worker_pool_t() {
+      {
+        std::lock_guard<std::mutex> lk(_m);
+        _stopping = true;
+      }
+      _cv.notify_all();
+      for (auto &t : _workers)
+        t.join();
+    }
+    worker_pool_t(worker_pool_t const &) = delete;
+    worker_pool_t &operator=(worker_pool_t const &) = delete;
+
+    void submit(task_t task) {
+      {
+        std::lock_guard<std::mutex> lk(_m);
+        _tasks.push_back(std::move(task));
+      }
+      _cv.notify_one();
+    }
+
+    std::size_t size() const { return _workers.size(); }
+
+  private:
+    void run() {
+      for (;;) {
+        task_t task;
+        {
+          std::unique_lock<std::mutex> lk(_m);
+          _cv.wait(lk, [this] { return _stopping || !_tasks.empty(); });
+          if (_tasks.empty())
+            return;
+          task = std::move(_tasks.front());
+          _tasks.pop_front();
+        }
+        task();
+      }
+    }
+
+  private:
+    std::mutex _m{};
+    std::condition_variable _cv{};
+    std::deque<task_t> _tasks{};
+    bool _stopping{false};
+    std::vector<std::thread> _workers{};
+  };
+
+} // namespace undo_cxx::util
+
+// ------------------- stealing_pool_t
+namespace undo_cxx::util {
+
+  /**
+   * @brief a fixed set of worker threads, each with its own deque of
+   * tasks; an idle worker steals from the others.
+   * @details A worker takes its own tasks newest first, and steals the
+   * oldest ones of the others, so a parallel_for() spread over the
+   * deques keeps every worker busy until the whole range is done. The
+   * caller of parallel_for() works on the range too, rather than
+   * waiting for it.
+   * @code{c++}
+   * undo_cxx::util::stealing_pool_t pool{8};
+   * pool.parallel_for(objects.size(), [&](std::size_t i) { objects[i].apply(style); });
+   * @endcode
+   */
+  class stealing_pool_t {
+  public:
+    using task_t = std::function<void()>;
+
+    explicit stealing_pool_t(std::size_t n = std::max(1u, std::thread::hardware_concurrency())) {
+      n = std::max<std::size_t>(n, 1);
+      _queues.reserve(n);
+      for (std::size_t i = 0; i < n; i++)
+        _queues.emplace_back(std::make_unique<queue_t>());
+      _workers.reserve(n);
+      for (std::size_t i = 0; i < n; i++)
+        _workers.emplace_back([this, i] { run(i); });
+    }
+    ~stealing_pool_t() {
+      {
+        std::lock_guard<std::mutex> lk(_m);
+        _stopping = true;
+      }
+      _cv.notify_all();
+      for (auto &t : _workers)
+        t.join();
+    }
+    stealing_pool_t(stealing_pool_t const &) = delete;
+    stealing_pool_t &operator=(stealing_pool_t const &) = delete;
+
+    /** @brief queue a task on the current worker, or on the next one round-robin */
+    void submit(task_t task) {
+      auto i = self();
+      if (i == npos)
+        i = _next.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+      {
+        std::lock_guard<std::mutex> lk(_m);
+        _pending++;
+      }
+      {
+        std::lock_guard<std::mutex> lk(_queues[i]->m);
+        _queues[i]->tasks.push_back(std::move(task));
+      }
+      _cv.notify_one();
+    }
+
+    /**
+     * @brief fn(i) for i in [0, n), spread over the workers in chunks,
+     * and return when they're all done.
+     * @details The first exception thrown by fn is rethrown here, after
+     * the other chunks finished.
+     */
+    template<typename Fn>
+    void parallel_for(std::size_t n, Fn &&fn) {
+      if (n == 0)
+        return;
+      auto chunks = std::min(n, (_queues.size() + 1) * 4);
+      auto grain = (n + chunks - 1) / chunks;
+      chunks = (n + grain - 1) / grain;
+      struct join_t {
+        std::atomic<std::size_t> left;
+        std::mutex m{};
+        std::exception_ptr error{};
+      } join{chunks};
+      auto chunk = [&fn, &join, n, grain](std::size_t c) {
+        try {
+          for (auto i = c * grain, end = std::min(n, i + grain); i < end; i++)
+            fn(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lk(join.m);
+          if (!join.error)
+            join.error = std::current_exception();
+        }
+        join.left.fetch_sub(1, std::memory_order_acq_rel);
+      };
+      for (std::size_t c = 1; c < chunks; c++)
+        submit([&chunk, c] { chunk(c); });
+      chunk(0);
+      // help with the rest, ours or not
+      task_t task;
+      while (join.left.load(std::memory_order_acquire) != 0) {
+        if (try_pop(self(), task)) {
+          task();
+          task = nullptr;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      if (join.error)
+        std::rethrow_exception(join.error);
+    }
+
+    std::size_t size() const { return _workers.size(); }
+
+  private:
+    static constexpr std::size_t npos = ~std::size_t(0);
+
+    struct queue_t {
+      std::mutex m{};
+      std::deque<task_t> tasks{};
+    };
+
+    // the index of the current thread among the workers of this pool
+    std::size_t self() const {
+      auto const &w = current();
+      return w.first == this ? w.second : npos;
+    }
+    static std::pair<stealing_pool_t const *, std::size_t> &current() {
+      static thread_local std::pair<stealing_pool_t const *, std::size_t> w{nullptr, npos};
+      return w;
+    }
+
+    // the newest task of worker i, or else the oldest one of another
+    bool try_pop(std::size_t i, task_t &task) {
+      auto n = _queues.size();
+      auto first = i == npos ? _next.load(std::memory_order_relaxed) % n : i;
+      for (std::size_t k = 0; k < n; k++) {
+        auto &q = *_queues[(first + k) % n];
+        std::lock_guard<std::mutex> lk(q.m);
+        if (q.tasks.empty())
+          continue;
+        if (k == 0 && i != npos) {
+          task = std::move(q.tasks.back());
+          q.tasks.pop_back();
+        } else {
+          task = std::move(q.tasks.front());
+          q.tasks.pop_front();
+        }
+        _pending.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+      return false;
+    }
+
+    void run(std::size_t i) {
+      current() = {this, i};
+      task_t task;
+      for (;;) {
+        if (try_pop(i, task)) {
+          task();
+          task = nullptr;
+          continue;
+        }
+        std::unique_lock<std::mutex> lk(_m);
+        _cv.wait(lk, [this] { return _stopping || _pending.load(std::memory_order_relaxed) != 0; });
+        if (_stopping && _pending.load(std::memory_order_relaxed) == 0)
+          return;
+      }
+    }
+
+  private:
+    std::vector<std::unique_ptr<queue_t>> _queues{};
+    std::mutex _m{};
+    std::condition_variable _cv{};
+    std::atomic<std::size_t> _pending{0};
+    std::atomic<std::size_t> _next{0};
+    bool _stopping{false};
+    std::vector<std::thread> _workers{};
+  };
+
+} // namespace undo_cxx::util
+
+#endif //UNDO_CXX_UNDO_POOL_HH
@@ -0,0 +1,294 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/3.
+//
+
+#ifndef UNDO_CXX_UNDO_RING_HH
+#define UNDO_CXX_UNDO_RING_HH
+
+#include "undo-def.hh"
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// ------------------- ring_buffer_t
+namespace undo_cxx::util {
+
+  /**
+   * @brief a contiguous ring buffer, bounded by max_size(n).
+   * @tparam T
+   * @tparam Alloc
+   * @details ring_buffer_t is a history container for undoable_cmd_system_t.
+   *
+   * The elements are stored in one contiguous block, growing by doubling
+   * until it reaches max_size(). Once it's full, emplace_back() evicts
+   * the oldest element in O(1), without shifting the others.
+   *
+   * The iterators are random-access and indexed logically from the
+   * oldest element, so they're invalidated by any eviction, just
+   * like the indices are.
+   * @code{c++}
+   * undo_cxx::util::ring_buffer_t&lt;int> rb;
+   * rb.max_size(2);
+   * rb.emplace_back(1);
+   * rb.emplace_back(2);
+   * rb.emplace_back(3); // 1 evicted
+   * assert(rb.front() == 2);
+   * @endcode
+   */
+  template<typename T, typename Alloc = std::allocator<T>>
+  class ring_buffer_t {
+    using alloc_traits = std::allocator_traits<Alloc>;
+
+  public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = T const &;
+    using pointer = T *;
+    using const_pointer = T const *;
+
+    template<bool Const>
+    class iterator_t {
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = std::conditional_t<Const, T const *, T *>;
+      using reference = std::conditional_t<Const, T const &, T &>;
+      using owner_type = std::conditional_t<Const, ring_buffer_t const, ring_buffer_t>;
+
+      iterator_t() = default;
+      iterator_t(owner_type *o, size_type i)
+          : _o(o), _i(i) {}
+      template<bool C = Const, std::enable_if_t<C, int> = 0>
+      iterator_t(iterator_t<false> const &o)
+          : _o(o.owner()), _i(o.index()) {}
+
+      reference operator*() const { return (*_o)[_i]; }
+      pointer operator->() const { return &(*_o)[_i]; }
+      reference operator[](difference_type n) const { return (*_o)[_i + n]; }
+
+      iterator_t &operator++() {
+        ++_i;
+        return *this;
+      }
+      iterator_t operator++(int) {
+        auto t = *this;
+        ++_i;
+        return t;
+      }
+      iterator_t &operator--() {
+        --_i;
+        return *this;
+      }
+      iterator_t operator--(int) {
+        auto t = *this;
+        --_i;
+        return t;
+      }
+      iterator_t &operator+=(difference_type n) {
+        _i += n;
+        return *this;
+      }
+      iterator_t &operator-=(difference_type n) {
+        _i -= n;
+        return *this;
+      }
+      friend iterator_t operator+(iterator_t it, difference_type n) { return it += n; }
+      friend iterator_t operator+(difference_type n, iterator_t it) { return it += n; }
+      friend iterator_t operator-(iterator_t it, difference_type n) { return it -= n; }
+      friend difference_type operator-(iterator_t const &a, iterator_t const &b) {
+        return (difference_type) a._i - (difference_type) b._i;
+      }
+      friend bool operator==(iterator_t const &a, iterator_t const &b) { return a._i == b._i; }
+      friend bool operator!=(iterator_t const &a, iterator_t const &b) { return a._i != b._i; }
+      friend bool operator<(iterator_t const &a, iterator_t const &b) { return a._i < b._i; }
+      friend bool operator>(iterator_t const &a, iterator_t const &b) { return a._i > b._i; }
+      friend bool operator<=(iterator_t const &a, iterator_t const &b) { return a._i <= b._i; }
+      friend bool operator>=(iterator_t const &a, iterator_t const &b) { return a._i >= b._i; }
+
+      owner_type *owner() const { return _o; }
+      size_type index() const { return _i; }
+
+    private:
+      owner_type *_o{};
+      size_type _i{};
+    };
+    using iterator = iterator_t<false>;
+    using const_iterator = iterator_t<true>;
+
+  public:
+    ring_buffer_t() = default;
+    explicit ring_buffer_t(Alloc const &a)
+        : _alloc(a) {}
+    ~ring_buffer_t() { release(); }
+    ring_buffer_t(ring_buffer_t const &) = delete;
+    ring_buffer_t &operator=(ring_buffer_t const &) = delete;
+    ring_buffer_t(ring_buffer_t &&o) noexcept
+        : _alloc(std::move(o._alloc))
+        , _buf(std::exchange(o._buf, nullptr))
+        , _cap(std::exchange(o._cap, 0))
+        , _head(std::exchange(o._head, 0))
+        , _size(std::exchange(o._size, 0))
+        , _max_size(o._max_size) {}
+    ring_buffer_t &operator=(ring_buffer_t &&o) noexcept {
+      if (this != &o) {
+        release();
+        _alloc = std::move(o._alloc);
+        _buf = std::exchange(o._buf, nullptr);
+        _cap = std::exchange(o._cap, 0);
+        _head = std::exchange(o._head, 0);
+        _size = std::exchange(o._size, 0);
+        _max_size = o._max_size;
+      }
+      return *this;
+    }
+
+    allocator_type get_allocator() const { return _alloc; }
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, _size}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, _size}; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    reference operator[](size_type i) { return _buf[slot(i)]; }
+    const_reference operator[](size_type i) const { return _buf[slot(i)]; }
+    reference front() { return _buf[_head]; }
+    const_reference front() const { return _buf[_head]; }
+    reference back() { return _buf[slot(_size - 1)]; }
+    const_reference back() const { return _buf[slot(_size - 1)]; }
+
+    size_type size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    bool full() const { return _size == _max_size; }
+    size_type capacity() const { return _cap; }
+    /** @brief make room for n elements, at most max_size() of them */
+    void reserve(size_type n) {
+      if (n > _max_size) n = _max_size;
+      if (n > _cap) reallocate(n);
+    }
+
+    size_type max_size() const { return _max_size; }
+    /**
+     * @brief bound the ring buffer. The oldest elements will be evicted
+     * if there are more than max_value elements.
+     */
+    void max_size(size_type max_value) {
+      if (max_value == 0) max_value = 1;
+      while (_size > max_value)
+        pop_front();
+      _max_size = max_value;
+      if (_cap > _max_size)
+        reallocate(_max_size);
+    }
+
+    /**
+     * @brief append an element, the oldest one will be evicted if the
+     * ring buffer is full.
+     */
+    template<typename... Args>
+    reference emplace_back(Args &&...args) {
+      if (_size == _max_size) {
+        pop_front();
+      } else if (_size == _cap) {
+        grow();
+      }
+      auto *p = _buf + slot(_size);
+      alloc_traits::construct(_alloc, p, std::forward<Args>(args)...);
+      ++_size;
+      return *p;
+    }
+    void push_back(T const &v) { emplace_back(v); }
+    void push_back(T &&v) { emplace_back(std::move(v)); }
+
+    void pop_front() {
+      alloc_traits::destroy(_alloc, _buf + _head);
+      if (++_head == _cap) _head = 0;
+      if (--_size == 0) _head = 0;
+    }
+    void pop_back() {
+      alloc_traits::destroy(_alloc, _buf + slot(_size - 1));
+      if (--_size == 0) _head = 0;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+    iterator erase(const_iterator first, const_iterator last) {
+      size_type f = first.index(), l = last.index();
+      size_type n = l - f;
+      if (n == 0)
+        return {this, f};
+      if (f == 0) {
+        while (n--) pop_front();
+        return begin();
+      }
+      for (size_type i = l; i < _size; ++i)
+        (*this)[i - n] = std::move((*this)[i]);
+      while (n--) pop_back();
+      return {this, f};
+    }
+
+    void clear() {
+      while (_size) pop_back();
+      _head = 0;
+    }
+
+  private:
+    size_type slot(size_type i) const {
+      size_type s = _head + i;
+      return s >= _cap ? s - _cap : s;
+    }
+
+    void grow() {
+      size_type n = _cap ? _cap * 2 : 8;
+      if (n > _max_size || n < _cap) n = _max_size;
+      reallocate(n);
+    }
+
+    void reallocate(size_type n) {
+      T *buf = alloc_traits::allocate(_alloc, n);
+      for (size_type i = 0; i < _size; ++i) {
+        auto *p = _buf + slot(i);
+        alloc_traits::construct(_alloc, buf + i, std::move(*p));
+        alloc_traits::destroy(_alloc, p);
+      }
+      if (_buf)
+        alloc_traits::deallocate(_alloc, _buf, _cap);
+      _buf = buf;
+      _cap = n;
+      _head = 0;
+    }
+
+    void release() {
+      clear();
+      if (_buf)
+        alloc_traits::deallocate(_alloc, _buf, _cap);
+      _buf = nullptr;
+      _cap = 0;
+    }
+
+  private:
+    Alloc _alloc{};
+    T *_buf{};
+    size_type _cap{};
+    size_type _head{};
+    size_type _size{};
+    size_type _max_size{std::numeric_limits<size_type>::max()};
+  };
+
+} // namespace undo_cxx::util
+
+#endif //UNDO_CXX_UNDO_RING_HH
@@ -0,0 +1,185 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_UNDO_SHARED_HH
+#define UNDO_CXX_UNDO_SHARED_HH
+
+#include <cstddef>
+#include <limits>
+#include <list>
+#include <memory_resource>
+#include <mutex>
+
+// ------------------- history_pool_t
+namespace undo_cxx {
+
+  /**
+   * @brief one memory budget and one allocator shared by the undo
+   * histories of many documents, see
+   * undoable_cmd_system_t(history_pool_t &).
+   * @details Each attached manager reports the footprint of its history
+   * (memory_usage()) whenever it changes. Once the total crosses
+   * max_bytes(), the oldest mementos of the least recently active
+   * documents are evicted first, the active one is the last; a history
+   * always keeps its newest memento.
+   *
+   * The commands, the pairs of the mementos, and with
+   * pmr_history_traits_t the mementos and the history containers of
+   * the members are allocated from one synchronized pool, so an idle
+   * document holds no chunks of its own.
+   *
+   * The pool is thread-safe, a manager isn't. If the managers run on
+   * different threads, hold the lock of a manager (pool_guard()) for
+   * each call to it: the pool evicts from another document only while
+   * its lock is free, a busy document is skipped. The evictions by the
+   * pool are journaled like the others, under that lock.
+   *
+   * The pool must outlive its members.
+   * @code{c++}
+   * undo_cxx::history_pool_t pool{64 << 20};
+   * M doc1{pool}, doc2{pool};
+   * {
+   *   auto lk = doc1.pool_guard();
+   *   doc1.invoke&lt;EditCmd>(...);
+   * }
+   * auto total = pool.counters().bytes;
+   * @endcode
+   */
+  class history_pool_t {
+  public:
+    /** @brief the statistics of the pool, or of one document */
+    struct counters_t {
+      std::size_t documents;
+      std::size_t bytes;
+      std::size_t max_bytes;
+      /** @brief the bytes evicted by the pool */
+      std::size_t reclaimed;
+    };
+
+    /** @brief a document attached to the pool */
+    class member_t {
+    public:
+      virtual ~member_t() = default;
+      /**
+       * @brief evict the oldest mementos until at least bytes are freed,
+       * or only the newest one is left.
+       * @return the bytes freed
+       */
+      virtual std::size_t shed(std::size_t bytes) = 0;
+      /** @brief held by the owner thread of the document while it's in use */
+      std::mutex &lock() { return _lock; }
+
+    private:
+      friend class history_pool_t;
+      std::list<member_t *>::iterator _lru{};
+      std::size_t _bytes{};
+      std::size_t _reclaimed{};
+      bool _drained{};
+      std::mutex _lock{};
+    };
+
+    explicit history_pool_t(std::size_t max_bytes = std::numeric_limits<std::size_t>::max(), std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : _slab(upstream)
+        , _max_bytes(max_bytes) {}
+    history_pool_t(history_pool_t const &) = delete;
+    history_pool_t &operator=(history_pool_t const &) = delete;
+
+    /** @brief the shared allocator */
+    std::pmr::memory_resource *resource() { return &_slab; }
+
+    void attach(member_t &m) {
+      std::lock_guard<std::mutex> lk(_m);
+      m._lru = _lru.insert(_lru.end(), &m);
+      m._bytes = 0;
+      m._drained = false;
+    }
+    void detach(member_t &m) {
+      std::lock_guard<std::mutex> lk(_m);
+      _bytes -= m._bytes;
+      (m._drained ? _drained : _lru).erase(m._lru);
+    }
+
+    /**
+     * @brief m holds bytes now, and it's the most recently active
+     * document. It's called by m on its thread, with its lock held if
+     * it's used, and m may be asked to shed() its own mementos.
+     */
+    void charge(member_t &m, std::size_t bytes) {
+      std::lock_guard<std::mutex> lk(_m);
+      _bytes = _bytes - m._bytes + bytes;
+      m._bytes = bytes;
+      _lru.splice(_lru.end(), m._drained ? _drained : _lru, m._lru);
+      m._drained = false;
+      enforce(&m);
+    }
+
+    std::size_t max_bytes() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _max_bytes;
+    }
+    /** @brief not while the calling thread holds the lock of a member */
+    void max_bytes(std::size_t max_value) {
+      std::lock_guard<std::mutex> lk(_m);
+      _max_bytes = max_value;
+      enforce(nullptr);
+    }
+
+    counters_t counters() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return {_lru.size() + _drained.size(), _bytes, _max_bytes, _reclaimed};
+    }
+    counters_t counters(member_t const &m) const {
+      std::lock_guard<std::mutex> lk(_m);
+      return {1, m._bytes, _max_bytes, m._reclaimed};
+    }
+
+  private:
+    // evict from the least recently active documents until the total
+    // fits, self (the caller, whose lock is held already) is the last
+    void enforce(member_t *self) {
+      for (auto it = _lru.begin(); _bytes > _max_bytes && it != _lru.end();) {
+        auto *m = *it++;
+        if (m == self)
+          continue;
+        std::unique_lock<std::mutex> busy(m->_lock, std::try_to_lock);
+        if (busy.owns_lock())
+          reclaim(*m);
+      }
+      if (self && _bytes > _max_bytes)
+        reclaim(*self);
+    }
+    // a member left with nothing to shed (its newest memento) is moved
+    // aside until it's active again, so it isn't scanned over and over
+    void reclaim(member_t &m) {
+      auto wanted = _bytes - _max_bytes;
+      auto freed = m.shed(wanted);
+      m._bytes -= freed;
+      m._reclaimed += freed;
+      _bytes -= freed;
+      _reclaimed += freed;
+      if (freed < wanted) {
+        _drained.splice(_drained.end(), _lru, m._lru);
+        m._drained = true;
+      }
+    }
+
+  private:
+    mutable std::mutex _m{};
+    std::pmr::synchronized_pool_resource _slab;
+    std::list<member_t *> _lru{}; // the least recently active first
+    std::list<member_t *> _drained{};
+    std::size_t _bytes{};
+    std::size_t _max_bytes;
+    std::size_t _reclaimed{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_SHARED_HH
@@ -0,0 +1,236 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/12.
+//
+
+#ifndef UNDO_CXX_UNDO_SPILL_HH
+#define UNDO_CXX_UNDO_SPILL_HH
+
+#include "undo-tier.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// ------------------- spill_file_t
+namespace undo_cxx {
+
+  /**
+   * @brief a cold store in a file: the bytes are written into it, and
+   * read back through a memory mapping.
+   * @details The extents of the released mementos are kept in a free
+   * list, coalesced with their free neighbours, and put() takes the
+   * smallest one that fits before growing the file. A free extent at the
+   * end of the file is given back, the file is truncated once it has
+   * shrunk to below the half of its size. So the file stays around the
+   * size of its live mementos in a long session, bytes() and
+   * live_bytes() tell how much of it is dead (the holes).
+   *
+   * The calls are serialized by a mutex, the file can be shared by the
+   * managers of several threads.
+   */
+  class spill_file_t : public cold_store_t {
+  public:
+    /** @brief an anonymous temporary file */
+    spill_file_t()
+        : _file(std::tmpfile()) {
+      if (!_file)
+        throw std::runtime_error("can't create the spill file");
+    }
+    /** @brief a file at path, truncated now and removed on close */
+    explicit spill_file_t(std::filesystem::path path)
+        : _file(std::fopen(path.string().c_str(), "w+b"))
+        , _path(std::move(path)) {
+      if (!_file)
+        throw std::runtime_error("can't create the spill file: " + _path.string());
+    }
+    ~spill_file_t() override {
+      unmap();
+      std::fclose(_file);
+      if (!_path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(_path, ec);
+      }
+    }
+    spill_file_t(spill_file_t const &) = delete;
+    spill_file_t &operator=(spill_file_t const &) = delete;
+
+    ticket_t put(std::string_view bytes) override {
+      std::lock_guard<std::mutex> lk(_m);
+      ticket_t t{_end, bytes.size()};
+      if (auto it = _by_size.lower_bound(t.size); t.size && it != _by_size.end()) {
+        // best fit, the rest of the extent stays free
+        auto [size, off] = *it;
+        _by_size.erase(it);
+        _free.erase(off);
+        t.offset = off;
+        if (size > t.size)
+          add_free(off + t.size, size - t.size);
+      }
+      write(t.offset, bytes);
+      if (t.offset == _end) {
+        _end += t.size;
+        if (_end > _disk)
+          _disk = _end;
+      }
+      _live += t.size;
+      _count++;
+      return t;
+    }
+    void get(ticket_t const &t, std::string &out) override {
+      std::lock_guard<std::mutex> lk(_m);
+      read(t, out);
+    }
+    void release(ticket_t const &t) override {
+      std::lock_guard<std::mutex> lk(_m);
+      _live -= t.size;
+      _count--;
+      if (!t.size)
+        return;
+      auto off = t.offset, size = t.size;
+      if (auto next = _free.find(off + size); next != _free.end()) {
+        size += next->second;
+        remove_free(next);
+      }
+      if (auto prev = _free.lower_bound(off); prev != _free.begin()) {
+        if (--prev; prev->first + prev->second == off) {
+          off = prev->first;
+          size += prev->second;
+          remove_free(prev);
+        }
+      }
+      if (off + size < _end) {
+        add_free(off, size);
+        return;
+      }
+      _end = off; // the tail is free, give it back
+      if (_end < _disk / 2)
+        shrink();
+    }
+
+    /** @brief the bytes of the file in use, the dead ones included */
+    std::uint64_t bytes() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _end;
+    }
+    /** @brief the number of the holes in the file */
+    std::size_t holes() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _free.size();
+    }
+    /** @brief the bytes of the mementos still in the file */
+    std::uint64_t live_bytes() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _live;
+    }
+    /** @brief the number of the mementos in the file */
+    std::size_t size() const {
+      std::lock_guard<std::mutex> lk(_m);
+      return _count;
+    }
+
+  private:
+#if defined(_WIN32)
+    void write(std::uint64_t off, std::string_view s) {
+      if (std::fseek(_file, (long) off, SEEK_SET) != 0 || std::fwrite(s.data(), 1, s.size(), _file) != s.size())
+        throw std::runtime_error("can't write the spill file");
+    }
+    void read(ticket_t const &t, std::string &out) {
+      out.resize(t.size);
+      if (std::fseek(_file, (long) t.offset, SEEK_SET) != 0 || std::fread(out.data(), 1, t.size, _file) != t.size)
+        throw std::runtime_error("can't read the spill file");
+    }
+    void unmap() {}
+    void shrink() {}
+#else
+    void write(std::uint64_t off, std::string_view s) {
+      auto fd = ::fileno(_file);
+      for (std::size_t n = 0; n < s.size();) {
+        auto r = ::pwrite(fd, s.data() + n, s.size() - n, (off_t) (off + n));
+        if (r <= 0)
+          throw std::runtime_error("can't write the spill file");
+        n += (std::size_t) r;
+      }
+    }
+    // map the whole file, remapping it when it has grown. The pages
+    // are read once, they're dropped from the resident set at once.
+    void read(ticket_t const &t, std::string &out) {
+      auto page = (std::uint64_t) ::sysconf(_SC_PAGESIZE);
+      if (t.offset + t.size > _mapped) {
+        unmap();
+        auto len = (_end + page - 1) / page * page;
+        auto *p = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, ::fileno(_file), 0);
+        if (p == MAP_FAILED)
+          throw std::runtime_error("can't map the spill file");
+        _map = static_cast<char *>(p);
+        _mapped = len;
+      }
+      out.assign(_map + t.offset, (std::size_t) t.size);
+      auto first = t.offset / page * page;
+      ::madvise(_map + first, (std::size_t) (t.offset + t.size - first), MADV_DONTNEED);
+    }
+    void unmap() {
+      if (_map)
+        ::munmap(_map, _mapped);
+      _map = nullptr;
+      _mapped = 0;
+    }
+    // the pages past the new end would fault in the mapping, drop it
+    // first. A failed truncate only keeps the disk space.
+    void shrink() {
+      unmap();
+      if (::ftruncate(::fileno(_file), (off_t) _end) == 0)
+        _disk = _end;
+    }
+
+    char *_map{};
+    std::uint64_t _mapped{};
+#endif
+
+    void add_free(std::uint64_t off, std::uint64_t size) {
+      _free.emplace(off, size);
+      _by_size.emplace(size, off);
+    }
+    void remove_free(std::map<std::uint64_t, std::uint64_t>::iterator it) {
+      auto [first, last] = _by_size.equal_range(it->second);
+      for (; first != last; ++first) {
+        if (first->second == it->first) {
+          _by_size.erase(first);
+          break;
+        }
+      }
+      _free.erase(it);
+    }
+
+    std::FILE *_file{};
+    std::filesystem::path _path{};
+    std::map<std::uint64_t, std::uint64_t> _free{};          // offset -> size
+    std::multimap<std::uint64_t, std::uint64_t> _by_size{}; // size -> offset
+    std::uint64_t _end{};
+    std::uint64_t _disk{};
+    mutable std::mutex _m{};
+    std::uint64_t _live{};
+    std::size_t _count{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_SPILL_HH
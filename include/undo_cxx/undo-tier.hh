@@ -0,0 +1,235 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/12.
+//
+
+#ifndef UNDO_CXX_UNDO_TIER_HH
+#define UNDO_CXX_UNDO_TIER_HH
+
+#include "undo-def.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// the interfaces of the optional tiers of undoable_cmd_system_t: the
+// journal and the cold store. Their implementations, which need the
+// file and the mapping APIs, are in undo-journal.hh and undo-spill.hh.
+
+// ------------------- tier_t
+namespace undo_cxx::detail {
+
+  /** @brief an empty stand-in for a tier turned off by history_traits_t */
+  template<typename T>
+  struct no_tier_t {};
+
+  /** @brief T if the tier is on, else an empty type which takes no room */
+  template<bool On, typename T>
+  using tier_t = std::conditional_t<On, T, no_tier_t<T>>;
+
+} // namespace undo_cxx::detail
+
+// ------------------- state_serializer_t
+namespace undo_cxx {
+
+  /**
+   * @brief how a State is written into and read back from a journal.
+   * @details The default one calls the members of State:
+   * @code{c++}
+   * void serialize(std::string &out) const;    // append the bytes
+   * bool deserialize(std::string_view in);     // false if malformed
+   * @endcode
+   * std::string and the States which opt in by is_journal_pod are
+   * supported out of the box. Specialize it for the other ones. The
+   * primary template is empty: the States without a serializer can't be
+   * journaled.
+   */
+  template<typename State, typename = void>
+  struct state_serializer_t {};
+
+  /**
+   * @brief true if the bytes of a trivially copyable State can be
+   * journaled as they are, by memcpy.
+   * @details A journal outlives the process: the bytes are read back by
+   * another build, maybe on another machine. So a State opts in only if
+   * it has no pointers and no padding, and its layout is stable. The
+   * arithmetic and the enum types do by default. For example:
+   * @code{c++}
+   * template&lt;>
+   * struct undo_cxx::is_journal_pod&lt;my_state> : std::true_type {};
+   * @endcode
+   */
+  template<typename State>
+  struct is_journal_pod : std::bool_constant<std::is_arithmetic_v<State> || std::is_enum_v<State>> {};
+  template<typename State>
+  constexpr inline bool is_journal_pod_v = is_journal_pod<State>::value;
+
+  namespace detail {
+    template<typename T, typename = void>
+    struct has_serialize : std::false_type {};
+    template<typename T>
+    struct has_serialize<T, std::void_t<decltype(std::declval<T const &>().serialize(std::declval<std::string &>()))>> : std::true_type {};
+
+    // the bytes of a trivially copyable State as they are
+    template<typename State>
+    struct pod_serializer_t {
+      static_assert(std::is_trivially_copyable_v<State>, "a pod_serializer_t needs a trivially copyable State");
+      static void write(std::string &out, State const &s) { out.append(reinterpret_cast<char const *>(&s), sizeof(State)); }
+      static bool read(std::string_view in, State &s) {
+        if (in.size() != sizeof(State)) return false;
+        std::memcpy(&s, in.data(), sizeof(State));
+        return true;
+      }
+    };
+  } // namespace detail
+
+  template<typename State>
+  struct state_serializer_t<State, std::enable_if_t<detail::has_serialize<State>::value>> {
+    static void write(std::string &out, State const &s) { s.serialize(out); }
+    static bool read(std::string_view in, State &s) { return s.deserialize(in); }
+  };
+
+  template<typename State>
+  struct state_serializer_t<State, std::enable_if_t<is_journal_pod_v<State> && !detail::has_serialize<State>::value>>
+      : detail::pod_serializer_t<State> {};
+
+  template<>
+  struct state_serializer_t<std::string, void> {
+    static void write(std::string &out, std::string const &s) { out.append(s); }
+    static bool read(std::string_view in, std::string &s) {
+      s.assign(in);
+      return true;
+    }
+  };
+
+  template<typename State, typename = void>
+  struct is_serializable : std::false_type {};
+  template<typename State>
+  struct is_serializable<State, std::void_t<decltype(state_serializer_t<State>::write(std::declval<std::string &>(), std::declval<State const &>()))>> : std::true_type {};
+  /** @brief true if State has a state_serializer_t, so that it can be journaled */
+  template<typename State>
+  constexpr inline bool is_serializable_v = is_serializable<State>::value;
+
+  /**
+   * @brief how the states are written into a cold store: by
+   * state_serializer_t, or else by memcpy for a trivially copyable
+   * State. The bytes don't outlive the process, so the layout of State
+   * doesn't matter there.
+   */
+  template<typename State>
+  using cold_serializer_t = std::conditional_t<is_serializable_v<State>, state_serializer_t<State>, detail::pod_serializer_t<State>>;
+  /** @brief true if State can be kept in a cold store, see cold_serializer_t */
+  template<typename State>
+  constexpr inline bool is_spillable_v = is_serializable_v<State> || std::is_trivially_copyable_v<State>;
+
+} // namespace undo_cxx
+
+// ------------------- journal_event_t
+namespace undo_cxx {
+
+  /** @brief the record types of a journal */
+  enum class journal_event_t : std::uint8_t {
+    save = 1,   // a memento is pushed, the payload is its states
+    cursor = 2, // undo/redo moved the cursor to a position
+    erase = 3,  // erase(n) removed n mementos at the cursor
+    clear = 4,  // the history is cleared
+    limits = 5, // max_size() or max_bytes() changed
+    evict = 6,  // the n oldest mementos are evicted
+  };
+
+  template<typename State>
+  class journal_t;
+
+} // namespace undo_cxx
+
+// ------------------- cold_store_t
+namespace undo_cxx {
+
+  struct spill_options_t {
+    /**
+     * @brief the newest mementos stay live, the older ones are spilled
+     * in batches once they're twice as many
+     */
+    std::size_t hot_window{256};
+    /** @brief the mementos whose footprint is below it aren't spilled */
+    std::size_t min_bytes{0};
+  };
+
+  /**
+   * @brief the cold tier of an undo history: it keeps the serialized
+   * states of the cold mementos, see undoable_cmd_system_t::spill().
+   * @details spill_file_t keeps them in a file, compressed_store_t
+   * keeps them compressed in memory. A store can be shared by several
+   * managers on their own threads, so an implementation must be
+   * thread-safe: both of them lock.
+   */
+  class cold_store_t {
+  public:
+    /** @brief where the bytes of a memento are, size is their length */
+    struct ticket_t {
+      std::uint64_t offset;
+      std::uint64_t size;
+    };
+
+    virtual ~cold_store_t() = default;
+    /** @brief keep the bytes */
+    virtual ticket_t put(std::string_view bytes) = 0;
+    /** @brief read the bytes kept by put() into out */
+    virtual void get(ticket_t const &t, std::string &out) = 0;
+    /** @brief the bytes aren't needed anymore */
+    virtual void release(ticket_t const &t) = 0;
+  };
+
+  /**
+   * @brief append the states of a memento to out, each one is length
+   * prefixed and written by cold_serializer_t.
+   */
+  template<typename State, typename Memento>
+  inline void write_states(Memento const &m, std::string &out) {
+    m.for_each_state([&out](State const &s) {
+      auto len_at = out.size();
+      out.append(sizeof(std::uint32_t), '\0');
+      cold_serializer_t<State>::write(out, s);
+      auto len = (std::uint32_t) (out.size() - len_at - sizeof(std::uint32_t));
+      std::memcpy(&out[len_at], &len, sizeof(len));
+    });
+  }
+
+  /**
+   * @brief the reverse of write_states(): the states of m are replaced
+   * in order. false if the bytes are malformed.
+   */
+  template<typename State, typename Memento>
+  inline bool read_states(std::string_view in, Memento &m) {
+    bool ok = true;
+    m.for_each_state([&in, &ok](State &s) {
+      std::uint32_t len{};
+      State tmp{};
+      if (!ok || in.size() < sizeof(len)) {
+        ok = false;
+        return;
+      }
+      std::memcpy(&len, in.data(), sizeof(len));
+      in.remove_prefix(sizeof(len));
+      if (in.size() < len || !cold_serializer_t<State>::read(in.substr(0, len), tmp)) {
+        ok = false;
+        return;
+      }
+      in.remove_prefix(len);
+      s = std::move(tmp);
+    });
+    return ok;
+  }
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_TIER_HH
@@ -0,0 +1,208 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/2.
+//
+
+#ifndef UNDO_CXX_UNDO_TRACE_HH
+#define UNDO_CXX_UNDO_TRACE_HH
+
+#include "undo-common.hh"
+#include "undo-log.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief selects the default history tracer of undoable_cmd_system_t.
+ * @details
+ * - 0: off, nothing will be compiled in;
+ * - 1: ring-buffer, the recent events are kept in memory and formatted
+ *      only while they are being read;
+ * - 2: stdout, print each event via dbg_print immediately.
+ *
+ * The default value is 2 for debug builds, and 0 for release builds.
+ */
+#if !defined(UNDO_CXX_HISTORY_TRACE)
+#if defined(_DEBUG)
+#define UNDO_CXX_HISTORY_TRACE 2
+#else
+#define UNDO_CXX_HISTORY_TRACE 0
+#endif
+#endif
+
+#if !defined(UNDO_CXX_HISTORY_TRACE_RING_SIZE)
+#define UNDO_CXX_HISTORY_TRACE_RING_SIZE 64
+#endif
+
+namespace undo_cxx::trace {
+
+  enum class event_t : std::uint8_t {
+    save,
+    restore,
+    replay,
+    merge,
+    branch,
+    revert,
+  };
+
+  inline char const *to_string(event_t e) {
+    switch (e) {
+      case event_t::save: return "save";
+      case event_t::restore: return "restore";
+      case event_t::replay: return "replay";
+      case event_t::merge: return "merge";
+      case event_t::branch: return "branch";
+      case event_t::revert: return "revert";
+    }
+    return "unknown";
+  }
+
+  namespace detail {
+    template<typename T>
+    inline std::string format_subject(void const *subject) {
+      return undo_cxx::to_string(*static_cast<T const *>(subject));
+    }
+  } // namespace detail
+
+  /**
+   * @brief a trace event. The subject (a memento) is referenced but
+   * not formatted until somebody reads it.
+   */
+  struct record_t {
+    std::uint64_t seq{};
+    event_t event{};
+    std::ptrdiff_t position{};
+    std::size_t size{};
+    void const *subject{};
+    std::string (*formatter)(void const *){};
+
+    bool released() const { return subject == nullptr; }
+    std::string subject_string() const {
+      return subject ? formatter(subject) : std::string{"(released)"};
+    }
+    friend std::ostream &operator<<(std::ostream &os, record_t const &o) {
+      return os << '#' << o.seq << ' ' << to_string(o.event)
+                << " at position #" << o.position << ": " << o.subject_string()
+                << ", size=" << o.size;
+    }
+  };
+
+  /**
+   * @brief the tracer which does nothing. All the calls to it are
+   * discarded at compile-time by undoable_cmd_system_t.
+   */
+  class null_tracer_t {
+  public:
+    static constexpr bool enabled = false;
+
+    template<typename T>
+    void record(event_t, std::ptrdiff_t, std::size_t, T const &) {}
+    void release(void const *) {}
+    void release_all() {}
+  };
+
+  /**
+   * @brief the tracer prints each event to stdout as soon as it
+   * happened, that's the classical behavior of undo-cxx.
+   */
+  class stdout_tracer_t {
+  public:
+    static constexpr bool enabled = true;
+
+    template<typename T>
+    void record(event_t e, std::ptrdiff_t position, std::size_t size, T const &subject) {
+      dbg_print("  . %s memento state at position #%td: %s, size=%zu",
+                to_string(e), position, undo_cxx::to_string(subject).c_str(), size);
+    }
+    void release(void const *) {}
+    void release_all() {}
+  };
+
+  /**
+   * @brief the tracer keeps the recent N events in a fixed ring buffer.
+   * @tparam N the capacity of the ring buffer
+   * @details Recording an event costs a few stores only. The subject
+   * will be formatted while you're reading the trace, by dump() or
+   * operator<<, or by record_t::subject_string().
+   *
+   * The subject of a record is released (see record_t::released())
+   * once the owner removed it from its history.
+   */
+  template<std::size_t N = UNDO_CXX_HISTORY_TRACE_RING_SIZE>
+  class ring_tracer_t {
+  public:
+    static_assert(N > 0, "ring_tracer_t needs a positive capacity");
+    static constexpr bool enabled = true;
+
+    template<typename T>
+    void record(event_t e, std::ptrdiff_t position, std::size_t size, T const &subject) {
+      auto &r = _ring[_seq % N];
+      r.seq = _seq++;
+      r.event = e;
+      r.position = position;
+      r.size = size;
+      r.subject = &subject;
+      r.formatter = &detail::format_subject<T>;
+    }
+    void release(void const *subject) {
+      for (auto &r : _ring) {
+        if (r.subject == subject)
+          r.subject = nullptr;
+      }
+    }
+    void release_all() {
+      for (auto &r : _ring)
+        r.subject = nullptr;
+    }
+
+    static constexpr std::size_t capacity() { return N; }
+    std::size_t size() const { return _seq < N ? (std::size_t) _seq : N; }
+    bool empty() const { return _seq == 0; }
+    /** @brief the total count of recorded events, including the overwritten ones */
+    std::uint64_t count() const { return _seq; }
+
+    /** @brief the i-th record from the oldest one still kept */
+    record_t const &operator[](std::size_t i) const {
+      return _ring[(_seq - size() + i) % N];
+    }
+
+    template<typename F>
+    void for_each(F &&fn) const {
+      for (std::size_t i = 0; i < size(); i++)
+        fn((*this)[i]);
+    }
+
+    std::ostream &dump(std::ostream &os) const {
+      for_each([&os](record_t const &r) { os << "  . " << r << '\n'; });
+      return os;
+    }
+    friend std::ostream &operator<<(std::ostream &os, ring_tracer_t const &o) {
+      return o.dump(os);
+    }
+
+    void clear() { _seq = 0; }
+
+  private:
+    std::array<record_t, N> _ring{};
+    std::uint64_t _seq{};
+  };
+
+#if UNDO_CXX_HISTORY_TRACE == 1
+  using default_tracer_t = ring_tracer_t<>;
+#elif UNDO_CXX_HISTORY_TRACE == 2
+  using default_tracer_t = stdout_tracer_t;
+#else
+  using default_tracer_t = null_tracer_t;
+#endif
+
+} // namespace undo_cxx::trace
+
+#endif //UNDO_CXX_UNDO_TRACE_HH
@@ -0,0 +1,285 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_UNDO_TREE_HH
+#define UNDO_CXX_UNDO_TREE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ------------------- history_tree_t
+namespace undo_cxx {
+
+  /**
+   * @brief the branches of an undo history, see undoable_cmd_system_t::tree_mode().
+   * @tparam Memento
+   * @tparam MementoPtr
+   * @details Each node holds a memento, the virtual root holds none.
+   * The nodes are kept in one pool and linked by 32-bit indices: the
+   * parent, the children (oldest first) and the active child, which is
+   * the one on the active path or the last visited one.
+   *
+   * The manager keeps the active path (from the root down to a leaf) in
+   * its history container, a node on it only refers to its memento. The
+   * other nodes own their mementos. A branch shares the prefix up to
+   * its fork with the other ones.
+   *
+   * The leaves off the active path are ordered by their last visit (the
+   * time they left the active path), so that lru_leaf() is O(log n).
+   */
+  template<typename Memento, typename MementoPtr = std::unique_ptr<Memento>>
+  class history_tree_t {
+  public:
+    using node_id = std::uint32_t;
+    using size_type = std::size_t;
+    static constexpr node_id root = 0;
+    static constexpr node_id npos = ~node_id{};
+
+    history_tree_t() { reset(); }
+    history_tree_t(history_tree_t const &) = delete;
+    history_tree_t &operator=(history_tree_t const &) = delete;
+
+    /** @brief the number of the nodes, the root excluded */
+    size_type size() const { return _count; }
+    bool contains(node_id n) const { return n < _nodes.size() && _nodes[n].live; }
+    /** @brief true if n is on the active path, the root always is */
+    bool on_path(node_id n) const { return !_nodes[n].held; }
+    node_id parent(node_id n) const { return _nodes[n].parent; }
+    /** @brief the child on the active path, or the last visited one, or npos */
+    node_id active_child(node_id n) const { return _nodes[n].active; }
+    /** @brief the i-th child of n (the oldest one first), or npos */
+    node_id child(node_id n, size_type i) const {
+      auto c = _nodes[n].first_child;
+      for (; c != npos && i; --i)
+        c = _nodes[c].next_sibling;
+      return c;
+    }
+    std::vector<node_id> children(node_id n) const {
+      std::vector<node_id> v;
+      for (auto c = _nodes[n].first_child; c != npos; c = _nodes[c].next_sibling)
+        v.push_back(c);
+      return v;
+    }
+    size_type child_count(node_id n) const {
+      size_type i = 0;
+      for (auto c = _nodes[n].first_child; c != npos; c = _nodes[c].next_sibling)
+        i++;
+      return i;
+    }
+    /** @brief the number of the nodes from the root down to n, the root excluded */
+    size_type depth(node_id n) const {
+      size_type d = 0;
+      for (; n != root; n = _nodes[n].parent)
+        d++;
+      return d;
+    }
+    /** @brief the memento of n, nullptr for the root */
+    Memento const *memento(node_id n) const { return _nodes[n].m; }
+    /** @brief the node of a memento, or npos */
+    node_id find(Memento const *m) const {
+      auto it = _index.find(m);
+      return it == _index.end() ? npos : it->second;
+    }
+    /** @brief the visit stamp of n, a greater one is more recent */
+    std::uint64_t visited(node_id n) const { return _nodes[n].visited; }
+    /** @brief the least recently visited leaf off the active path, or npos */
+    node_id lru_leaf() const { return _leaves.empty() ? npos : _leaves.begin()->second; }
+
+    /** @brief a new node of m on the active path, the newest child of parent */
+    node_id add(node_id parent, Memento *m) {
+      auto n = alloc();
+      auto &x = _nodes[n];
+      x.m = m;
+      x.visited = ++_clock;
+      link(parent, n);
+      _nodes[parent].active = n;
+      _index.emplace(m, n);
+      return n;
+    }
+    /** @brief n leaves the active path, taking the ownership of its memento */
+    void detach(node_id n, MementoPtr &&m) {
+      auto &x = _nodes[n];
+      x.held = std::move(m);
+      x.visited = ++_clock;
+      if (x.first_child == npos)
+        _leaves.emplace(x.visited, n);
+    }
+    /** @brief n joins the active path, giving its memento back */
+    MementoPtr attach(node_id n) {
+      auto &x = _nodes[n];
+      if (x.first_child == npos)
+        _leaves.erase({x.visited, n});
+      x.visited = ++_clock;
+      return std::move(x.held);
+    }
+    /** @brief make n the active child of its parent */
+    void select(node_id n) { _nodes[_nodes[n].parent].active = n; }
+
+    /** @brief remove a leaf off the active path, returning its memento */
+    MementoPtr take(node_id n) {
+      auto m = std::move(_nodes[n].held);
+      _leaves.erase({_nodes[n].visited, n});
+      auto p = _nodes[n].parent;
+      unlink(n);
+      free(n);
+      if (p != root && _nodes[p].held && _nodes[p].first_child == npos)
+        _leaves.emplace(_nodes[p].visited, p);
+      return m;
+    }
+    /**
+     * @brief remove a node on the active path: its branches are dropped,
+     * the memento of each node is passed to release(MementoPtr &) first,
+     * and its child on the active path takes its place.
+     */
+    template<typename F>
+    void remove(node_id n, F &&release) {
+      auto &x = _nodes[n];
+      node_id keep = npos;
+      for (auto c = x.first_child; c != npos;) {
+        auto next = _nodes[c].next_sibling;
+        if (on_path(c))
+          keep = c;
+        else
+          drop(c, release);
+        c = next;
+      }
+      auto p = _nodes[n].parent;
+      auto was_active = _nodes[p].active == n;
+      if (keep != npos)
+        unlink(keep);
+      replace(n, keep);
+      free(n);
+      if (was_active)
+        _nodes[p].active = keep != npos ? keep : _nodes[p].last_child;
+    }
+    /** @brief remove all the nodes, the mementos owned are passed to release(MementoPtr &) */
+    template<typename F>
+    void clear(F &&release) {
+      for (auto &x : _nodes) {
+        if (x.live && x.held)
+          release(x.held);
+      }
+      reset();
+    }
+
+  private:
+    struct node_t {
+      Memento *m{};
+      MementoPtr held{}; // off the active path
+      node_id parent{npos};
+      node_id first_child{npos};
+      node_id last_child{npos};
+      node_id prev_sibling{npos};
+      node_id next_sibling{npos};
+      node_id active{npos};
+      std::uint64_t visited{};
+      bool live{};
+    };
+
+    void reset() {
+      _nodes.clear();
+      _free.clear();
+      _leaves.clear();
+      _index.clear();
+      _count = 0;
+      _nodes.emplace_back();
+      _nodes[root].live = true;
+    }
+    node_id alloc() {
+      node_id n;
+      if (_free.empty()) {
+        n = (node_id) _nodes.size();
+        _nodes.emplace_back();
+      } else {
+        n = _free.back();
+        _free.pop_back();
+      }
+      _nodes[n].live = true;
+      _count++;
+      return n;
+    }
+    void free(node_id n) {
+      if (_nodes[n].m)
+        _index.erase(_nodes[n].m);
+      _nodes[n] = node_t{};
+      _free.push_back(n);
+      _count--;
+    }
+    // append n to the children of p
+    void link(node_id p, node_id n) {
+      auto &x = _nodes[n];
+      auto &y = _nodes[p];
+      x.parent = p;
+      x.prev_sibling = y.last_child;
+      x.next_sibling = npos;
+      if (y.last_child != npos)
+        _nodes[y.last_child].next_sibling = n;
+      else
+        y.first_child = n;
+      y.last_child = n;
+    }
+    void unlink(node_id n) {
+      auto &x = _nodes[n];
+      auto &y = _nodes[x.parent];
+      (x.prev_sibling != npos ? _nodes[x.prev_sibling].next_sibling : y.first_child) = x.next_sibling;
+      (x.next_sibling != npos ? _nodes[x.next_sibling].prev_sibling : y.last_child) = x.prev_sibling;
+      if (y.active == n)
+        y.active = y.last_child;
+      x.parent = x.prev_sibling = x.next_sibling = npos;
+    }
+    // put by (or nothing, if it's npos) in place of n among its siblings
+    void replace(node_id n, node_id by) {
+      if (by == npos) {
+        unlink(n);
+        return;
+      }
+      auto &x = _nodes[n];
+      auto &y = _nodes[by];
+      y.parent = x.parent;
+      y.prev_sibling = x.prev_sibling;
+      y.next_sibling = x.next_sibling;
+      auto &p = _nodes[x.parent];
+      (x.prev_sibling != npos ? _nodes[x.prev_sibling].next_sibling : p.first_child) = by;
+      (x.next_sibling != npos ? _nodes[x.next_sibling].prev_sibling : p.last_child) = by;
+    }
+    // free the branch under n (n included), it's off the active path
+    template<typename F>
+    void drop(node_id n, F &release) {
+      unlink(n);
+      std::vector<node_id> stack{n};
+      while (!stack.empty()) {
+        auto c = stack.back();
+        stack.pop_back();
+        for (auto g = _nodes[c].first_child; g != npos; g = _nodes[g].next_sibling)
+          stack.push_back(g);
+        if (_nodes[c].first_child == npos)
+          _leaves.erase({_nodes[c].visited, c});
+        release(_nodes[c].held);
+        free(c);
+      }
+    }
+
+  private:
+    std::vector<node_t> _nodes{};
+    std::vector<node_id> _free{};
+    std::set<std::pair<std::uint64_t, node_id>> _leaves{};
+    std::unordered_map<Memento const *, node_id> _index{};
+    std::uint64_t _clock{};
+    size_type _count{};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_TREE_HH
@@ -15,6 +15,9 @@
 
 #include "undo-dbg.hh"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <tuple>
@@ -90,16 +93,36 @@ namespace undo_cxx {
 #define __FACTORY_T_DEFINED
 namespace undo_cxx::util::factory {
 
+  namespace detail {
+    /** @brief FNV-1a, 64 bits */
+    constexpr std::uint64_t hash(id_type s) {
+      std::uint64_t h = 14695981039346656037ull;
+      for (auto c : s) {
+        h ^= (std::uint64_t) (unsigned char) c;
+        h *= 1099511628211ull;
+      }
+      return h;
+    }
+  } // namespace detail
+
   /**
        * @brief a factory template class
        * @tparam product_base   such as `Shape`
        * @tparam products       such as `Rect`, `Ellipse`, ...
+       * @details The products are looked up in a static table sorted
+       * by the hash of id_name&lt;T>() at compile-time, so create() is a
+       * binary search over integers plus one string compare, and there
+       * is no per-call construction.
+       *
+       * If several products have the same id, the last one wins.
        */
   template<typename product_base, typename... products>
   class factory final {
   public:
     CLAZZ_NON_COPYABLE(factory);
     using string = id_type;
+    static_assert((std::is_base_of<product_base, products>::value && ...), "all products must inherit from product_base");
+
     template<typename T>
     struct clz_name_t {
       string id = id_name<T>();
@@ -116,41 +139,96 @@ namespace undo_cxx::util::factory {
     };
     using named_products = std::tuple<clz_name_t<products>...>;
     // using _T = typename std::conditional<unique, std::unique_ptr<product_base>, std::shared_ptr<product_base>>::type;
-    factory() {
-      std::apply([](auto &&...it) {
-        ((it.static_check() /*static_check<decltype(it.data)>()*/), ...);
-      },
-                 named_products{});
-    }
+    factory() = default;
 
     template<typename... Args>
     static auto create(string const &id, Args &&...args) {
       std::unique_ptr<product_base> result{};
-      std::apply([&](auto &&...it) {
-        ((it.id == id ? result = it.gen(args...) : result), ...);
-      },
-                 named_products{});
+      if (auto const *e = find<Args...>(id))
+        result = e->unique(std::forward<Args>(args)...);
       return result;
     }
+    /** @brief creates the product with std::make_shared, in one allocation */
     template<typename... Args>
     static std::shared_ptr<product_base> make_shared(string const &id, Args &&...args) {
-      std::shared_ptr<product_base> ptr = create(id, args...);
+      std::shared_ptr<product_base> ptr{};
+      if (auto const *e = find<Args...>(id))
+        ptr = e->shared(std::forward<Args>(args)...);
       return ptr;
     }
     template<typename... Args>
     static std::unique_ptr<product_base> make_unique(string const &id, Args &&...args) {
-      return create(id, args...);
+      return create(id, std::forward<Args>(args)...);
     }
     template<typename... Args>
     static product_base *create_nacked_ptr(string const &id, Args &&...args) {
-      return create(id, args...).release();
+      return create(id, std::forward<Args>(args)...).release();
     }
 
+    /** @brief is there a product named id */
+    static bool contains(string const &id) { return find<>(id) != nullptr; }
+
   private:
-    // template<typename product>
-    // static void static_check() {
-    //     static_assert(std::is_base_of<product_base, product>::value, "all products must inherit from product_base");
-    // }
+    template<typename... Args>
+    struct entry_t {
+      std::uint64_t hash;
+      string id;
+      std::unique_ptr<product_base> (*unique)(Args &&...);
+      std::shared_ptr<product_base> (*shared)(Args &&...);
+    };
+
+    template<typename T, typename... Args>
+    static std::unique_ptr<product_base> make_unique_of(Args &&...args) {
+      if constexpr (std::is_constructible_v<T, Args &&...>) {
+        return std::make_unique<T>(std::forward<Args>(args)...);
+      } else {
+        ((void) args, ...);
+        return nullptr;
+      }
+    }
+    template<typename T, typename... Args>
+    static std::shared_ptr<product_base> make_shared_of(Args &&...args) {
+      if constexpr (std::is_constructible_v<T, Args &&...>) {
+        return std::make_shared<T>(std::forward<Args>(args)...);
+      } else {
+        ((void) args, ...);
+        return nullptr;
+      }
+    }
+
+    using table_size = std::integral_constant<std::size_t, sizeof...(products)>;
+    template<typename... Args>
+    using table_t = std::array<entry_t<Args...>, table_size::value>;
+
+    // sorted by hash, the equal ones keep their order (insertion sort)
+    template<typename... Args>
+    static constexpr table_t<Args...> make_table() {
+      table_t<Args...> t{entry_t<Args...>{detail::hash(id_name<products>()), id_name<products>(),
+                                          &make_unique_of<products, Args...>,
+                                          &make_shared_of<products, Args...>}...};
+      for (std::size_t i = 1; i < t.size(); ++i) {
+        for (std::size_t j = i; j > 0 && t[j - 1].hash > t[j].hash; --j) {
+          auto e = t[j];
+          t[j] = t[j - 1];
+          t[j - 1] = e;
+        }
+      }
+      return t;
+    }
+
+    template<typename... Args>
+    static entry_t<Args...> const *find(string const &id) {
+      static constexpr table_t<Args...> table = make_table<Args...>();
+      auto h = detail::hash(id);
+      auto it = std::lower_bound(table.begin(), table.end(), h,
+                                 [](entry_t<Args...> const &e, std::uint64_t v) { return e.hash < v; });
+      entry_t<Args...> const *found{};
+      for (; it != table.end() && it->hash == h; ++it) {
+        if (it->id == id)
+          found = &*it;
+      }
+      return found;
+    }
   }; // class factory
 
 } // namespace undo_cxx::util::factory
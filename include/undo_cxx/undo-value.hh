@@ -0,0 +1,108 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_UNDO_VALUE_HH
+#define UNDO_CXX_UNDO_VALUE_HH
+
+#include "undo-ring.hh"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// ------------------- has_can_be_memento
+namespace undo_cxx::traits {
+
+  /** @brief test for the member function: `bool can_be_memento() const` */
+  template<typename T, typename = void>
+  struct has_can_be_memento : std::false_type {};
+  template<typename T>
+  struct has_can_be_memento<T, decltype(void(std::declval<T const &>().can_be_memento()))> : std::true_type {};
+
+  template<typename T>
+  constexpr inline bool has_can_be_memento_v = has_can_be_memento<T>::value;
+
+} // namespace undo_cxx::traits
+
+// ------------------- value_history_t
+namespace undo_cxx::detail {
+
+  /**
+   * @brief the linear history of the value managers, whose entries
+   * hold the command and its memento: variant_cmd_system_t and
+   * inline_cmd_system_t.
+   * @tparam Derived the manager: it holds the entries in `_history`
+   * (a util::ring_buffer_t) and the cursor in `_cursor`, and dispatches
+   * an entry by `undo_entry(e)` and `redo_entry(e)`
+   * @details The cursor is the number of the entries done. undo() and
+   * redo() call the hooks of the commands themselves.
+   */
+  template<typename Derived>
+  class value_history_t {
+  public:
+    using size_type = std::size_t;
+
+    /** @brief undo one step, false if there's nothing to undo */
+    bool undo() {
+      auto &m = self();
+      if (m._cursor == 0)
+        return false;
+      m.undo_entry(m._history[--m._cursor]);
+      return true;
+    }
+    /** @brief redo one step, false if there's nothing to redo */
+    bool redo() {
+      auto &m = self();
+      if (m._cursor == m._history.size())
+        return false;
+      m.redo_entry(m._history[m._cursor++]);
+      return true;
+    }
+    /** @brief undo back to position pos, newest first; returns the steps */
+    size_type undo_to(size_type pos) {
+      size_type n = 0;
+      while (self()._cursor > pos && undo())
+        n++;
+      return n;
+    }
+    /** @brief redo forward to position pos, oldest first; returns the steps */
+    size_type redo_to(size_type pos) {
+      size_type n = 0;
+      while (self()._cursor < pos && redo())
+        n++;
+      return n;
+    }
+
+    size_type size() const { return self()._history.size(); }
+    bool empty() const { return self()._history.empty(); }
+    /** @brief the number of the entries done, the cursor */
+    size_type position() const { return self()._cursor; }
+    bool can_undo() const { return self()._cursor > 0; }
+    bool can_redo() const { return self()._cursor < self()._history.size(); }
+    /** @brief the i-th entry from the oldest one */
+    auto &at(size_type i) { return self()._history[i]; }
+    auto const &at(size_type i) const { return self()._history[i]; }
+
+    size_type max_size() const { return self()._history.max_size(); }
+
+  protected:
+    value_history_t() = default;
+    ~value_history_t() = default;
+    value_history_t(value_history_t const &) = delete;
+    value_history_t &operator=(value_history_t const &) = delete;
+
+  private:
+    Derived &self() { return static_cast<Derived &>(*this); }
+    Derived const &self() const { return static_cast<Derived const &>(*this); }
+  };
+
+} // namespace undo_cxx::detail
+
+#endif //UNDO_CXX_UNDO_VALUE_HH
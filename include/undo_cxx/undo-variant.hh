@@ -0,0 +1,165 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_UNDO_VARIANT_HH
+#define UNDO_CXX_UNDO_VARIANT_HH
+
+#include "undo-ring.hh"
+#include "undo-value.hh"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// ------------------- variant_cmd_system_t
+namespace undo_cxx {
+
+  /**
+   * @brief an undo manager for a closed set of commands: they're held
+   * by value in a std::variant&lt;Cmds...> inside the history entries,
+   * and dispatched by std::visit.
+   * @tparam State the memento of a command
+   * @tparam Cmds the command types
+   * @details It's the alternative to undoable_cmd_system_t when the
+   * command set is fixed at compile time (as a util::factory&lt;> knows
+   * it): there's no vtable, no shared_ptr and no heap allocation per
+   * command, and the history is one contiguous util::ring_buffer_t of
+   * {command, memento} entries.
+   *
+   * A command is a plain value type, with the non-virtual hooks below.
+   * The context is variant_cmd_system_t::ContextT (`ctx.mgr` is the
+   * manager), which can't be named before the command set is complete,
+   * so the hooks take it by a template parameter.
+   * @code{c++}
+   * struct InsertCmd {
+   *   template&lt;typename C> void execute(C &ctx);           // do it
+   *   template&lt;typename C> State save_state(C &ctx) const; // the memento, after execute()
+   *   template&lt;typename C> void undo(C &ctx, State &memento);
+   *   template&lt;typename C> void redo(C &ctx, State &memento);
+   *   bool can_be_memento() const;                          // optional, true by default
+   * };
+   * using M = undo_cxx::variant_cmd_system_t&lt;State, InsertCmd, DeleteCmd>;
+   * M mgr;
+   * mgr.invoke&lt;InsertCmd>(...);
+   * mgr.undo();
+   * @endcode
+   *
+   * The linear history (undo(), redo(), at(), ...) is the one of
+   * detail::value_history_t. A command is identified
+   * by its index in Cmds (index_of&lt;T>()), rather than by its type
+   * name.
+   */
+  template<typename State, typename... Cmds>
+  class variant_cmd_system_t : public detail::value_history_t<variant_cmd_system_t<State, Cmds...>> {
+  public:
+    using StateT = State;
+    using CmdT = std::variant<Cmds...>;
+    using size_type = std::size_t;
+
+    struct ContextT {
+      variant_cmd_system_t &mgr;
+    };
+
+    /** @brief a history entry: the command and its memento */
+    struct entry_t {
+      CmdT cmd;
+      StateT state;
+    };
+    using Container = util::ring_buffer_t<entry_t>;
+
+  private:
+    friend class detail::value_history_t<variant_cmd_system_t>;
+
+    template<typename T, std::size_t I = 0>
+    static constexpr std::size_t find_index() {
+      if constexpr (I == sizeof...(Cmds))
+        return I;
+      else if constexpr (std::is_same_v<T, std::variant_alternative_t<I, CmdT>>)
+        return I;
+      else
+        return find_index<T, I + 1>();
+    }
+
+  public:
+    variant_cmd_system_t() = default;
+    ~variant_cmd_system_t() = default;
+    variant_cmd_system_t(variant_cmd_system_t const &) = delete;
+    variant_cmd_system_t &operator=(variant_cmd_system_t const &) = delete;
+
+    /** @brief the index of the command type T in Cmds */
+    template<typename T>
+    static constexpr std::size_t index_of() {
+      constexpr auto i = find_index<T>();
+      static_assert(i < sizeof...(Cmds), "T isn't one of the commands");
+      return i;
+    }
+
+    /** @brief construct a ConcreteCmd in place, and invoke it */
+    template<typename ConcreteCmd, typename... Args>
+    void invoke(Args &&...args) {
+      static_assert(find_index<ConcreteCmd>() < sizeof...(Cmds), "ConcreteCmd isn't one of the commands");
+      ConcreteCmd cmd{std::forward<Args>(args)...};
+      invoke_as(cmd);
+    }
+    /** @brief invoke a command of any type in Cmds */
+    void invoke(CmdT cmd) {
+      std::visit([this](auto &c) { invoke_as(c); }, cmd);
+    }
+
+    /** @brief the footprint of the history, the entries are all inline */
+    std::size_t memory_usage() const { return _history.capacity() * sizeof(entry_t); }
+
+    using detail::value_history_t<variant_cmd_system_t>::max_size;
+    /** @brief bound the history, the oldest entries are evicted in O(1) */
+    void max_size(size_type max_value) {
+      auto before = _history.size();
+      _history.max_size(max_value);
+      auto dropped = before - _history.size();
+      _cursor = _cursor > dropped ? _cursor - dropped : 0;
+    }
+
+    void clear() {
+      _history.clear();
+      _cursor = 0;
+    }
+
+  private:
+    void undo_entry(entry_t &e) {
+      std::visit([this, &e](auto &c) { c.undo(_ctx, e.state); }, e.cmd);
+    }
+    void redo_entry(entry_t &e) {
+      std::visit([this, &e](auto &c) { c.redo(_ctx, e.state); }, e.cmd);
+    }
+
+    template<typename T>
+    void invoke_as(T &cmd) {
+      cmd.execute(_ctx);
+      if constexpr (traits::has_can_be_memento_v<T>) {
+        if (!cmd.can_be_memento())
+          return;
+      }
+      auto s = cmd.save_state(_ctx);
+      // a new command discards the redo tail
+      while (_history.size() > _cursor)
+        _history.pop_back();
+      _history.emplace_back(entry_t{CmdT{std::in_place_type<T>, std::move(cmd)}, std::move(s)});
+      _cursor = _history.size();
+    }
+
+  private:
+    Container _history{};
+    size_type _cursor{};
+    ContextT _ctx{*this};
+  };
+
+} // namespace undo_cxx
+
+#endif //UNDO_CXX_UNDO_VARIANT_HH
@@ -11,10 +11,39 @@
 #ifndef UNDO_CXX_UNDO_ZCORE_HH
 #define UNDO_CXX_UNDO_ZCORE_HH
 
+#include "undo-cow.hh"
+#include "undo-delta.hh"
+#include "undo-footprint.hh"
+#include "undo-intrusive.hh"
 #include "undo-log.hh"
-
+#include "undo-pool.hh"
+#include "undo-ring.hh"
+#include "undo-shared.hh"
+#include "undo-tier.hh"
+#include "undo-trace.hh"
+#include "undo-tree.hh"
+#include "undo-value.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iterator>
 #include <list>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <limits.h> // SIZE_T_MAX
@@ -30,7 +59,7 @@ namespace undo_cxx {
   template<typename State, typename Base = base_cmd_t>
   class cmd_t;
 
-  template<typename State>
+  template<typename State, typename BaseCmdT = base_cmd_t>
   struct context_t;
 
   /**
@@ -53,18 +82,148 @@ namespace undo_cxx {
            typename Cmd = RefCmdT<State, BaseCmdT>>
   using MgrT = undoable_cmd_system_t<State, Context, BaseCmdT, RefCmdT, Cmd>;
 
+  /**
+   * @brief the undo manager whose commands are held by intrusive_ptr
+   * rather than std::shared_ptr: the reference count lives inside the
+   * command, no control block is allocated.
+   * @tparam Policy single_thread_ref_count_t for the non-atomic counting
+   * @details The commands derive from `cmd_t<State, intrusive_base_cmd_t<Policy>>`:
+   * @code{c++}
+   * template&lt;typename State>
+   * class TextCmd : public undo_cxx::cmd_t&lt;State, undo_cxx::intrusive_base_cmd_t&lt;>> {
+   * public:
+   *   UNDO_CXX_DEFINE_BASED_CMD_TYPES(TextCmd, undo_cxx::cmd_t, undo_cxx::intrusive_base_cmd_t&lt;>);
+   *   ...
+   * };
+   * @endcode
+   */
+  template<typename State, typename Policy = multi_thread_ref_count_t>
+  using intrusive_cmd_system_t = undoable_cmd_system_t<State, context_t<State, intrusive_base_cmd_t<Policy>>, intrusive_base_cmd_t<Policy>>;
+
 } // namespace undo_cxx
 
-// context_t --------------------
+// history_traits_t --------------------
+
+/**
+ * @brief set to 1 to make the undo manager use the contiguous ring
+ * buffer (util::ring_buffer_t) as its history container, instead
+ * of std::list.
+ */
+#if !defined(UNDO_CXX_HISTORY_RING_BUFFER)
+#define UNDO_CXX_HISTORY_RING_BUFFER 0
+#endif
+
+/**
+ * @brief the default keyframe interval for the delta mementos, see
+ * also delta_state_t.
+ */
+#if !defined(UNDO_CXX_HISTORY_KEYFRAME_INTERVAL)
+#define UNDO_CXX_HISTORY_KEYFRAME_INTERVAL 32
+#endif
+
 namespace undo_cxx {
 
+  /**
+   * @brief the default policies of undoable_cmd_system_t.
+   */
+  struct default_history_traits_t {
+    /** @brief the history tracer, see also UNDO_CXX_HISTORY_TRACE */
+    using tracer = trace::default_tracer_t;
+    /** @brief the history container, see also UNDO_CXX_HISTORY_RING_BUFFER */
+#if UNDO_CXX_HISTORY_RING_BUFFER
+    template<typename T>
+    using container = util::ring_buffer_t<T>;
+#else
+    template<typename T>
+    using container = std::list<T>;
+#endif
+    /** @brief at most one keyframe per N delta mementos, see also delta_state_t */
+    static constexpr std::size_t keyframe_interval = UNDO_CXX_HISTORY_KEYFRAME_INTERVAL;
+    /** @brief the commands saved within this interval may be merged, see undoable_cmd_system_t::merge_window() */
+    static constexpr std::chrono::milliseconds merge_window{1000};
+    /** @brief merge the commands of the same type only, see undoable_cmd_system_t::merge_same_id() */
+    static constexpr bool merge_same_id = true;
+    /**
+     * @brief allocate the mementos (state_t) themselves from the arena
+     * of the manager, see memento_resource(). It costs a header per
+     * memento, so it's off by default: the pairs of a memento are
+     * always in the arena, the memento is on the global heap.
+     */
+    static constexpr bool memento_arena = false;
+
+    // the optional tiers of undoable_cmd_system_t. A tier turned off
+    // costs the manager neither room nor code: its API fails to compile
+    // (or reports nothing, for the getters).
+
+    /** @brief build the mementos on a worker pool, see undoable_cmd_system_t::async_save() */
+    static constexpr bool async_save = false;
+    /** @brief write the history into a journal_t, see undoable_cmd_system_t::journal() */
+    static constexpr bool journal = false;
+    /** @brief keep the cold mementos in a cold_store_t, see undoable_cmd_system_t::spill() */
+    static constexpr bool spill = false;
+    /** @brief merge the consecutive commands, see undoable_cmd_system_t::merge_window() */
+    static constexpr bool merge = false;
+    /** @brief keep the redo branches, see undoable_cmd_system_t::tree_mode() */
+    static constexpr bool tree = false;
+    /** @brief index the footprints for undoable_cmd_system_t::undo_entry() out of order */
+    static constexpr bool selective = false;
+    /** @brief share a history_pool_t with the other managers */
+    static constexpr bool shared_pool = false;
+    /** @brief group the commands into one entry, see undoable_cmd_system_t::begin_group() */
+    static constexpr bool groups = false;
+
+    /** @brief the footprint of a state in bytes, S::memory_usage() if it exists */
+    template<typename S>
+    static std::size_t memory_usage(S const &s) {
+      if constexpr (traits::has_memory_usage_v<S>) {
+        return s.memory_usage();
+      } else {
+        UNUSED(s);
+        return sizeof(S);
+      }
+    }
+  };
+
+  /**
+   * @brief the policies of undoable_cmd_system_t for a State.
+   * @tparam State 
+   * @details Specialize it for your State to tune the undo manager,
+   * derive from default_history_traits_t and override the members
+   * you want. For example:
+   * @code{c++}
+   * template&lt;>
+   * struct undo_cxx::history_traits_t&lt;my_state> : undo_cxx::default_history_traits_t {
+   *   using tracer = undo_cxx::trace::ring_tracer_t&lt;256>;
+   *   static constexpr bool journal = true;
+   * };
+   * @endcode
+   */
   template<typename State>
+  struct history_traits_t : default_history_traits_t {};
+
+  /**
+   * @brief the policies with an allocator-aware history container, so
+   * that the history nodes and the mementos are allocated from the
+   * arena as well, see also undoable_cmd_system_t(std::pmr::memory_resource *).
+   */
+  struct pmr_history_traits_t : default_history_traits_t {
+    template<typename T>
+    using container = std::pmr::list<T>;
+    static constexpr bool memento_arena = true;
+  };
+
+} // namespace undo_cxx
+
+// context_t --------------------
+namespace undo_cxx {
+
+  template<typename State, typename BaseCmdT_>
   struct context_t {
-    using BaseCmdT = base_cmd_t;
+    using BaseCmdT = BaseCmdT_;
     template<class S, class B>
     using RefCmdT = cmd_t<S, B>;
     using Cmd = RefCmdT<State, BaseCmdT>;
-    using ContextT = context_t<State>;
+    using ContextT = context_t<State, BaseCmdT>;
     using Mgr = undoable_cmd_system_t<State, ContextT, BaseCmdT, cmd_t, Cmd>;
 
     Mgr &mgr;
@@ -75,42 +234,161 @@ namespace undo_cxx {
 
 } // namespace undo_cxx
 
+// memento_resource --------------------
+namespace undo_cxx {
+
+  namespace detail {
+    inline std::pmr::memory_resource *&current_memento_resource() {
+      static thread_local std::pmr::memory_resource *r{};
+      return r;
+    }
+  } // namespace detail
+
+  /**
+   * @brief the memory resource of the state_t objects being created
+   * on this thread, std::pmr::get_default_resource() by default.
+   */
+  inline std::pmr::memory_resource *memento_resource() {
+    auto *r = detail::current_memento_resource();
+    return r ? r : std::pmr::get_default_resource();
+  }
+
+  /**
+   * @brief routes the allocations of state_t into a memory resource,
+   * while it's alive.
+   * @details undoable_cmd_system_t sets it up around save_state(), so
+   * that `std::make_unique<Memento>(...)` in a command allocates the
+   * memento (and its pairs) from the arena of the manager.
+   */
+  class memento_resource_scope_t {
+  public:
+    explicit memento_resource_scope_t(std::pmr::memory_resource *r)
+        : _saved(std::exchange(detail::current_memento_resource(), r)) {}
+    ~memento_resource_scope_t() { detail::current_memento_resource() = _saved; }
+    memento_resource_scope_t(memento_resource_scope_t const &) = delete;
+    memento_resource_scope_t &operator=(memento_resource_scope_t const &) = delete;
+
+  private:
+    std::pmr::memory_resource *_saved;
+  };
+
+  namespace detail {
+    // the allocation of state_t, by the global new unless the traits
+    // opt in history_traits_t::memento_arena
+    template<bool Arena>
+    struct memento_alloc_t {
+      static constexpr std::size_t header_size = 0;
+    };
+
+    // from memento_resource(), which is recorded in a header ahead of
+    // the object so that it can be deleted anywhere.
+    template<>
+    struct memento_alloc_t<true> {
+      static constexpr std::size_t header_size = alignof(std::max_align_t);
+      static_assert(header_size >= sizeof(std::pmr::memory_resource *));
+
+      static void *operator new(std::size_t n) {
+        auto *r = memento_resource();
+        auto *p = static_cast<std::byte *>(r->allocate(n + header_size, alignof(std::max_align_t)));
+        ::new (p) std::pmr::memory_resource *(r);
+        return p + header_size;
+      }
+      static void operator delete(void *ptr, std::size_t n) {
+        auto *p = static_cast<std::byte *>(ptr) - header_size;
+        auto *r = *std::launder(reinterpret_cast<std::pmr::memory_resource **>(p));
+        r->deallocate(p, n + header_size, alignof(std::max_align_t));
+      }
+    };
+  } // namespace detail
+
+} // namespace undo_cxx
+
 // state_t --------------------
 namespace undo_cxx {
   template<typename State,
            typename BaseCmdT = base_cmd_t,
            template<class S, class B> typename RefCmdT = cmd_t,
            typename Cmd = RefCmdT<State, BaseCmdT>>
-  struct state_t {
+  struct state_t : detail::memento_alloc_t<history_traits_t<State>::memento_arena> {
     using StateT = State;
     using CmdT = Cmd;
     // using CmdPtr = CmdT const *; // std::weak_ptr<const CmdT>;
     // using CmdWP = std::weak_ptr<CmdT const>;
     // using CmdSPC = std::shared_ptr<CmdT const>;
-    using CmdSP = std::shared_ptr<CmdT>;
+    using CmdSP = cmd_handle_t<BaseCmdT, CmdT>;
     using Pair = std::pair<CmdSP, StateT>;
-    using PairVec = std::vector<Pair>;
+    using PairVec = std::pmr::vector<Pair>;
 
     state_t() = default;
     ~state_t() = default;
+    state_t(state_t const &) = default;
+    state_t(state_t &&) = default;
+    state_t &operator=(state_t const &) = default;
+    state_t &operator=(state_t &&) = default;
     state_t(CmdSP &c, StateT const &s) { pairs.push_back(Pair{c, s}); }
-
+    state_t(CmdSP &c, StateT &&s) { pairs.emplace_back(c, std::move(s)); }
+
+    /** @brief reserve the room for n pairs */
+    void reserve(std::size_t n) { pairs.reserve(n); }
+    /** @brief keep the first n pairs */
+    void truncate(std::size_t n) {
+      if (n < pairs.size())
+        pairs.erase(pairs.begin() + (std::ptrdiff_t) n, pairs.end());
+    }
     void add_state(CmdSP &c, StateT const &s) { emplace_back(c, s); }
+    void add_state(CmdSP &c, StateT &&s) { emplace_back(c, std::move(s)); }
     void emplace_back(CmdSP &c, StateT const &s) { pairs.emplace_back(c, s); }
+    void emplace_back(CmdSP &c, StateT &&s) { pairs.emplace_back(c, std::move(s)); }
+    /**
+     * @brief append the state of c from its memento m: the pairs of its
+     * children if m is a composite memento (of a nested composite), or
+     * else its own state.
+     */
+    void splice(CmdSP &c, state_t &&m) {
+      if (m.size() > 1) {
+        for (auto it = std::next(m.pairs.begin()); it != m.pairs.end(); ++it)
+          pairs.emplace_back(std::move(*it));
+      } else {
+        pairs.emplace_back(c, std::move(m()));
+      }
+    }
 
-    template<class _InputIterator, class _Function>
-    _Function for_each_children(_Function &&fn) {
+    template<class _Function>
+    void for_each_children(_Function &&fn) {
+      if (pairs.empty()) return;
       auto it = pairs.begin();
       it++;
-      return std::for_each(it, pairs.end(), fn);
+      std::for_each(it, pairs.end(), fn);
+    }
+    template<class _Function>
+    void for_each_children_reverse(_Function &&fn) {
+      if (pairs.empty()) return;
+      std::for_each(pairs.rbegin(), std::prev(pairs.rend()), fn);
+    }
+    /** @brief fn(StateT const &) for the state of the command and its children */
+    template<class _Function>
+    void for_each_state(_Function &&fn) const {
+      for (auto const &p : pairs)
+        fn(p.second);
+    }
+    /** @brief fn(StateT &) for the state of the command and its children */
+    template<class _Function>
+    void for_each_state(_Function &&fn) {
+      for (auto &p : pairs)
+        fn(p.second);
     }
 
+    /** @brief the number of the pairs, the command itself and its children */
+    std::size_t size() const { return pairs.size(); }
+    /** @brief the i-th pair, 0 is the command itself */
+    Pair &at(std::size_t i) { return pairs[i]; }
+
     CmdSP &command() { return pairs[0].first; }
     state_t &command(CmdSP &c) {
       if (pairs.empty())
         pairs.emplace_back(c, StateT{});
       else
-        pairs[0].first = CmdSP(c);
+        pairs[0].first = c;
       return (*this);
     }
     StateT const &operator()() const { return pairs[0].second; }
@@ -123,19 +401,42 @@ namespace undo_cxx {
         pairs[0].second = s;
       return (*this);
     }
+    state_t &operator=(StateT &&s) {
+      if (pairs.empty())
+        pairs.emplace_back(CmdSP{}, std::move(s));
+      else
+        pairs[0].second = std::move(s);
+      return (*this);
+    }
 
     friend std::ostream &operator<<(std::ostream &os, state_t const &o) {
       return os << o();
     }
 
+    /**
+     * @brief the footprint the history has charged for it, that's its
+     * memory_usage() when it was saved, or last rebuilt by the history.
+     */
+    std::size_t charged_bytes() const { return charged; }
+    void charged_bytes(std::size_t n) { charged = n; }
+
+    /** @brief the footprint in bytes, see also history_traits_t::memory_usage() */
+    std::size_t memory_usage() const {
+      std::size_t n = sizeof(state_t) + detail::memento_alloc_t<history_traits_t<State>::memento_arena>::header_size;
+      for (auto const &p : pairs)
+        n += sizeof(CmdSP) + history_traits_t<StateT>::memory_usage(p.second);
+      return n;
+    }
+
   private:
-    template<class _InputIterator, class _Function>
-    _Function for_each(_Function &&fn) {
-      return std::for_each(pairs.begin(), pairs.end(), fn);
+    template<class _Function>
+    void for_each(_Function &&fn) {
+      std::for_each(pairs.begin(), pairs.end(), fn);
     }
 
   private:
-    PairVec pairs{};
+    PairVec pairs{memento_resource()};
+    std::size_t charged{};
   };
 } // namespace undo_cxx
 
@@ -153,19 +454,21 @@ namespace undo_cxx {
     ~cmd_t() override = default;
 
     using Self = cmd_t<State, Base>;
-    using CmdSP = std::shared_ptr<Self>;
-    using CmdSPC = std::shared_ptr<Self const>;
+    using CmdSP = cmd_handle_t<Base, Self>;
+    using CmdSPC = cmd_handle_t<Base, Self const>;
     using CmdId = std::string_view;
     CmdId id() const { return debug::type_name<Self>(); }
 
-    using ContextT = context_t<State>;
+    using ContextT = context_t<State, Base>;
     void execute(CmdSP &sender, ContextT &ctx) { do_execute(sender, ctx); }
 
     using StateT = State;
     using StateUniPtr = std::unique_ptr<StateT>;
-    using Memento = state_t<StateT>;
+    using Memento = state_t<StateT, Base>;
     using MementoPtr = typename std::unique_ptr<Memento>;
+    using MementoFn = std::function<MementoPtr()>;
     MementoPtr save_state(CmdSP &sender, ContextT &ctx) { return save_state_impl(sender, ctx); }
+    MementoFn capture_state(CmdSP &sender, ContextT &ctx) { return capture_state_impl(sender, ctx); }
     void undo(CmdSP &sender, ContextT &ctx, Memento &memento) { undo_impl(sender, ctx, memento); }
     void redo(CmdSP &sender, ContextT &ctx, Memento &memento) { redo_impl(sender, ctx, memento); }
     virtual bool can_be_memento() const { return true; }
@@ -175,6 +478,23 @@ namespace undo_cxx {
     virtual MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) = 0;
     virtual void undo_impl(CmdSP &sender, ContextT &ctx, Memento &memento) = 0;
     virtual void redo_impl(CmdSP &sender, ContextT &ctx, Memento &memento) = 0;
+    /**
+     * @brief the quick half of save_state() for the asynchronous save
+     * (see undoable_cmd_system_t::async_save()): capture what's needed
+     * on the caller thread, and return the slow half, which builds the
+     * memento on a worker thread.
+     * @details The returned function must not touch ctx or the
+     * document. The default one is empty, that means to save
+     * synchronously by save_state_impl().
+     * @code{c++}
+     * MementoFn capture_state_impl(CmdSP &sender, ContextT &) override {
+     *   return [sender, doc = document.snapshot()]() mutable {
+     *     return std::make_unique&lt;Memento>(sender, State::build(doc));
+     *   };
+     * }
+     * @endcode
+     */
+    virtual MementoFn capture_state_impl(CmdSP &, ContextT &) { return {}; }
   };
 
 } // namespace undo_cxx
@@ -185,6 +505,7 @@ namespace undo_cxx {
   using CmdId = typename Super::CmdId;          \
   using Memento = typename Base::Memento;       \
   using MementoPtr = typename Base::MementoPtr; \
+  using MementoFn = typename Base::MementoFn;   \
   using ContextT = typename Base::ContextT
 
 #define UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(SelfType, SuperType) \
@@ -192,11 +513,21 @@ namespace undo_cxx {
   using Self = SelfType<State>;                                \
   UNDO_CXX_DEFINE_CMD_TYPES()
 
+// for the commands on a non-default base, such as intrusive_base_cmd_t<>
+#define UNDO_CXX_DEFINE_BASED_CMD_TYPES(SelfType, SuperType, BaseCmdType) \
+  using Super = SuperType<State, BaseCmdType>;                          \
+  using Self = SelfType<State>;                                         \
+  UNDO_CXX_DEFINE_CMD_TYPES()
+
 // composite_cmd_t --------------------
 namespace undo_cxx {
 
   /**
      * @brief A composite command which groups the multiple commands as one.
+     * @details The children are kept in a vector, see reserve(). Once
+     * the composite is complete, close() flattens the composites nested
+     * in it, so the children, and the pairs of the composite memento,
+     * are one linear array of the leaf commands in their order.
      */
   template<typename State, typename BaseCmdT = base_cmd_t,
            template<class S, class B> typename RefCmdT = cmd_t>
@@ -215,60 +546,365 @@ namespace undo_cxx {
     using StateT = State;
     using CmdT = typename Super::Self; //RefCmdT<StateT, BaseCmdT>;
     using CmdPtr = CmdT const *;
-    using ContainerT = std::list<CmdSP>;
+    using ContainerT = std::vector<CmdSP>;
 
   public:
     void add_command(CmdSP &&cmd) {
-      _commands.emplace_back(cmd);
+      _commands.emplace_back(std::move(cmd));
+      _closed = false;
     }
-    template<class _InputIterator, class _Function>
-    _Function for_each(_Function &&fn) {
-      return std::for_each(_commands.begin(), _commands.end(), fn);
+    /** @brief reserve the room for n children */
+    void reserve(std::size_t n) { _commands.reserve(n); }
+    template<class _Function>
+    void for_each(_Function &&fn) {
+      std::for_each(_commands.begin(), _commands.end(), fn);
     }
+    auto size() const { return _commands.size(); }
+    bool empty() const { return _commands.empty(); }
+
+    /**
+     * @brief the composite is complete: replace the nested composites
+     * (of this very type, not a derived one) by their children,
+     * recursively.
+     * @details The nested composites are left as they are, and may be
+     * shared. A later add_command() reopens the composite.
+     */
+    void close() {
+      if (_closed)
+        return;
+      ContainerT flat;
+      flat.reserve(leaves(_commands));
+      flatten(flat, _commands);
+      _commands = std::move(flat);
+      _closed = true;
+    }
+    bool closed() const { return _closed; }
 
   protected:
     void do_execute(CmdSP &sender, ContextT &ctx) override {
       UNUSED(sender);
       for_each([&](CmdSP &cmd) {
-        cmd->do_execute(ctx);
+        cmd->execute(cmd, ctx);
       });
     }
-    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
-      MementoPtr r = std::make_unique<Memento>(this, StateT{});
-      for_each([sender, r, this](CmdSP &cmd) {
-        r->emplace_back(cmd, cmd->save_state_impl(sender));
+    // the composite memento: the first pair is the composite command
+    // itself, and then a pair per leaf command, the ones of a nested
+    // composite are spliced in.
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) override {
+      MementoPtr r = std::make_unique<Memento>(sender, StateT{});
+      r->reserve(_commands.size() + 1);
+      for_each([&](CmdSP &cmd) {
+        auto m = cmd->save_state(cmd, ctx);
+        r->splice(cmd, std::move(*m));
       });
       return r;
     }
     void undo_impl(CmdSP &sender, ContextT &ctx, Memento &memento) override {
-      UNUSED(memento);
       if (memento.command().get() == this) {
-        // composite memento (state_t):
-        memento.for_each_children([ctx](typename Memento::Pair const &item) {
-          item.first.undo_impl(item.first, ctx, item.second);
+        // composite memento (state_t), undo the children backward:
+        memento.for_each_children_reverse([&ctx](typename Memento::Pair &item) {
+          Memento child{item.first, std::move(item.second)};
+          item.first->undo(item.first, ctx, child);
+          item.second = std::move(child());
         });
       } else {
-        for_each([sender, ctx, memento, this](CmdSP &cmd) {
+        std::for_each(_commands.rbegin(), _commands.rend(), [&](CmdSP &cmd) {
           cmd->undo(sender, ctx, memento);
         });
       }
     }
     void redo_impl(CmdSP &sender, ContextT &ctx, Memento &memento) override {
-      UNUSED(memento);
-      if (memento.command() == this) {
-        // composie memento (state_t):
-        memento.for_each_children([ctx](typename Memento::Pair const &item) {
-          item.first.redo_impl(item.first, ctx, item.second);
+      if (memento.command().get() == this) {
+        // composite memento (state_t):
+        memento.for_each_children([&ctx](typename Memento::Pair &item) {
+          Memento child{item.first, std::move(item.second)};
+          item.first->redo(item.first, ctx, child);
+          item.second = std::move(child());
         });
       } else {
-        for_each([sender, ctx, memento, this](CmdSP &cmd) {
+        for_each([&](CmdSP &cmd) {
           cmd->redo(sender, ctx, memento);
         });
       }
     }
 
+  private:
+    // the nested composite of this type, or nullptr
+    static Self const *nested(CmdSP const &cmd) {
+      if (!cmd)
+        return nullptr;
+      auto &c = *cmd;
+      return typeid(c) == typeid(Self) ? static_cast<Self const *>(cmd.get()) : nullptr;
+    }
+    static std::size_t leaves(ContainerT const &from) {
+      std::size_t n = 0;
+      for (auto const &cmd : from) {
+        auto const *c = nested(cmd);
+        n += c ? leaves(c->_commands) : 1;
+      }
+      return n;
+    }
+    static void flatten(ContainerT &to, ContainerT const &from) {
+      for (auto const &cmd : from) {
+        if (auto const *c = nested(cmd))
+          flatten(to, c->_commands);
+        else
+          to.push_back(cmd);
+      }
+    }
+
   private:
     ContainerT _commands;
+    bool _closed{};
+  };
+
+} // namespace undo_cxx
+
+// group_cmd_t --------------------
+namespace undo_cxx {
+
+  /**
+   * @brief the composite command of a group, see
+   * undoable_cmd_system_t::begin_group().
+   */
+  template<typename State, typename BaseCmdT = base_cmd_t,
+           template<class S, class B> typename RefCmdT = cmd_t>
+  class group_cmd_t : public composite_cmd_t<State, BaseCmdT, RefCmdT> {
+  public:
+    ~group_cmd_t() override = default;
+    explicit group_cmd_t(std::string_view name)
+        : _name(name) {}
+
+    /** @brief the name given to begin_group() */
+    std::string const &name() const { return _name; }
+
+  private:
+    std::string _name;
+  };
+
+} // namespace undo_cxx
+
+// parallel_composite_cmd_t --------------------
+namespace undo_cxx {
+
+  /**
+   * @brief A composite command whose independent children run in
+   * parallel on a util::stealing_pool_t.
+   * @details The children declare their footprints (see footprint_t),
+   * and add_command() places each one in the first wave after the
+   * children it depends on: a child depends on an earlier one if it
+   * reads or writes a key the earlier one writes, or writes a key the
+   * earlier one reads. A child without a footprint is a barrier, it
+   * runs alone after all the earlier children.
+   *
+   * The waves run in turn (backward for undo), the children of a wave
+   * in parallel. The composite memento has the pairs of the children
+   * in the order they were added, a nested composite's ones spliced
+   * in; so it's the same as the one of composite_cmd_t, whatever the
+   * scheduling. Without a pool, the children run in turn like
+   * composite_cmd_t.
+   *
+   * The children share the context, and must touch nothing out of
+   * their footprints. Their own mementos are built on the workers, so
+   * they come from the default resource rather than the arena of the
+   * manager (see memento_resource(), the arena isn't synchronized);
+   * their states are moved into the composite memento afterwards.
+   * @code{c++}
+   * undo_cxx::util::stealing_pool_t pool;
+   * auto style = std::make_shared&lt;undo_cxx::parallel_composite_cmd_t&lt;State>>(&pool);
+   * for (auto id : selection)
+   *   style->add_command(std::make_shared&lt;StyleCmd>(id, ...)); // its footprint() writes id
+   * mgr.invoke(style);
+   * @endcode
+   */
+  template<typename State, typename BaseCmdT = base_cmd_t,
+           template<class S, class B> typename RefCmdT = cmd_t>
+  class parallel_composite_cmd_t : public RefCmdT<State, BaseCmdT> {
+  public:
+    ~parallel_composite_cmd_t() override = default;
+    explicit parallel_composite_cmd_t(util::stealing_pool_t *pool = nullptr)
+        : _pool(pool) {}
+
+    using Super = RefCmdT<State, BaseCmdT>;
+    using Self = parallel_composite_cmd_t<State, BaseCmdT, RefCmdT>;
+    UNDO_CXX_DEFINE_CMD_TYPES();
+    using StateT = State;
+    using ContainerT = std::vector<CmdSP>;
+
+  private:
+    template<typename T, typename = void>
+    struct has_footprint : std::false_type {};
+    template<typename T>
+    struct has_footprint<T, decltype(void(std::declval<T const &>().footprint(std::declval<footprint_t &>())))> : std::true_type {};
+
+  public:
+    /** @brief add a child, by its footprint if its type has one */
+    template<typename Ptr>
+    void add_command(Ptr &&cmd) {
+      using T = std::remove_cv_t<std::remove_reference_t<decltype(*cmd)>>;
+      if constexpr (has_footprint<T>::value) {
+        footprint_t fp;
+        cmd->footprint(fp);
+        place(&fp);
+      } else {
+        place(nullptr);
+      }
+      _commands.emplace_back(std::forward<Ptr>(cmd));
+    }
+    template<class _Function>
+    void for_each(_Function &&fn) {
+      std::for_each(_commands.begin(), _commands.end(), fn);
+    }
+    auto size() const { return _commands.size(); }
+    bool empty() const { return _commands.empty(); }
+
+    /** @brief the number of the waves */
+    std::size_t waves() const { return _waves; }
+    /** @brief the wave of the i-th child */
+    std::size_t wave_of(std::size_t i) const { return _wave[i]; }
+
+    util::stealing_pool_t *pool() const { return _pool; }
+    /** @brief run the children on pool, or in turn if it's nullptr */
+    void pool(util::stealing_pool_t *pool) { _pool = pool; }
+
+  protected:
+    void do_execute(CmdSP &sender, ContextT &ctx) override {
+      UNUSED(sender);
+      run(false, [&](std::size_t i) {
+        auto &cmd = _commands[i];
+        cmd->execute(cmd, ctx);
+      });
+    }
+    // the composite memento: the first pair is the composite command
+    // itself, and then the pairs of each child in the order they were
+    // added, the ones of a nested composite are spliced in. The pairs
+    // of the i-th child begin at _slots[i].
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) override {
+      std::vector<MementoPtr> children(_commands.size());
+      run(false, [&](std::size_t i) {
+        auto &cmd = _commands[i];
+        children[i] = cmd->save_state(cmd, ctx);
+      });
+      MementoPtr r = std::make_unique<Memento>(sender, StateT{});
+      r->reserve(_commands.size() + 1);
+      _slots.resize(_commands.size() + 1);
+      for (std::size_t i = 0; i < _commands.size(); i++) {
+        _slots[i] = r->size();
+        r->splice(_commands[i], std::move(*children[i]));
+      }
+      _slots.back() = r->size();
+      return r;
+    }
+    void undo_impl(CmdSP &sender, ContextT &ctx, Memento &memento) override {
+      if (owns(memento)) {
+        run(true, [&](std::size_t i) {
+          for (auto j = _slots[i + 1]; j-- > _slots[i];)
+            replay(memento.at(j), ctx, true);
+        });
+      } else {
+        std::for_each(_commands.rbegin(), _commands.rend(), [&](CmdSP &cmd) {
+          cmd->undo(sender, ctx, memento);
+        });
+      }
+    }
+    void redo_impl(CmdSP &sender, ContextT &ctx, Memento &memento) override {
+      if (owns(memento)) {
+        run(false, [&](std::size_t i) {
+          for (auto j = _slots[i]; j < _slots[i + 1]; j++)
+            replay(memento.at(j), ctx, false);
+        });
+      } else {
+        for_each([&](CmdSP &cmd) {
+          cmd->redo(sender, ctx, memento);
+        });
+      }
+    }
+
+  private:
+    // a composite memento saved by this command
+    bool owns(Memento &memento) const {
+      return memento.command().get() == this && _slots.size() == _commands.size() + 1 && memento.size() == _slots.back();
+    }
+    // undo or redo the command of a pair of a composite memento
+    static void replay(typename Memento::Pair &item, ContextT &ctx, bool undo) {
+      Memento child{item.first, std::move(item.second)};
+      if (undo)
+        item.first->undo(item.first, ctx, child);
+      else
+        item.first->redo(item.first, ctx, child);
+      item.second = std::move(child());
+    }
+    // the wave of a new child, after the ones it depends on
+    void place(footprint_t const *fp) {
+      auto w = _barrier;
+      if (!fp) {
+        w = _waves;
+        _barrier = w + 1;
+      } else {
+        auto after = [&w](auto const &last, std::uint64_t k) {
+          if (auto it = last.find(k); it != last.end())
+            w = std::max(w, it->second);
+        };
+        for (auto k : fp->writes) {
+          after(_written, k);
+          after(_read, k);
+        }
+        for (auto k : fp->reads)
+          after(_written, k);
+        for (auto k : fp->writes)
+          _written[k] = std::max(_written[k], w + 1);
+        for (auto k : fp->reads)
+          _read[k] = std::max(_read[k], w + 1);
+      }
+      _wave.push_back(w);
+      _waves = std::max(_waves, w + 1);
+      _order.clear();
+    }
+    // group the children by their waves, in the order they were added
+    void schedule() {
+      if (_order.size() == _commands.size())
+        return;
+      _starts.assign(_waves + 1, 0);
+      for (auto w : _wave)
+        _starts[w + 1]++;
+      for (std::size_t w = 0; w < _waves; w++)
+        _starts[w + 1] += _starts[w];
+      _order.resize(_commands.size());
+      auto next = _starts;
+      for (std::size_t i = 0; i < _wave.size(); i++)
+        _order[next[_wave[i]]++] = i;
+    }
+    // fn(i) for each child, a wave after another
+    template<typename Fn>
+    void run(bool backward, Fn &&fn) {
+      if (!_pool) {
+        for (std::size_t k = 0; k < _commands.size(); k++)
+          fn(backward ? _commands.size() - 1 - k : k);
+        return;
+      }
+      schedule();
+      for (std::size_t k = 0; k < _waves; k++) {
+        auto w = backward ? _waves - 1 - k : k;
+        auto b = _starts[w], n = _starts[w + 1] - b;
+        if (n == 1)
+          fn(_order[b]);
+        else
+          _pool->parallel_for(n, [&](std::size_t j) { fn(_order[b + j]); });
+      }
+    }
+
+  private:
+    ContainerT _commands{};
+    std::vector<std::size_t> _slots{};
+    std::vector<std::size_t> _wave{};
+    std::vector<std::size_t> _order{};
+    std::vector<std::size_t> _starts{};
+    // the wave after the last child writing, or reading, a key
+    std::unordered_map<std::uint64_t, std::size_t> _written{};
+    std::unordered_map<std::uint64_t, std::size_t> _read{};
+    std::size_t _barrier{};
+    std::size_t _waves{};
+    util::stealing_pool_t *_pool;
   };
 
 } // namespace undo_cxx
@@ -302,7 +938,9 @@ namespace undo_cxx {
   public:
     using base_undo_redo_base_cmd_t<State, BaseCmdT, RefCmdT>::base_undo_redo_base_cmd_t;
     ~base_undo_cmd_t() override = default;
-    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(base_undo_cmd_t, base_undo_redo_base_cmd_t);
+    using Super = base_undo_redo_base_cmd_t<State, BaseCmdT, RefCmdT>;
+    using Self = base_undo_cmd_t<State, BaseCmdT, RefCmdT>;
+    UNDO_CXX_DEFINE_CMD_TYPES();
 
   protected:
     virtual void do_execute(CmdSP &sender, ContextT &ctx) override;
@@ -315,7 +953,9 @@ namespace undo_cxx {
   public:
     using base_undo_redo_base_cmd_t<State, BaseCmdT, RefCmdT>::base_undo_redo_base_cmd_t;
     ~base_redo_cmd_t() override = default;
-    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(base_redo_cmd_t, base_undo_redo_base_cmd_t);
+    using Super = base_undo_redo_base_cmd_t<State, BaseCmdT, RefCmdT>;
+    using Self = base_redo_cmd_t<State, BaseCmdT, RefCmdT>;
+    UNDO_CXX_DEFINE_CMD_TYPES();
 
   protected:
     virtual void do_execute(CmdSP &sender, ContextT &ctx) override;
@@ -333,20 +973,52 @@ namespace undo_cxx {
            typename Cmd>
   class undoable_cmd_system_t {
   public:
-    ~undoable_cmd_system_t() = default;
+    ~undoable_cmd_system_t() {
+      if constexpr (Traits::shared_pool) {
+        if (_shared.member)
+          _shared.pool->detach(*_shared.member);
+      }
+    }
 
     using StateT = State;
     using ContextT = Context;
     using CmdT = Cmd;
-    using CmdSP = std::shared_ptr<CmdT>;
+    using CmdSP = cmd_handle_t<BaseCmdT, CmdT>;
     using Memento = typename CmdT::Memento;
     using MementoPtr = typename std::unique_ptr<Memento>;
+    using Traits = history_traits_t<State>;
+    using Tracer = typename Traits::tracer;
     // using Container = Stack;
-    using Container = std::list<MementoPtr>;
+    using Container = typename Traits::template container<MementoPtr>;
     using Iterator = typename Container::iterator;
 
     using size_type = typename Container::size_type;
 
+    /**
+     * @brief the mementos passed over by undo_to() or redo_to(), in
+     * the history order (the oldest one first).
+     * @details The range is valid until the history is modified by the
+     * next invoke(), erase(), clear() or max_size().
+     */
+    class memento_range_t {
+    public:
+      memento_range_t() = default;
+      memento_range_t(Iterator first, Iterator last, size_type n)
+          : _first(first), _last(last), _size(n) {}
+
+      Iterator begin() const { return _first; }
+      Iterator end() const { return _last; }
+      size_type size() const { return _size; }
+      bool empty() const { return _size == 0; }
+      MementoPtr &front() const { return *_first; }
+      MementoPtr &back() const { return *std::prev(_last); }
+
+    private:
+      Iterator _first{};
+      Iterator _last{};
+      size_type _size{};
+    };
+
     template<typename T, typename = void>
     struct has_save_state : std::false_type {};
     template<typename T>
@@ -362,23 +1034,219 @@ namespace undo_cxx {
     template<typename T>
     struct has_redo<T, decltype(void(std::declval<T &>().redo()))> : std::true_type {};
 
+    template<typename T>
+    using has_can_be_memento = traits::has_can_be_memento<T>;
+
     template<typename T, typename = void>
-    struct has_can_be_memento : std::false_type {};
+    struct has_merge_with : std::false_type {};
     template<typename T>
-    struct has_can_be_memento<T, decltype(void(std::declval<T &>().can_be_memento()))> : std::true_type {};
+    struct has_merge_with<T, decltype(void(std::declval<T &>().merge_with(std::declval<T const &>())))> : std::true_type {};
+
+    template<typename T, typename = void>
+    struct has_footprint : std::false_type {};
+    template<typename T>
+    struct has_footprint<T, decltype(void(std::declval<T const &>().footprint(std::declval<footprint_t &>())))> : std::true_type {};
+
+    template<typename T>
+    struct is_list : std::false_type {};
+    template<typename T, typename A>
+    struct is_list<std::list<T, A>> : std::true_type {};
+
+    using tree_type = history_tree_t<Memento, MementoPtr>;
+    using node_id = typename tree_type::node_id;
+
+    static_assert(!Traits::journal || is_serializable_v<State>, "history_traits_t::journal needs a state_serializer_t<State>, see also is_journal_pod");
+    static_assert(!Traits::tree || is_list<Container>::value, "history_traits_t::tree needs a std::list history container");
 
   public:
-    void invoke(CmdSP &cmd) {
-      cmd->execute(cmd, _ctx);
-      // if constexpr (has_can_be_memento<CmdSP>::value) {
-      if (cmd->can_be_memento())
-        save(cmd);
-      // }
+    undoable_cmd_system_t() = default;
+    /**
+     * @brief an undo manager with a private arena.
+     * @param upstream where the arena gets its memory from
+     * @details The commands created by invoke&lt;ConcreteCmd>(), the
+     * pairs of the mementos, and with pmr_history_traits_t (see also
+     * history_traits_t::memento_arena) the mementos themselves and the
+     * history nodes, are allocated from an unsynchronized pool.
+     * Discarding the redo tail, or clear(), returns their memory to the
+     * pool; the arena is released with the manager.
+     *
+     * The commands and the mementos must not outlive the manager.
+     */
+    explicit undoable_cmd_system_t(std::pmr::memory_resource *upstream)
+        : _arena(std::make_unique<std::pmr::unsynchronized_pool_resource>(upstream))
+        , _resource(_arena.get())
+        , _saved_states(make_container(_resource)) {}
+
+    /**
+     * @brief an undo manager of one document among many, sharing the
+     * memory budget and the allocator of pool.
+     * @details The commands, the pairs of the mementos, and with
+     * pmr_history_traits_t the mementos and the history container, are
+     * allocated from pool.resource(). The footprint of the history is reported
+     * to the pool on each change, which may evict the oldest mementos
+     * of this history or of the less recently active ones, see
+     * history_pool_t.
+     */
+    explicit undoable_cmd_system_t(history_pool_t &pool)
+        : _resource(pool.resource())
+        , _saved_states(make_container(_resource)) {
+      static_assert(Traits::shared_pool, "a shared pool needs history_traits_t::shared_pool");
+      _shared.pool = &pool;
+      _shared.member = std::make_unique<pool_member_t>(*this);
+      _shared.pool->attach(*_shared.member);
+    }
+
+    /** @brief the arena, or nullptr */
+    std::pmr::memory_resource *resource() const { return _resource; }
+    /** @brief the shared pool, or nullptr */
+    history_pool_t *pool() const {
+      if constexpr (Traits::shared_pool)
+        return _shared.pool;
+      else
+        return nullptr;
+    }
+    /**
+     * @brief lock the manager against the evictions by the pool from
+     * the other threads, see history_pool_t. It's an empty lock if
+     * there's no pool.
+     */
+    [[nodiscard]] std::unique_lock<std::mutex> pool_guard() {
+      if constexpr (Traits::shared_pool) {
+        if (_shared.member)
+          return std::unique_lock<std::mutex>{_shared.member->lock()};
+      }
+      return std::unique_lock<std::mutex>{};
+    }
+    /** @brief the footprint and the evictions of this history in the pool */
+    history_pool_t::counters_t pool_counters() const {
+      if constexpr (Traits::shared_pool) {
+        if (_shared.member)
+          return _shared.pool->counters(*_shared.member);
+      }
+      return history_pool_t::counters_t{};
     }
+
+    void invoke(CmdSP &cmd) { invoke_as<CmdT>(cmd); }
+    /**
+     * @brief create a ConcreteCmd and invoke it.
+     * @details If ConcreteCmd has a `bool merge_with(ConcreteCmd const &next)`,
+     * it may be merged into the newest memento rather than saved as a
+     * new one, see merge_window().
+     */
     template<typename ConcreteCmd, typename... Args>
     void invoke(Args &&...args) {
-      CmdSP sp = std::make_shared<ConcreteCmd>(args...);
-      invoke(sp);
+      if constexpr (std::is_same_v<CmdSP, std::shared_ptr<CmdT>>) {
+        CmdSP sp = _resource ? std::allocate_shared<ConcreteCmd>(std::pmr::polymorphic_allocator<ConcreteCmd>{_resource}, args...)
+                             : std::make_shared<ConcreteCmd>(args...);
+        invoke_as<ConcreteCmd>(sp);
+      } else {
+        // an intrusive command frees itself, with the plain delete
+        CmdSP sp = cmd_handle_traits_t<BaseCmdT>::template make<ConcreteCmd>(args...);
+        invoke_as<ConcreteCmd>(sp);
+      }
+    }
+
+    using GroupCmd = group_cmd_t<State, BaseCmdT, RefCmdT>;
+
+    /**
+     * @brief an open group, see begin_group(). It's committed when it's
+     * destroyed, or rolled back if that's by an exception.
+     * @details The destructor swallows the exceptions out of the undo
+     * hooks and the recording, call commit() or rollback() explicitly
+     * to get them. The group is closed either way.
+     */
+    class group_t {
+    public:
+      ~group_t() {
+        try {
+          if (std::uncaught_exceptions() > _exceptions)
+            rollback();
+          else
+            commit();
+        } catch (...) {
+          // a destructor must not throw, and may run while unwinding
+        }
+      }
+      group_t(group_t &&o) noexcept
+          : _mgr(std::exchange(o._mgr, nullptr))
+          , _mark(o._mark)
+          , _exceptions(o._exceptions) {}
+      group_t(group_t const &) = delete;
+      group_t &operator=(group_t const &) = delete;
+      group_t &operator=(group_t &&) = delete;
+
+      /** @brief close the group, and record it if it's the outermost one */
+      void commit() {
+        if (auto *m = std::exchange(_mgr, nullptr))
+          m->end_group(_mark, false);
+      }
+      /** @brief undo the commands of this group, newest first, and close it */
+      void rollback() {
+        if (auto *m = std::exchange(_mgr, nullptr))
+          m->end_group(_mark, true);
+      }
+      bool active() const { return _mgr != nullptr; }
+
+    private:
+      friend class undoable_cmd_system_t;
+      group_t(undoable_cmd_system_t *mgr, std::size_t mark)
+          : _mgr(mgr)
+          , _mark(mark)
+          , _exceptions(std::uncaught_exceptions()) {}
+
+      undoable_cmd_system_t *_mgr;
+      std::size_t _mark;
+      int _exceptions;
+    };
+
+    /**
+     * @brief group the commands invoked from now on into one history
+     * entry, until the returned group_t is destroyed.
+     * @details The commands are executed at once, and their states are
+     * collected into one composite memento, whose command is a GroupCmd
+     * of them. The mementos the commands save are built in a scratch
+     * arena of the group, which is released when the group closes; so
+     * with history_traits_t::memento_arena, a command costs no more
+     * allocations than itself (and the amortized growth of the
+     * composite). An empty group records nothing.
+     *
+     * An exception out of the scope of the group rolls it back: its
+     * commands are undone newest first, by their undo hooks. A group
+     * opened in another one joins it, and its rollback undoes its own
+     * commands only. Don't undo, redo or clear the history while a
+     * group is open, nor let it outlive the manager.
+     * @code{c++}
+     * {
+     *   auto tx = mgr.begin_group("rename symbol");
+     *   for (auto &ref : refs)
+     *     mgr.invoke&lt;RenameCmd>(ref, new_name); // throws? all of them are undone
+     * } // one undo step
+     * @endcode
+     */
+    group_t begin_group(std::string_view name = {}) {
+      static_assert(Traits::groups, "begin_group() needs history_traits_t::groups");
+      static_assert(std::is_default_constructible_v<StateT>, "a group needs a default constructible State");
+      if (!_group)
+        _group = std::make_unique<group_state_t>(_resource ? _resource : std::pmr::get_default_resource());
+      if (!_group->depth) {
+        if constexpr (std::is_same_v<CmdSP, std::shared_ptr<CmdT>>) {
+          _group->cmd = _resource ? std::allocate_shared<GroupCmd>(std::pmr::polymorphic_allocator<GroupCmd>{_resource}, name)
+                                  : std::make_shared<GroupCmd>(name);
+        } else {
+          _group->cmd = cmd_handle_traits_t<BaseCmdT>::template make<GroupCmd>(name);
+        }
+        memento_resource_scope_t scope{_resource};
+        _group->memento = std::make_unique<Memento>(_group->cmd, StateT{});
+      }
+      _group->depth++;
+      return group_t{this, _group->memento->size()};
+    }
+    /** @brief true while a group is open */
+    bool in_group() const {
+      if constexpr (Traits::groups)
+        return _group && _group->depth;
+      else
+        return false;
     }
     void undo(CmdSP &undo_cmd) {
       if constexpr (has_undo<CmdT>::value) {
@@ -389,6 +1257,7 @@ namespace undo_cxx {
 
       if (undo_one()) {
         // undo ok
+        charge_pool();
       }
     }
     void redo(CmdSP &redo_cmd) {
@@ -400,6 +1269,7 @@ namespace undo_cxx {
 
       if (redo_one()) {
         UNUSED(redo_cmd);
+        charge_pool();
       }
     }
 
@@ -410,14 +1280,8 @@ namespace undo_cxx {
         return;
       }
 
-      int pos = (int) position();
-      int pos_new = pos - delta;
-      if (pos_new > 0 && (size_type) pos_new <= size()) {
-        Iterator it = _position;
-        std::advance(it, -delta);
-        for (int i = 0; i < delta; i++) {
-          undo(undo_cmd);
-        }
+      if (delta > 0 && (size_type) delta <= _cursor) {
+        undo_to(_cursor - (size_type) delta);
       }
     }
     void redo(CmdSP redo_cmd, int delta) {
@@ -427,26 +1291,89 @@ namespace undo_cxx {
         return;
       }
 
-      int pos = (int) position();
-      int pos_new = pos + delta;
-      if (pos_new > 0 && (size_type) pos_new <= size()) {
-        Iterator it = _position;
-        std::advance(it, delta);
-        for (int i = 0; i < delta; i++) {
-          redo(redo_cmd);
-        }
+      if (delta > 0 && (size_type) delta <= size() - _cursor) {
+        redo_to(_cursor + (size_type) delta);
       }
     }
 
+    /**
+     * @brief undo the history back to position pos in one step.
+     * @param pos the target position, in [0, position()]
+     * @return the mementos undone, [pos, position()) before the call;
+     * or an empty range if pos is out of range.
+     * @details The cursor is validated and moved once, and only one
+     * restore event is traced, no matter how far it jumps. The
+     * application reverts its document by walking the returned
+     * range backward, or simply loads focused_item() if pos is
+     * less than size().
+     * @code{c++}
+     * auto r = mgr.undo_to(checkpoint);
+     * for (auto it = r.end(); it != r.begin();) {
+     *   auto &memento = *--it;
+     *   // revert the effects of memento
+     * }
+     * @endcode
+     */
+    memento_range_t undo_to(size_type pos) {
+      if (pos >= _cursor) {
+        return {_position, _position, 0};
+      }
+      auto n = _cursor - pos;
+      Iterator last = _position;
+      _position = std::prev(last, (std::ptrdiff_t) n);
+      _cursor = pos;
+      settle(_position, last);
+      seal();
+      journal_cursor();
+      trace(trace::event_t::restore, *_position);
+      charge_pool();
+      return {_position, last, n};
+    }
+    /**
+     * @brief redo the history forward to position pos in one step.
+     * @param pos the target position, in [position(), size()]
+     * @return the mementos redone, [position(), pos) before the call;
+     * or an empty range if pos is out of range.
+     * @details Like undo_to(), the cursor is validated and moved once,
+     * and only one replay event is traced.
+     */
+    memento_range_t redo_to(size_type pos) {
+      if (pos <= _cursor || pos > size()) {
+        return {_position, _position, 0};
+      }
+      auto n = pos - _cursor;
+      Iterator first = _position;
+      _position = std::next(first, (std::ptrdiff_t) n);
+      _cursor = pos;
+      settle(first, _position);
+      if (_position != _saved_states.end())
+        settle(*_position);
+      seal();
+      journal_cursor();
+      trace(trace::event_t::replay, *std::prev(_position));
+      charge_pool();
+      return {first, _position, n};
+    }
+
     void erase(int n = 1) {
+      std::uint64_t erased = 0;
       while (n-- && !empty()) {
-        Iterator it = _position;
-        if (it != _saved_states.end()) {
-          _position--;
-          _saved_states.erase(it);
-          _position++;
+        if (_position != _saved_states.end()) {
+          make_keyframe(_cursor + 1);
+          if constexpr (Traits::spill) {
+            if (_cursor + _spill.unspilled >= size())
+              --_spill.unspilled;
+          }
+          release(*_position);
+          _position = _saved_states.erase(_position);
+          erased++;
         }
       }
+      if (erased) {
+        seal();
+        journal_record(journal_event_t::erase, erased);
+        charge_pool();
+      }
     }
 
     // @desc to return the focused item at undo/redo stack.
@@ -454,9 +1381,20 @@ namespace undo_cxx {
     //   these apis: undo/redo.
     // @note _position will be reset to end() once invoke()
     //   invoked.
-    MementoPtr &focused_item() { return *_position; }
+    MementoPtr &focused_item() { return settle(*_position); }
     MementoPtr const &focused_item() const { return *_position; }
-    std::ptrdiff_t position() { return std::distance(_saved_states.begin(), _position); }
+    // @desc the state of the memento before the insertion point, which
+    //   a command can take as the base of its new memento, such as
+    //   cow_state_t::snapshot() and delta_state_t. nullptr if none.
+    StateT const *previous_state() const {
+      return _cursor > 0 ? &(**std::prev(_position))() : nullptr;
+    }
+    StateT const *previous_state() {
+      return _cursor > 0 ? &(*settle(*std::prev(_position)))() : nullptr;
+    }
+    // @desc the index of _position, it's maintained alongside _position
+    //   so that it's O(1) on any container.
+    std::ptrdiff_t position() const { return (std::ptrdiff_t) _cursor; }
     Iterator newest_iterator() { return _saved_states.end(); }
     Iterator oldest_iterator() { return _saved_states.begin(); }
     // @desc to return the newest item at stack.
@@ -467,34 +1405,749 @@ namespace undo_cxx {
     MementoPtr &newest_item() {
       auto it = _position;
       it--;
-      return *it;
+      return settle(*it);
     }
 
     auto size() const { return _saved_states.size(); }
     bool empty() const { return _saved_states.empty(); }
-    bool can_restore() const { return !empty() && _position != _saved_states.begin(); }
-    bool can_replay() const { return !empty() && _position != _saved_states.end(); }
+    bool can_restore() const { return _cursor > 0; }
+    bool can_replay() const { return _cursor < size(); }
     bool can_undo() const { return can_restore(); }
     bool can_redo() const { return can_replay(); }
 
+    /** @brief the statistics of the history */
+    struct counters_t {
+      size_type entries;
+      std::size_t bytes;
+      std::size_t max_bytes;
+      std::size_t evicted;
+    };
+    counters_t counters() const { return {size(), _bytes, _max_bytes, _evicted}; }
+    /** @brief the total footprint of the mementos in the history */
+    std::size_t memory_usage() const { return _bytes; }
+
+    std::size_t max_bytes() const { return _max_bytes; }
+    /**
+     * @brief bound the history by the footprint of the mementos.
+     * @details Each memento reports its footprint by state_t::memory_usage(),
+     * that is, by `State::memory_usage()` or history_traits_t::memory_usage().
+     * Once the total crosses the budget, the oldest mementos are evicted,
+     * but the newest one is always kept.
+     */
+    void max_bytes(std::size_t max_value) {
+      _max_bytes = max_value;
+      journal_record(journal_event_t::limits);
+      shrink_to_budget();
+      charge_pool();
+    }
+
     size_type max_size() const { return _max_size; }
     void max_size(size_type max_value) {
       _max_size = max_value;
       if constexpr (undo_cxx::traits::has_max_size_set_v<Container>) {
         // if `void stack::max_size(size_t max_size_)` exists:
+        // the container drops the oldest ones by itself, and the
+        // iterators are invalidated. The evictions are journaled
+        // ahead of the limits, so that replay() repeats them first.
+        auto dropped = size() > _max_size ? size() - _max_size : 0;
+        if (dropped) {
+          make_keyframe(dropped);
+          journal_record(journal_event_t::evict, dropped);
+        }
+        journal_record(journal_event_t::limits);
+        auto it = _saved_states.begin();
+        for (size_type i = 0; i < dropped; ++i, ++it)
+          release(*it);
+        _evicted += dropped;
         _saved_states.max_size(_max_size);
+        _cursor = _cursor > dropped ? _cursor - dropped : 0;
+        _position = std::next(_saved_states.begin(), (std::ptrdiff_t) _cursor);
+        charge_pool();
+      } else {
+        journal_record(journal_event_t::limits);
       }
     }
 
     void clear() {
+      if constexpr (Traits::tree) {
+        if (_tree.nodes)
+          _tree.nodes->clear([this](MementoPtr &m) { release(m); });
+      }
+      if constexpr (Traits::selective) {
+        if (_footprints)
+          _footprints->clear();
+      }
+      if constexpr (Tracer::enabled) {
+        _tracer.release_all();
+      }
+      if constexpr (Traits::async_save) {
+        _async.pending.clear();
+        _async.slots.clear();
+      }
+      if constexpr (Traits::spill) {
+        for (auto &kv : _spill.spilled)
+          _spill.store->release(kv.second.ticket);
+        _spill.spilled.clear();
+        _spill.paged_in.clear();
+        _spill.unspilled = 0;
+      }
+      journal_record(journal_event_t::clear);
       _saved_states.clear();
       _position = _saved_states.end();
+      _cursor = 0;
+      _bytes = 0;
+      seal();
+      charge_pool();
+    }
+
+    /**
+     * @brief true if the next memento should be a full keyframe.
+     * @details It's for the delta mementos (delta_state_t): a command
+     * checks it in save_state_impl() with `ctx.mgr.keyframe_due()`.
+     * It's always true for the full-state mementos.
+     */
+    bool keyframe_due() {
+      if constexpr (is_delta_state_v<State>) {
+        wait_pending();
+      }
+      return std::as_const(*this).keyframe_due();
+    }
+    bool keyframe_due() const {
+      if constexpr (is_delta_state_v<State>) {
+        auto it = _position;
+        for (size_type n = 1; n < _keyframe_interval && n <= _cursor; ++n) {
+          --it;
+          if ((**it)().is_keyframe())
+            return false;
+        }
+      }
+      return true;
+    }
+    size_type keyframe_interval() const { return _keyframe_interval; }
+    void keyframe_interval(size_type n) { _keyframe_interval = n; }
+
+    /**
+     * @brief rebuild the document at position pos from the delta
+     * mementos (delta_state_t).
+     * @param pos in [0, size()], position() for the current document
+     * @return the document, or nothing if pos is out of range.
+     * @details It starts from the nearest keyframe at or before pos,
+     * and applies at most keyframe_interval() forward patches.
+     */
+    template<typename S = State>
+    std::optional<typename S::document_type> materialize(size_type pos) {
+      static_assert(is_delta_state_v<S>, "materialize() needs the delta mementos (delta_state_t)");
+      std::optional<typename S::document_type> doc;
+      if (empty() || pos > size()) {
+        return doc;
+      }
+      wait_pending();
+
+      size_type target = pos ? pos - 1 : 0, i = target;
+      auto it = iterator_at(target);
+      while (!(**it)().is_keyframe()) {
+        if (i == 0) {
+          return doc; // no keyframe: the history wasn't recorded properly
+        }
+        --it;
+        --i;
+      }
+      doc.emplace(*(**it)().keyframe);
+      while (i < target) {
+        ++it;
+        ++i;
+        (**it)().apply_forward(*doc);
+      }
+      if (pos == 0) {
+        (**it)().apply_backward(*doc);
+      }
+      return doc;
+    }
+
+    /**
+     * @brief save the mementos asynchronously on a worker pool, or
+     * synchronously if pool is nullptr (by default).
+     * @details For a command which overrides cmd_t::capture_state_impl(),
+     * invoke() reserves the history slot with a placeholder memento,
+     * and the memento is built on the pool. The slot is settled (the
+     * built memento is moved in) on this thread, waiting for the worker
+     * only if it isn't finished yet, when it's reached by undo()/redo(),
+     * focused_item(), newest_item() or previous_state(), or read by
+     * keyframe_due() and materialize() for the delta mementos. The other
+     * commands are saved synchronously. memory_usage() counts a pending
+     * slot as its placeholder.
+     *
+     * The pool must outlive the manager, or the next async_save() call.
+     * It needs history_traits_t::async_save.
+     */
+    void async_save(util::worker_pool_t *pool) {
+      static_assert(Traits::async_save, "async_save() needs history_traits_t::async_save");
+      if (!pool)
+        wait_pending();
+      _async.pool = pool;
+    }
+    util::worker_pool_t *async_save() const {
+      if constexpr (Traits::async_save)
+        return _async.pool;
+      else
+        return nullptr;
+    }
+    /** @brief the number of the slots whose mementos aren't settled */
+    std::size_t pending() const {
+      if constexpr (Traits::async_save)
+        return _async.pending.size();
+      else
+        return 0;
+    }
+    /** @brief settle all the pending slots, waiting for the workers */
+    void wait_pending() {
+      if constexpr (Traits::async_save) {
+        while (!_async.pending.empty())
+          settle(_async.pending.front());
+      }
     }
 
+    /**
+     * @brief write the history into a journal from now on, or stop it
+     * by nullptr. See also journal_t.
+     * @details The history changes are appended to the journal: the
+     * saved mementos, the cursor movements, erase(), clear(), the
+     * evictions and the limits. The mementos are saved synchronously while a journal is
+     * attached. The journal must outlive the manager, or the next
+     * journal() call. It needs history_traits_t::journal.
+     */
+    void journal(journal_t<State> *j) {
+      static_assert(Traits::journal, "journal() needs history_traits_t::journal");
+      _journal.sink = j;
+    }
+    journal_t<State> *journal() const {
+      if constexpr (Traits::journal)
+        return _journal.sink;
+      else
+        return nullptr;
+    }
+    /**
+     * @brief rebuild the history from a journal, the mementos carry
+     * the states only, no commands.
+     * @details The evictions are replayed as they're journaled, the
+     * limits and the footprints of the mementos don't evict anything
+     * during replay(); so the history is the same even if the states
+     * report another memory_usage() now.
+     * @return the number of the records replayed
+     */
+    std::size_t replay(journal_t<State> &j) {
+      static_assert(Traits::journal, "replay() needs history_traits_t::journal");
+      auto *saved = std::exchange(_journal.sink, nullptr);
+      _journal.replaying = true;
+      memento_resource_scope_t scope{_resource};
+      auto n = j.template read<Memento>([this](journal_event_t e, std::uint64_t a, std::uint64_t b, MementoPtr m) {
+        switch (e) {
+          case journal_event_t::save: push(std::move(m)); break;
+          case journal_event_t::cursor:
+            if (a < _cursor)
+              undo_to((size_type) a);
+            else
+              redo_to((size_type) a);
+            break;
+          case journal_event_t::erase: erase((int) a); break;
+          case journal_event_t::clear: clear(); break;
+          case journal_event_t::limits:
+            max_size((size_type) a);
+            max_bytes((std::size_t) b);
+            break;
+          case journal_event_t::evict: evict_oldest((size_type) a); break;
+        }
+      });
+      _journal.replaying = false;
+      _journal.sink = saved;
+      charge_pool();
+      return n;
+    }
+
+    /**
+     * @brief keep the cold mementos in a cold store from now on, or
+     * stop it by nullptr (the spilled ones are read back).
+     * @details The mementos more than opts.hot_window entries behind
+     * the newest one are serialized into the store (a spill_file_t,
+     * a compressed_store_t, or your own cold_store_t), and their states
+     * are replaced by the empty ones, so that a long session keeps
+     * only the hot tail resident. The window is measured from the newest
+     * entry, not from the cursor, when invoke() saves one. It's spilled
+     * in batches: once 2 * hot_window mementos are live, all but the
+     * newest hot_window are spilled. A spilled memento is paged back in
+     * transparently when it's reached, like a pending slot of
+     * async_save(): by undo()/redo(), the ranges of undo_to()/redo_to(),
+     * focused_item(), newest_item() or previous_state(). The paged-in
+     * ones are spilled again by the next invoke() once there are more
+     * than opts.hot_window of them (the store keeps their bytes, so it's
+     * free), thus they must be treated as read-only.
+     *
+     * memory_usage() and max_bytes() still count the full footprint of
+     * the spilled mementos. State must be trivially copyable or have a
+     * state_serializer_t (see cold_serializer_t), and the delta mementos
+     * (delta_state_t) aren't supported. The store must outlive the
+     * manager, or the next spill() call. It needs history_traits_t::spill.
+     * @code{c++}
+     * undo_cxx::spill_file_t cold;
+     * mgr.spill(&cold, undo_cxx::spill_options_t{512, 4096});
+     * @endcode
+     */
+    void spill(cold_store_t *store, spill_options_t opts = {}) {
+      static_assert(Traits::spill, "spill() needs history_traits_t::spill");
+      static_assert(!is_delta_state_v<State>, "the delta mementos can't be spilled");
+      if (store != _spill.store) {
+        for (auto &kv : _spill.spilled) {
+          if (!kv.second.resident)
+            read_cold(kv.first, kv.second.ticket);
+          _spill.store->release(kv.second.ticket);
+        }
+        _spill.spilled.clear();
+        _spill.paged_in.clear();
+        _spill.unspilled = size();
+      }
+      _spill.store = store;
+      _spill.opts = opts;
+    }
+    cold_store_t *spill() const {
+      if constexpr (Traits::spill)
+        return _spill.store;
+      else
+        return nullptr;
+    }
+    /** @brief the number of the mementos whose states are in the cold store only */
+    std::size_t spilled() const {
+      if constexpr (Traits::spill)
+        return std::count_if(_spill.spilled.begin(), _spill.spilled.end(), [](auto const &kv) { return !kv.second.resident; });
+      else
+        return 0;
+    }
+    /**
+     * @brief where the states of a memento are in the cold store, or
+     * nothing if it has never been spilled.
+     * @details e.g. `store.sizes(*mgr.cold_ticket(m))` of a compressed_store_t.
+     */
+    std::optional<cold_store_t::ticket_t> cold_ticket(MementoPtr const &m) const {
+      std::optional<cold_store_t::ticket_t> t;
+      if constexpr (Traits::spill) {
+        if (auto it = _spill.spilled.find(m.get()); it != _spill.spilled.end())
+          t = it->second.ticket;
+      } else {
+        UNUSED(m);
+      }
+      return t;
+    }
+
+    /**
+     * @brief merge the consecutive commands into one memento, if they're
+     * invoked within this interval (history_traits_t::merge_window by
+     * default); 0 to turn it off.
+     * @details A command opts in by a non-virtual hook, which is found
+     * by its static type in invoke&lt;ConcreteCmd>() (or by CmdT in
+     * invoke(CmdSP &)):
+     * @code{c++}
+     * // absorb next into this, return false to refuse it
+     * bool merge_with(TypeCmd const &next);
+     * @endcode
+     * When the cursor is at the newest memento, the newest command is
+     * of the same type (see merge_same_id()) and it agrees, the newest
+     * memento is rebuilt in place by its save_state() instead of saving
+     * a new one. So typing "hello" makes one memento, and one undo step.
+     * Any undo/redo, erase(), clear() or seal() ends the merging. The
+     * delta mementos (delta_state_t) can't be merged. It needs
+     * history_traits_t::merge, or the commands are never merged.
+     */
+    std::chrono::milliseconds merge_window() const {
+      if constexpr (Traits::merge)
+        return _merge.window;
+      else
+        return {};
+    }
+    void merge_window(std::chrono::milliseconds window) {
+      static_assert(Traits::merge, "merge_window() needs history_traits_t::merge");
+      _merge.window = window;
+    }
+    /**
+     * @brief true to merge the commands of exactly the same type (by
+     * default, see history_traits_t::merge_same_id), false to merge
+     * the subclasses of it as well.
+     */
+    bool merge_same_id() const {
+      if constexpr (Traits::merge)
+        return _merge.same_id;
+      else
+        return Traits::merge_same_id;
+    }
+    void merge_same_id(bool b) {
+      static_assert(Traits::merge, "merge_same_id() needs history_traits_t::merge");
+      _merge.same_id = b;
+    }
+    /** @brief don't merge the next command into the newest memento */
+    void seal() {
+      if constexpr (Traits::merge)
+        _merge.last_save = {};
+    }
+
+    /**
+     * @brief keep the redo tail as a branch when a command is invoked
+     * after an undo, rather than discarding it: the history becomes an
+     * undo tree.
+     * @details The history container still keeps the active path, from
+     * the oldest memento down to a leaf, so that undo()/redo() and the
+     * rest of the API work on it as before, in O(1) per step. All the
+     * nodes are kept in a history_tree_t (see tree()), the branches
+     * share their prefix up to the fork. switch_branch() and goto_node()
+     * swap another branch into the redo tail, moving the mementos of
+     * the two tails only.
+     *
+     * The history container must be a std::list (or std::pmr::list),
+     * and history_traits_t::tree be true. max_size() bounds the active
+     * path, max_nodes() bounds the whole tree. Turning it off drops the
+     * branches.
+     * @code{c++}
+     * mgr.tree_mode(true);
+     * mgr.invoke&lt;InsertCmd>("a");  // node 1
+     * mgr.invoke&lt;InsertCmd>("b");  // node 2
+     * mgr.undo(undo_cmd);
+     * mgr.invoke&lt;InsertCmd>("c");  // node 3, a sibling of node 2
+     * mgr.goto_node(2);              // "ab" again
+     * @endcode
+     */
+    void tree_mode(bool on) {
+      static_assert(Traits::tree, "tree_mode() needs history_traits_t::tree");
+      if (on && !_tree.nodes) {
+        _tree.nodes = std::make_unique<tree_type>();
+        auto parent = tree_type::root;
+        for (auto &m : _saved_states)
+          parent = _tree.nodes->add(parent, m.get());
+      } else if (!on && _tree.nodes) {
+        _tree.nodes->clear([this](MementoPtr &m) { release(m); });
+        _tree.nodes.reset();
+      }
+    }
+    bool tree_mode() const { return tree() != nullptr; }
+    /** @brief the undo tree, nullptr if tree_mode() is off */
+    tree_type const *tree() const {
+      if constexpr (Traits::tree)
+        return _tree.nodes.get();
+      else
+        return nullptr;
+    }
+    /**
+     * @brief the node of the newest memento undone to, i.e. the one
+     * before position(); the root if it's 0 or tree_mode() is off.
+     */
+    node_id current_node() const {
+      auto *t = tree();
+      return t && _cursor ? t->find(std::prev(_position)->get()) : tree_type::root;
+    }
+    /** @brief the number of the branches redo() can take, see switch_branch() */
+    size_type branch_count() const {
+      auto *t = tree();
+      return t ? t->child_count(current_node()) : (can_redo() ? 1 : 0);
+    }
+    /**
+     * @brief make the i-th child of current_node() (the oldest one
+     * first) the redo tail, following the last visited children down.
+     * @return false if there's no such branch.
+     * @details The cursor isn't moved, a redo() applies the first
+     * memento of the branch. It's journaled as saving the mementos of
+     * the new tail and stepping back to position().
+     */
+    bool switch_branch(size_type i) {
+      if constexpr (Traits::tree) {
+        if (!_tree.nodes)
+          return false;
+        auto c = _tree.nodes->child(current_node(), i);
+        if (c == tree_type::npos)
+          return false;
+        if (!_tree.nodes->on_path(c))
+          graft(c);
+        return true;
+      } else {
+        UNUSED(i);
+        return false;
+      }
+    }
+    /**
+     * @brief move to the node n of tree(): the history is undone to the
+     * lowest common ancestor of n and current_node(), the branch of n is
+     * switched in, and redone down to n.
+     * @return false if there's no such node.
+     * @details The walk is O(depth). The undone mementos are detached
+     * before the redone ones are reached, so the application reloads
+     * its document from newest_item() (or restores the initial one at
+     * the root), rather than walking the ranges.
+     */
+    bool goto_node(node_id n) {
+      if constexpr (Traits::tree) {
+        auto &t = _tree.nodes;
+        if (!t || !t->contains(n))
+          return false;
+        std::vector<node_id> up; // from n up to the active path
+        auto a = n;
+        for (; !t->on_path(a); a = t->parent(a))
+          up.push_back(a);
+        size_type at = t->depth(a);
+        if (!up.empty()) {
+          move_to(at);
+          for (auto i = up.size() - 1; i > 0; --i)
+            t->select(up[i - 1]);
+          graft(up.back());
+        }
+        move_to(at + up.size());
+        return true;
+      } else {
+        UNUSED(n);
+        return false;
+      }
+    }
+    /**
+     * @brief selective undo: revert the command of the entry it out of
+     * order, by its cmd_t::undo(), and remove the entry from the history.
+     * @return false if it can't be, see can_undo_entry().
+     * @details The entries after it stay as they are, the cursor moves
+     * back by one. In the tree mode, the branches forking off it are
+     * dropped. It's journaled as erasing the entry.
+     * @code{c++}
+     * mgr.invoke&lt;SetCellCmd>("A1", 42);
+     * auto h = std::prev(mgr.newest_iterator());
+     * ... // 200 more edits
+     * if (!mgr.undo_entry(h))
+     *   ; // a later edit read or overwrote A1
+     * @endcode
+     */
+    bool undo_entry(Iterator it) {
+      static_assert(!is_delta_state_v<State>, "the delta mementos can't be undone selectively");
+      if (!can_undo_entry(it))
+        return false;
+      auto &m = settle(*it);
+      CmdSP cmd = m->command();
+      if (!cmd)
+        return false; // replayed from a journal
+      cmd->undo(cmd, _ctx, *m);
+      trace(trace::event_t::revert, m);
+      remove_entry(it);
+      charge_pool();
+      return true;
+    }
+    /**
+     * @brief true if the entry it is before position() and no later
+     * entry (the redo tail included) depends on it.
+     * @details The dependencies are found by the footprints the commands
+     * declare by a non-virtual hook, which is found by the static type
+     * of the command in invoke&lt;ConcreteCmd>() (or by CmdT in
+     * invoke(CmdSP &)), see footprint_t:
+     * @code{c++}
+     * void footprint(undo_cxx::footprint_t &fp) const;
+     * @endcode
+     * A later entry depends on it if it reads or writes a key it writes.
+     * The commands without the hook are opaque, they depend on all the
+     * earlier ones. The check is O(k log n) by a footprint_index_t,
+     * which is built since the first command with a footprint if
+     * history_traits_t::selective is true. Without it, only the newest
+     * entry can be undone, when there's no redo tail.
+     */
+    bool can_undo_entry(Iterator it) const {
+      if (it == _saved_states.end() || _cursor == 0)
+        return false;
+      auto newest = std::prev(_position);
+      if constexpr (Traits::selective) {
+        if (_footprints && _footprints->contains(it->get())) {
+          if (_footprints->seq(it->get()) > _footprints->seq(newest->get()))
+            return false; // in the redo tail
+          return !_footprints->depends(it->get());
+        }
+      }
+      return it == newest && _position == _saved_states.end();
+    }
+
+    size_type max_nodes() const {
+      if constexpr (Traits::tree)
+        return _tree.max_nodes;
+      else
+        return SIZE_T_MAX;
+    }
+    /**
+     * @brief bound the undo tree: the least recently visited leaves off
+     * the active path are pruned while there are more nodes than it.
+     * @details They're also the first ones evicted by max_bytes().
+     */
+    void max_nodes(size_type n) {
+      static_assert(Traits::tree, "max_nodes() needs history_traits_t::tree");
+      _tree.max_nodes = n;
+      prune_tree();
+    }
+
+    /** @brief the history tracer, see also history_traits_t */
+    Tracer const &tracer() const { return _tracer; }
+    Tracer &tracer() { return _tracer; }
+
   private:
+    template<typename T>
+    void invoke_as(CmdSP &cmd) {
+      cmd->execute(cmd, _ctx);
+      if (!cmd->can_be_memento())
+        return;
+      if constexpr (Traits::groups) {
+        if (in_group()) {
+          group_add(cmd);
+          return;
+        }
+      }
+      if constexpr (Traits::merge && has_merge_with<T>::value) {
+        auto now = std::chrono::steady_clock::now();
+        if (!merge<T>(cmd, now)) {
+          save(cmd);
+          note_footprint(static_cast<T const &>(*cmd));
+        }
+        _merge.last_save = now;
+      } else {
+        save(cmd);
+        note_footprint(static_cast<T const &>(*cmd));
+        seal();
+      }
+      charge_pool();
+    }
+    // the state of cmd joins the open group
+    void group_add(CmdSP &cmd) {
+      auto &g = *_group;
+      MementoPtr m;
+      {
+        memento_resource_scope_t scope{&g.scratch};
+        m = cmd->save_state(cmd, _ctx);
+      }
+      g.memento->splice(cmd, std::move(*m));
+    }
+    // a group_t is closed: roll back its commands since mark, and
+    // record the group if it's the outermost one.
+    // The group is closed even if an undo hook throws, then the error
+    // is rethrown.
+    void end_group(std::size_t mark, bool rollback) {
+      auto &g = *_group;
+      std::exception_ptr error;
+      if (rollback) {
+        memento_resource_scope_t scope{&g.scratch};
+        try {
+          for (auto i = g.memento->size(); i-- > mark;) {
+            auto &item = g.memento->at(i);
+            Memento child{item.first, std::move(item.second)};
+            item.first->undo(item.first, _ctx, child);
+          }
+        } catch (...) {
+          error = std::current_exception();
+        }
+        g.memento->truncate(mark);
+      }
+      if (--g.depth) {
+        if (error)
+          std::rethrow_exception(error);
+        return;
+      }
+      auto cmd = std::move(g.cmd);
+      auto memento = std::move(g.memento);
+      g.scratch.release();
+      if (error)
+        std::rethrow_exception(error);
+      if (memento->size() < 2)
+        return;
+      auto &c = static_cast<GroupCmd &>(*cmd);
+      c.reserve(memento->size() - 1);
+      memento->for_each_children([&c](typename Memento::Pair &item) { c.add_command(CmdSP{item.first}); });
+      push(std::move(memento));
+      seal();
+      charge_pool();
+    }
+
+    // the selective undo: index the footprint of the newest memento,
+    // c is its command. The index is built since the first footprint.
+    template<typename T>
+    void note_footprint(T const &c) {
+      if constexpr (Traits::selective && has_footprint<T>::value) {
+        if (!_footprints)
+          _footprints = std::make_unique<footprint_index_t>();
+        footprint_t fp;
+        c.footprint(fp);
+        _footprints->insert(_saved_states.back().get(), &fp);
+      } else {
+        UNUSED(c); // push() has indexed it as opaque
+      }
+    }
+    // remove an entry before the cursor, out of order
+    void remove_entry(Iterator it) {
+      if constexpr (Traits::journal) {
+        if (_journal.sink)
+          _journal.sink->cursor((std::uint64_t) std::distance(_saved_states.begin(), it));
+      }
+      release(*it);
+      _saved_states.erase(it);
+      --_cursor;
+      if constexpr (!is_list<Container>::value)
+        _position = std::next(_saved_states.begin(), (std::ptrdiff_t) _cursor);
+      seal();
+      if constexpr (Traits::journal) {
+        if (_journal.sink) {
+          _journal.sink->erase(1);
+          _journal.sink->cursor(_cursor);
+        }
+      }
+    }
+    // fold cmd into the newest memento, if its command agrees
+    template<typename T>
+    bool merge(CmdSP &cmd, std::chrono::steady_clock::time_point now) {
+      // the rebuilt memento would be taken against the one it replaces,
+      // by keyframe_due() and previous_state()
+      static_assert(!is_delta_state_v<State>, "the delta mementos can't be merged");
+      if (_merge.window.count() <= 0 || _merge.last_save == decltype(_merge.last_save){} || now - _merge.last_save > _merge.window)
+        return false;
+      if (empty() || _position != _saved_states.end())
+        return false;
+      auto &newest = settle(_saved_states.back());
+      CmdSP prev = newest->command();
+      if (!prev)
+        return false; // replayed from a journal
+      T *target;
+      if (_merge.same_id) {
+        auto &a = *prev;
+        auto &b = *cmd;
+        target = typeid(a) == typeid(b) ? static_cast<T *>(prev.get()) : nullptr;
+      } else {
+        target = dynamic_cast<T *>(prev.get());
+      }
+      if (!target || !target->merge_with(static_cast<T const &>(*cmd)))
+        return false;
+
+      memento_resource_scope_t scope{_resource};
+      auto m = prev->save_state(prev, _ctx);
+      drop_spilled(newest.get());
+      auto bytes = newest->charged_bytes();
+      *newest = std::move(*m);
+      recharge(*newest, bytes);
+      note_footprint(*target);
+      trace(trace::event_t::merge, newest);
+      journal_merge();
+      shrink_to_budget();
+      return true;
+    }
+
     void save(CmdSP &cmd) {
       // std::printf("  . save memento\n");
       // // if constexpr (has_save_state<CmdSP>::value) {
+      memento_resource_scope_t scope{_resource};
+      if constexpr (Traits::async_save && std::is_default_constructible_v<StateT>) {
+        if (_async.pool && !journal()) {
+          settle_ready();
+          if (auto fn = cmd->capture_state(cmd, _ctx); fn) {
+            // the placeholder is allocated here, from the arena
+            auto slot = std::make_unique<Memento>(cmd, StateT{});
+            auto task = std::make_shared<std::packaged_task<MementoPtr()>>(std::move(fn));
+            _async.pending.push_back(pending_t{slot.get(), task->get_future()});
+            _async.slots.insert(slot.get());
+            _async.pool->submit([task] { (*task)(); });
+            push(std::move(slot));
+            return;
+          }
+        }
+      }
       auto m = cmd->save_state(cmd, _ctx);
       push(std::move(m));
       // // }
@@ -508,20 +2161,438 @@ namespace undo_cxx {
     bool redo_one() { return replay_one_impl(); }
 
   private:
+    static Container make_container(std::pmr::memory_resource *r) {
+      if constexpr (std::is_constructible_v<Container, std::pmr::polymorphic_allocator<MementoPtr>>) {
+        return Container{std::pmr::polymorphic_allocator<MementoPtr>{r}};
+      } else {
+        UNUSED(r);
+        return Container{};
+      }
+    }
+
+    // the iterator of the i-th memento, walks from the nearest one of
+    // begin(), _position and end().
+    Iterator iterator_at(size_type i) {
+      size_type from_cursor = i > _cursor ? i - _cursor : _cursor - i;
+      if (i <= from_cursor && i <= size() - i)
+        return std::next(_saved_states.begin(), (std::ptrdiff_t) i);
+      if (from_cursor <= size() - i)
+        return std::next(_position, (std::ptrdiff_t) i - (std::ptrdiff_t) _cursor);
+      return std::prev(_saved_states.end(), (std::ptrdiff_t) (size() - i));
+    }
+
+    // for the delta mementos, make the i-th memento a keyframe before
+    // the ones it depends on are removed.
+    void make_keyframe(size_type i) {
+      if constexpr (is_delta_state_v<State>) {
+        if (i < size()) {
+          auto &m = *iterator_at(i);
+          if (!(*m)().is_keyframe()) {
+            (*m)().keyframe = materialize(i + 1);
+            recharge(*m, m->charged_bytes());
+          }
+        }
+      } else {
+        UNUSED(i);
+      }
+    }
+
+    void trace(trace::event_t e, MementoPtr const &m) {
+      if constexpr (Tracer::enabled) {
+        _tracer.record(e, position(), size(), *m);
+      } else {
+        UNUSED(e, m);
+      }
+    }
+    void journal_cursor() { journal_record(journal_event_t::cursor); }
+    // a merge is journaled as a step back and a save, which is replayed
+    // as replacing the newest memento.
+    void journal_merge() {
+      if constexpr (Traits::journal) {
+        if (_journal.sink) {
+          _journal.sink->cursor(_cursor - 1);
+          _journal.sink->save(*_saved_states.back());
+        }
+      }
+    }
+    // a branch switch is journaled as saving the mementos of the new
+    // redo tail, and stepping back.
+    void journal_graft() {
+      if constexpr (Traits::journal) {
+        if (!_journal.sink)
+          return;
+        settle(_position, _saved_states.end());
+        for (auto it = _position; it != _saved_states.end(); ++it)
+          _journal.sink->save(**it);
+        _journal.sink->cursor(_cursor);
+      }
+    }
+    void journal_record(journal_event_t e, std::uint64_t n = 0) {
+      if constexpr (Traits::journal) {
+        auto *j = _journal.sink;
+        if (!j)
+          return;
+        switch (e) {
+          case journal_event_t::save: j->save(*_saved_states.back()); break;
+          case journal_event_t::cursor: j->cursor(_cursor); break;
+          case journal_event_t::erase: j->erase(n); break;
+          case journal_event_t::clear: j->clear(); break;
+          case journal_event_t::limits: j->limits(_max_size, _max_bytes); break;
+          case journal_event_t::evict: j->evict(n); break;
+        }
+      } else {
+        UNUSED(e, n);
+      }
+    }
+    // true while replay() rebuilds the history, the limits don't evict
+    bool replaying() const {
+      if constexpr (Traits::journal)
+        return _journal.replaying;
+      else
+        return false;
+    }
+    // charge the footprint of m, which was charged the bytes before.
+    // A memento is released by the bytes it's charged, so that the
+    // changes of it out of the history can't skew the total.
+    void recharge(Memento &m, std::size_t before) {
+      m.charged_bytes(m.memory_usage());
+      _bytes = _bytes - before + m.charged_bytes();
+    }
+    // a memento is going to be removed from the history
+    void release(MementoPtr const &m) {
+      if constexpr (Traits::selective) {
+        if (_footprints)
+          _footprints->erase(m.get());
+      }
+      if constexpr (Traits::tree) {
+        if (auto &t = _tree.nodes) {
+          if (auto n = t->find(m.get()); n != tree_type::npos && t->on_path(n))
+            t->remove(n, [this](MementoPtr &b) { release(b); });
+        }
+      }
+      drop_pending(m.get());
+      drop_spilled(m.get());
+      _bytes -= m->charged_bytes();
+      if constexpr (Tracer::enabled) {
+        _tracer.release(m.get());
+      }
+    }
+
+    // the asynchronous save: move the memento built by a worker into
+    // its slot, waiting for it if necessary.
+    struct pending_t {
+      Memento *slot;
+      std::future<MementoPtr> result;
+    };
+    void settle(pending_t &p) {
+      auto *slot = p.slot;
+      MementoPtr m;
+      try {
+        m = p.result.get();
+      } catch (...) {
+        drop_pending(slot); // the placeholder stays
+        throw;
+      }
+      drop_pending(slot);
+      if (m) {
+        auto bytes = slot->charged_bytes();
+        *slot = std::move(*m);
+        recharge(*slot, bytes);
+      }
+    }
+    MementoPtr &settle(MementoPtr &m) {
+      if constexpr (Traits::async_save) {
+        if (is_pending(m.get())) {
+          for (auto &p : _async.pending) {
+            if (p.slot == m.get()) {
+              settle(p);
+              break;
+            }
+          }
+        }
+      }
+      page_in(m.get());
+      return m;
+    }
+    void settle(Iterator first, Iterator last) {
+      if constexpr (Traits::async_save || Traits::spill) {
+        for (; first != last; ++first)
+          settle(*first);
+      } else {
+        UNUSED(first, last);
+      }
+    }
+    // settle the finished ones, without waiting
+    void settle_ready() {
+      auto &pending = _async.pending;
+      for (std::size_t i = 0; i < pending.size();) {
+        if (pending[i].result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+          settle(pending[i]);
+        else
+          i++;
+      }
+    }
+    bool is_pending(Memento const *slot) const {
+      if constexpr (Traits::async_save) {
+        return _async.slots.count(slot) != 0;
+      } else {
+        UNUSED(slot);
+        return false;
+      }
+    }
+    void drop_pending(Memento const *slot) {
+      if constexpr (Traits::async_save) {
+        if (!_async.slots.erase(slot))
+          return;
+        auto &pending = _async.pending;
+        auto it = std::find_if(pending.begin(), pending.end(), [slot](pending_t const &p) { return p.slot == slot; });
+        if (it != pending.end())
+          pending.erase(it);
+      } else {
+        UNUSED(slot);
+      }
+    }
+
+    // the tiered storage: the states of a cold memento are in the cold
+    // store, a paged-in one keeps its ticket so that it can be dropped
+    // again without writing.
+    static constexpr bool spillable = is_spillable_v<State> && std::is_default_constructible_v<State>;
+    static_assert(!Traits::spill || spillable, "history_traits_t::spill needs a default constructible State, trivially copyable or with a state_serializer_t");
+    struct spilled_t {
+      cold_store_t::ticket_t ticket;
+      bool resident;
+    };
+    void page_in(Memento *m) {
+      if constexpr (Traits::spill) {
+        auto it = _spill.spilled.find(m);
+        if (it == _spill.spilled.end() || it->second.resident)
+          return;
+        read_cold(m, it->second.ticket);
+        it->second.resident = true;
+        _spill.paged_in.push_back(m);
+      } else {
+        UNUSED(m);
+      }
+    }
+    void read_cold(Memento *m, cold_store_t::ticket_t const &t) {
+      _spill.store->get(t, _spill.buf);
+      if (!read_states<State>(_spill.buf, *m))
+        throw std::runtime_error("the cold store is corrupted");
+    }
+    static void page_out(Memento *m, spilled_t &s) {
+      m->for_each_state([](StateT &st) {
+        (void) std::exchange(st, StateT{}); // the old one frees its storage
+      });
+      s.resident = false;
+    }
+    void drop_spilled(Memento *m) {
+      if constexpr (Traits::spill) {
+        if (_spill.spilled.empty())
+          return;
+        auto it = _spill.spilled.find(m);
+        if (it != _spill.spilled.end()) {
+          _spill.store->release(it->second.ticket);
+          _spill.spilled.erase(it);
+        }
+      } else {
+        UNUSED(m);
+      }
+    }
+    // called by push(): spill the mementos which fell out of the hot
+    // window, in batches so that the walk is amortized O(1).
+    void spill_cold() {
+      if constexpr (Traits::spill) {
+        auto &sp = _spill;
+        if (!sp.store)
+          return;
+        auto hot = (size_type) sp.opts.hot_window;
+        while (sp.paged_in.size() > hot) {
+          auto it = sp.spilled.find(sp.paged_in.front());
+          if (it != sp.spilled.end() && it->second.resident)
+            page_out(it->first, it->second);
+          sp.paged_in.pop_front();
+        }
+        sp.unspilled = std::min(sp.unspilled, size());
+        if (sp.unspilled <= 2 * hot)
+          return;
+        auto it = std::prev(_saved_states.end(), (std::ptrdiff_t) hot);
+        for (auto n = sp.unspilled - hot; n; --n) {
+          auto &m = *--it;
+          if (m->memory_usage() < sp.opts.min_bytes || sp.spilled.count(m.get()))
+            continue;
+          if (is_pending(m.get()))
+            continue; // not built yet
+          sp.buf.clear();
+          write_states<State>(*m, sp.buf);
+          auto &s = sp.spilled[m.get()] = spilled_t{sp.store->put(sp.buf), true};
+          page_out(m.get(), s);
+        }
+        sp.unspilled = hot;
+      }
+    }
+
+    // evict the oldest mementos until the history fits max_bytes()
+    void shrink_to_budget() { evict_to(_max_bytes); }
+    // evict the branches of the undo tree, then the oldest mementos,
+    // until the footprint is no more than target. The newest one stays.
+    // A replay() repeats the journaled evictions instead.
+    void evict_to(std::size_t target) {
+      if constexpr (undo_cxx::traits::has_pop_front_v<Container>) {
+        if (replaying())
+          return;
+        while (tree() && _bytes > target && prune_leaf()) {}
+        if (_bytes <= target || size() <= 1)
+          return;
+        size_type n = 0;
+        while (_bytes > target && size() > 1) {
+          evict_front();
+          n++;
+        }
+        journal_record(journal_event_t::evict, n);
+      } else {
+        UNUSED(target);
+      }
+    }
+    // replay the eviction of the n oldest mementos
+    void evict_oldest(size_type n) {
+      if constexpr (undo_cxx::traits::has_pop_front_v<Container>) {
+        for (; n && !empty(); --n)
+          evict_front();
+      } else {
+        UNUSED(n);
+      }
+    }
+    // drop the oldest memento. _position is kept on a list unless it
+    // was the one dropped, so that it's O(1) rather than a walk from
+    // begin() on each evicting push.
+    void evict_front() {
+      auto at_front = _position == _saved_states.begin();
+      make_keyframe(1);
+      release(_saved_states.front());
+      _saved_states.pop_front();
+      _evicted++;
+      if (_cursor > 0)
+        --_cursor;
+      if constexpr (is_list<Container>::value) {
+        if (at_front)
+          _position = _saved_states.begin();
+      } else {
+        UNUSED(at_front);
+        _position = std::next(_saved_states.begin(), (std::ptrdiff_t) _cursor);
+      }
+    }
+
+    // the manager as a document of a history_pool_t
+    struct pool_member_t final : history_pool_t::member_t {
+      explicit pool_member_t(undoable_cmd_system_t &mgr)
+          : _mgr(mgr) {}
+      std::size_t shed(std::size_t bytes) override {
+        auto before = _mgr._bytes;
+        _mgr.evict_to(bytes < before ? before - bytes : 0);
+        return before - _mgr._bytes;
+      }
+      undoable_cmd_system_t &_mgr;
+    };
+    // report the footprint to the pool at the end of an operation, it
+    // may evict from this history, too.
+    void charge_pool() {
+      if constexpr (Traits::shared_pool) {
+        if (_shared.member)
+          _shared.pool->charge(*_shared.member, _bytes);
+      }
+    }
+
+    // the undo tree: the least recently visited leaf off the active
+    // path is dropped, false if there's none.
+    bool prune_leaf() {
+      if constexpr (Traits::tree) {
+        auto n = _tree.nodes->lru_leaf();
+        if (n == tree_type::npos)
+          return false;
+        auto m = _tree.nodes->take(n);
+        release(m);
+        _evicted++;
+        return true;
+      } else {
+        return false;
+      }
+    }
+    void prune_tree() {
+      if constexpr (Traits::tree) {
+        while (_tree.nodes && _tree.nodes->size() > _tree.max_nodes && prune_leaf()) {}
+      }
+    }
+    void move_to(size_type pos) {
+      if (pos < _cursor)
+        undo_to(pos);
+      else if (pos > _cursor)
+        redo_to(pos);
+    }
+    // erase [_position..), the undo tree keeps it as a branch
+    void cut_tail() {
+      auto dropped = size() - _cursor;
+      for (auto it = _position; it != _saved_states.end(); ++it) {
+        if constexpr (Traits::tree) {
+          if (auto &t = _tree.nodes) {
+            if constexpr (Traits::selective) {
+              if (_footprints)
+                _footprints->deactivate(it->get());
+            }
+            t->detach(t->find(it->get()), std::move(*it));
+            continue;
+          }
+        }
+        release(*it);
+      }
+      _saved_states.erase(_position, _saved_states.end());
+      if constexpr (Traits::spill) {
+        _spill.unspilled = _spill.unspilled > dropped ? _spill.unspilled - dropped : 0;
+      } else {
+        UNUSED(dropped);
+      }
+    }
+    // the undo tree: replace the redo tail by the branch from c (a child
+    // of current_node()) down along the last visited children.
+    void graft(node_id c) {
+      cut_tail();
+      auto before = _cursor ? std::prev(_saved_states.end()) : _saved_states.end();
+      auto &t = _tree.nodes;
+      t->select(c);
+      for (auto n = c; n != tree_type::npos; n = t->active_child(n)) {
+        _saved_states.emplace_back(t->attach(n));
+        if constexpr (Traits::selective) {
+          if (_footprints)
+            _footprints->activate(_saved_states.back().get());
+        }
+        if constexpr (Traits::spill) {
+          _spill.unspilled++;
+        }
+      }
+      _position = _cursor ? std::next(before) : _saved_states.begin();
+      seal();
+      journal_graft();
+      trace(trace::event_t::branch, *_position);
+    }
+
     void push(MementoPtr &&s) {
       if (!empty()) {
         if (_position != _saved_states.end()) {
-          // erase [_position..)
-          _saved_states.erase(_position, _saved_states.end());
+          cut_tail();
         }
       }
 
-      if (size() >= _max_size) {
+      if (size() >= _max_size && !replaying()) {
+        make_keyframe(1);
         if constexpr (undo_cxx::traits::has_max_size_set_v<Container>) {
-          // nothing to do here
+          // the container evicts the oldest one by itself
+          release(_saved_states.front());
+          _evicted++;
         } else if constexpr (undo_cxx::traits::has_pop_front_v<Container>) {
+          release(_saved_states.front());
           _saved_states.pop_front();
+          _evicted++;
         }
+        journal_record(journal_event_t::evict, 1);
       }
 
       // insert element at _position
@@ -535,8 +2606,27 @@ namespace undo_cxx {
         return;
       }
       _position = _saved_states.end();
+      _cursor = size();
+      recharge(*_saved_states.back(), 0);
+      if constexpr (Traits::spill) {
+        _spill.unspilled++;
+      }
+      if constexpr (Traits::selective) {
+        if (_footprints)
+          _footprints->insert(_saved_states.back().get(), nullptr);
+      }
+      if constexpr (Traits::tree) {
+        if (auto &t = _tree.nodes) {
+          auto parent = size() > 1 ? t->find(std::prev(_saved_states.end(), 2)->get()) : tree_type::root;
+          t->add(parent, _saved_states.back().get());
+          prune_tree();
+        }
+      }
 
-      dbg_print("  . save memento state at position #%d: %s, size=%d", position(), undo_cxx::to_string(*_saved_states.back()).c_str(), size());
+      trace(trace::event_t::save, _saved_states.back());
+      journal_record(journal_event_t::save);
+      shrink_to_budget();
+      spill_cold();
     }
     bool pop() {
       if (_saved_states.empty()) {
@@ -550,8 +2640,11 @@ namespace undo_cxx {
       Iterator it = _position;
       it--;
       _position = it;
+      --_cursor;
 
-      dbg_print("  . restore memento state at position #%d: %s, size=%d", position(), undo_cxx::to_string(**_position).c_str(), size());
+      trace(trace::event_t::restore, settle(*_position));
+      seal();
+      journal_cursor();
       return true;
     }
     bool pop_old(MementoPtr &s) {
@@ -567,8 +2660,9 @@ namespace undo_cxx {
       it--;
       s = std::move(*it);
       _position = it;
+      --_cursor;
 
-      dbg_print("  . restore memento state at position #%d: %s, size=%d", position(), undo_cxx::to_string(*s).c_str(), size());
+      trace(trace::event_t::restore, s);
       return true;
     }
     bool replay_one_impl() {
@@ -580,13 +2674,13 @@ namespace undo_cxx {
         return false;
       }
 
-      Iterator it = _position;
-      auto &v = (*it);
-      auto &vv = (*v);
-      dbg_print("  . replay memento state at position #%d: %s, size=%d", position(), undo_cxx::to_string(vv).c_str(), size());
+      trace(trace::event_t::replay, settle(*_position));
       if (_position != _saved_states.end()) {
         _position++;
+        _cursor++;
       }
+      seal();
+      journal_cursor();
 
       return true;
     }
@@ -612,11 +2706,71 @@ namespace undo_cxx {
     bool can_pop() const { return !empty(); }
 #endif
 
+    // the open group, see begin_group(); kept for the next one, with
+    // the scratch arena
+    struct group_state_t {
+      explicit group_state_t(std::pmr::memory_resource *upstream)
+          : scratch(upstream) {}
+      std::pmr::monotonic_buffer_resource scratch;
+      CmdSP cmd{};
+      MementoPtr memento{};
+      std::size_t depth{};
+    };
+
+    // the optional tiers, each one is turned on by its flag of
+    // history_traits_t; the ones off take no room.
+    struct async_tier_t {
+      util::worker_pool_t *pool{};
+      std::vector<pending_t> pending{};
+      std::unordered_set<Memento const *> slots{}; // of pending
+    };
+    struct journal_tier_t {
+      journal_t<State> *sink{};
+      bool replaying{};
+    };
+    struct spill_tier_t {
+      cold_store_t *store{};
+      spill_options_t opts{};
+      std::unordered_map<Memento *, spilled_t> spilled{};
+      std::deque<Memento *> paged_in{};
+      std::string buf{};
+      size_type unspilled{};
+    };
+    struct merge_tier_t {
+      std::chrono::milliseconds window{Traits::merge_window};
+      bool same_id{Traits::merge_same_id};
+      std::chrono::steady_clock::time_point last_save{};
+    };
+    struct tree_tier_t {
+      std::unique_ptr<tree_type> nodes{};
+      size_type max_nodes{SIZE_T_MAX};
+    };
+    struct shared_tier_t {
+      history_pool_t *pool{};
+      std::unique_ptr<pool_member_t> member{};
+    };
+
   private:
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> _arena{};
+    std::pmr::memory_resource *_resource{};
     Container _saved_states{};
     Iterator _position{_saved_states.end()};
+    size_type _cursor{};
     size_type _max_size{SIZE_T_MAX};
+    size_type _keyframe_interval{Traits::keyframe_interval};
+    std::size_t _bytes{};
+    std::size_t _max_bytes{SIZE_T_MAX};
+    std::size_t _evicted{};
     ContextT _ctx{*this};
+    UNDO_CXX_NO_UNIQUE_ADDRESS Tracer _tracer{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::async_save, async_tier_t> _async{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::journal, journal_tier_t> _journal{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::spill, spill_tier_t> _spill{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::merge, merge_tier_t> _merge{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::tree, tree_tier_t> _tree{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::selective, std::unique_ptr<footprint_index_t>> _footprints{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::shared_pool, shared_tier_t> _shared{};
+    UNDO_CXX_NO_UNIQUE_ADDRESS detail::tier_t<Traits::groups, std::unique_ptr<group_state_t>> _group{};
   };
 
 } // namespace undo_cxx
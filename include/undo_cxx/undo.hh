@@ -23,8 +23,25 @@
 #include "undo-common.hh"
 #include "undo-log.hh"
 
+#include "undo-codec.hh"
+#include "undo-cow.hh"
 #include "undo-dbg.hh"
+#include "undo-delta.hh"
+#include "undo-footprint.hh"
+#include "undo-inline.hh"
+#include "undo-intrusive.hh"
+#include "undo-journal.hh"
+#include "undo-mpsc.hh"
+#include "undo-pool.hh"
+#include "undo-ring.hh"
+#include "undo-shared.hh"
+#include "undo-spill.hh"
+#include "undo-tier.hh"
+#include "undo-trace.hh"
+#include "undo-tree.hh"
 #include "undo-util.hh"
+#include "undo-value.hh"
+#include "undo-variant.hh"
 
 #include "undo-zcore.hh"
 
@@ -10,6 +10,8 @@
 
 #include "undo_cxx/undo-util.hh"
 
+#include "test-expect.hh"
+
 #include <cmath>
 #include <iostream>
 
@@ -48,6 +50,39 @@ namespace {
     p->run();
   }
 
+  static int test_10() {
+    using namespace undo_cxx;
+    namespace fct = undo_cxx::util::factory;
+
+    struct Base {
+      virtual ~Base() {}
+      virtual int value() const = 0;
+    };
+    struct A : public Base {
+      int value() const override { return 0; }
+    };
+    struct B : public Base {
+      B() {}
+      B(int v)
+          : _v(v) {}
+      int value() const override { return _v; }
+      int _v{1};
+    };
+    struct C : public Base {
+      int value() const override { return 2; }
+    };
+
+    using Factory = fct::factory<Base, A, B, C>;
+
+    expect(Factory::create(id_name<C>())->value() == 2, "create by id");
+    expect(Factory::make_shared(id_name<B>())->value() == 1, "make_shared by id");
+    expect(Factory::create(id_name<B>(), 7)->value() == 7, "create with args");
+    expect(!Factory::create(id_name<A>(), 7), "A can't be constructed from an int");
+    expect(!Factory::create("no-such-product"), "unknown id");
+    expect(Factory::contains(id_name<A>()) && !Factory::contains("no-such-product"), "contains");
+    return failed;
+  }
+
 } // namespace
 
 ///////////////////////////////////////////////////////////////////
@@ -59,4 +94,5 @@ namespace {
 int main() {
   // test_1();
   test_9();
+  return test_10();
 }
\ No newline at end of file
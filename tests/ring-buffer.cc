@@ -0,0 +1,124 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/3.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  struct ring_state {
+    std::string text;
+    friend std::ostream &operator<<(std::ostream &os, ring_state const &o) { return os << o.text; }
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::ring_state> : undo_cxx::default_history_traits_t {
+  template<typename T>
+  using container = undo_cxx::util::ring_buffer_t<T>;
+};
+
+namespace {
+  static void test_ring_buffer() {
+    using RB = undo_cxx::util::ring_buffer_t<std::unique_ptr<int>>;
+    static_assert(undo_cxx::traits::has_max_size_set_v<RB>);
+    static_assert(undo_cxx::traits::has_emplace_back_v<RB>);
+
+    RB rb;
+    for (int i = 0; i < 20; i++)
+      rb.emplace_back(std::make_unique<int>(i));
+    expect(rb.size() == 20, "unbounded ring buffer grows");
+    expect(*rb.front() == 0 && *rb.back() == 19, "front/back");
+
+    rb.max_size(8);
+    expect(rb.size() == 8 && *rb.front() == 12, "max_size() drops the oldest");
+    auto *cap = &rb[0];
+    for (int i = 20; i < 30; i++)
+      rb.emplace_back(std::make_unique<int>(i));
+    expect(rb.size() == 8 && rb.capacity() == 8, "bounded ring buffer never grows");
+    expect(*rb.front() == 22 && *rb.back() == 29, "evict the oldest when full");
+    expect(cap == &rb[6], "no shifting while evicting");
+
+    int expected = 22;
+    for (auto &p : rb)
+      expect(*p == expected++, "iterating from the oldest");
+    expect(rb.end() - rb.begin() == 8, "random-access iterators");
+
+    rb.erase(rb.begin() + 5, rb.end());
+    expect(rb.size() == 5 && *rb.back() == 26, "erase the tail");
+    rb.erase(rb.begin() + 1);
+    expect(rb.size() == 4 && *rb[1] == 24, "erase in the middle");
+    rb.erase(rb.begin(), rb.begin() + 2);
+    expect(rb.size() == 2 && *rb.front() == 25, "erase the head");
+
+    rb.clear();
+    expect(rb.empty(), "clear");
+  }
+
+  static void test_ring_history() {
+    using namespace dp::undo::test;
+    using State = ring_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using TextCmdT = TextCmd<State>;
+    static_assert(std::is_same_v<M::Container, undo_cxx::util::ring_buffer_t<M::MementoPtr>>);
+
+    M mgr;
+    mgr.max_size(3);
+    for (auto const *t : {"a", "b", "c", "d", "e"})
+      mgr.invoke<TextCmdT>(t);
+    expect(mgr.size() == 3, "the history is bounded");
+    expect((*mgr.newest_item())().text == "e", "the newest one");
+    expect((**mgr.oldest_iterator())().text == "c", "the oldest one");
+
+    M::CmdSP undo_cmd = std::make_shared<TextCmdT>("undo");
+    mgr.undo(undo_cmd);
+    mgr.undo(undo_cmd);
+    expect(mgr.position() == 1, "undo twice");
+    mgr.invoke<TextCmdT>("f");
+    expect(mgr.size() == 2 && mgr.position() == 2, "the redo branch is discarded");
+
+    mgr.max_size(1);
+    expect(mgr.size() == 1 && mgr.position() == 1, "shrink the history");
+    expect((*mgr.newest_item())().text == "f", "the newest one is kept");
+  }
+} // namespace
+
+int main() {
+  test_ring_buffer();
+  test_ring_history();
+  return failed;
+}
@@ -0,0 +1,28 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#ifndef UNDO_CXX_TEST_EXPECT_HH
+#define UNDO_CXX_TEST_EXPECT_HH
+
+#include <iostream>
+
+// the checks of a test program, main() returns `failed`
+namespace {
+  static int failed = 0;
+
+  static void expect(bool cond, char const *what) {
+    if (!cond) {
+      std::cerr << "FAILED: " << what << '\n';
+      failed++;
+    }
+  }
+} // namespace
+
+#endif //UNDO_CXX_TEST_EXPECT_HH
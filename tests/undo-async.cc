@@ -0,0 +1,189 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/10.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <future>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace dp { namespace undo { namespace test {
+
+  struct async_state {
+    std::string text;
+
+    void serialize(std::string &out) const { out += text; }
+    bool deserialize(std::string_view in) {
+      text.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, async_state const &o) { return os << o.text; }
+  };
+
+  // the memento is built on a worker, which is held by the gate until
+  // the test opens it.
+  template<typename State>
+  class SlowCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~SlowCmd() {}
+    SlowCmd(std::string const &text, std::shared_future<void> gate)
+        : _text(text)
+        , _gate(std::move(gate)) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(SlowCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    MementoFn capture_state_impl(CmdSP &sender, ContextT &) override {
+      return [sender, text = _text, gate = _gate]() mutable -> MementoPtr {
+        gate.wait();
+        if (text == "bad")
+          throw std::runtime_error("bad memento");
+        return std::make_unique<Memento>(sender, State{text + "!"});
+      };
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+    std::shared_future<void> _gate{};
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::async_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+  static constexpr bool async_save = true;
+  static constexpr bool spill = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = async_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+
+  static void test_async_save() {
+    undo_cxx::util::worker_pool_t pool{2};
+    std::promise<void> open;
+    std::shared_future<void> gate{open.get_future()};
+
+    M mgr;
+    mgr.async_save(&pool);
+    mgr.invoke<TextCmd<State>>("a");
+    mgr.invoke<SlowCmd<State>>("b", gate);
+    mgr.invoke<SlowCmd<State>>("c", gate);
+    expect(mgr.size() == 3 && mgr.position() == 3, "the slots are reserved at once");
+    expect(mgr.pending() == 2, "the slow mementos are being built");
+
+    open.set_value();
+    M::CmdSP undo_cmd = std::make_shared<TextCmd<State>>("undo");
+    mgr.undo(undo_cmd);
+    expect((*mgr.focused_item())().text == "c!", "undo waits for the slot it reaches");
+    mgr.undo(undo_cmd);
+    expect((*mgr.focused_item())().text == "b!" && mgr.pending() == 0, "every slot is settled");
+    mgr.redo(undo_cmd, 2);
+    expect(mgr.position() == 3, "redo");
+  }
+
+  static void test_async_discard() {
+    undo_cxx::util::worker_pool_t pool{1};
+    std::promise<void> open, never;
+    std::shared_future<void> gate{open.get_future()}, closed{never.get_future()};
+
+    M mgr;
+    mgr.async_save(&pool);
+    mgr.invoke<TextCmd<State>>("a");
+    mgr.invoke<SlowCmd<State>>("b", gate);
+    open.set_value();
+    auto r = mgr.undo_to(1);
+    expect(r.size() == 1 && (*r.front())().text == "b!", "the undone slot is settled");
+    mgr.invoke<SlowCmd<State>>("c", gate);
+    expect(mgr.size() == 2, "the redo branch is discarded");
+    mgr.wait_pending();
+    expect((*mgr.newest_item())().text == "c!" && mgr.pending() == 0, "wait_pending()");
+
+    mgr.invoke<SlowCmd<State>>("bad", gate);
+    bool thrown = false;
+    try {
+      mgr.wait_pending();
+    } catch (std::runtime_error const &) {
+      thrown = true;
+    }
+    expect(thrown && mgr.pending() == 0, "the exception of a worker is rethrown when it's settled");
+
+    mgr.async_save(nullptr);
+    mgr.invoke<SlowCmd<State>>("d", gate);
+    expect(mgr.pending() == 0 && (*mgr.newest_item())().text == "d", "synchronous save");
+
+    mgr.async_save(&pool);
+    mgr.invoke<SlowCmd<State>>("e", closed);
+    expect(mgr.pending() == 1, "a slot which never finishes");
+    mgr.clear();
+    expect(mgr.empty() && mgr.pending() == 0, "clear() discards the pending slots");
+    never.set_value(); // let the worker go
+  }
+
+  static void test_async_spill() {
+    undo_cxx::util::worker_pool_t pool{1};
+    undo_cxx::spill_file_t file;
+    std::promise<void> open;
+    std::shared_future<void> gate{open.get_future()};
+
+    M mgr;
+    mgr.async_save(&pool);
+    mgr.spill(&file, undo_cxx::spill_options_t{1, 0});
+    mgr.invoke<SlowCmd<State>>("a", gate);
+    for (auto s : {"b", "c", "d"})
+      mgr.invoke<TextCmd<State>>(s);
+    expect(mgr.pending() == 1 && mgr.spilled() == 1, "a pending slot isn't spilled, the one after it is");
+
+    open.set_value();
+    mgr.undo_to(0);
+    expect((*mgr.focused_item())().text == "a!", "the slot is settled in place");
+    auto r = mgr.redo_to(3);
+    expect(r.size() == 3 && (**std::next(r.begin()))().text == "b" && mgr.spilled() == 0, "the spilled one is paged in");
+  }
+} // namespace
+
+int main() {
+  test_async_save();
+  test_async_discard();
+  test_async_spill();
+  return failed;
+}
@@ -0,0 +1,150 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/7.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  // reports its footprint by itself
+  struct blob_state {
+    std::string data;
+    std::size_t memory_usage() const { return sizeof(blob_state) + data.capacity(); }
+    friend std::ostream &operator<<(std::ostream &os, blob_state const &o) { return os << o.data.size() << " bytes"; }
+  };
+
+  // reports its footprint by history_traits_t
+  struct plain_state {
+    std::size_t size;
+    friend std::ostream &operator<<(std::ostream &os, plain_state const &o) { return os << o.size << " bytes"; }
+  };
+
+  template<typename State>
+  class BlobCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~BlobCmd() {}
+    BlobCmd() {}
+    BlobCmd(std::size_t size)
+        : _size(size) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(BlobCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      if constexpr (std::is_same_v<State, blob_state>)
+        return std::make_unique<Memento>(sender, State{std::string(_size, 'x')});
+      else
+        return std::make_unique<Memento>(sender, State{_size});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::size_t _size{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::plain_state> : undo_cxx::default_history_traits_t {
+  static std::size_t memory_usage(dp::undo::test::plain_state const &s) { return s.size; }
+};
+
+namespace {
+  template<typename State>
+  static void test_budget() {
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using BlobCmdT = dp::undo::test::BlobCmd<State>;
+
+    M mgr;
+    mgr.template invoke<BlobCmdT>(1000);
+    auto one = mgr.memory_usage();
+    expect(one >= 1000, "the footprint of a memento");
+
+    mgr.max_bytes(one * 3 + one / 2);
+    for (int i = 0; i < 9; i++)
+      mgr.template invoke<BlobCmdT>(1000);
+    auto c = mgr.counters();
+    expect(c.entries == 3 && c.bytes == one * 3, "the history fits the budget");
+    expect(c.evicted == 7, "the oldest ones are evicted");
+    expect(mgr.position() == 3, "the cursor follows the eviction");
+
+    // a huge one is kept alone
+    mgr.template invoke<BlobCmdT>(100000);
+    expect(mgr.size() == 1 && mgr.memory_usage() > mgr.max_bytes(), "the newest one is always kept");
+
+    mgr.template invoke<BlobCmdT>(1000);
+    mgr.template invoke<BlobCmdT>(1000);
+    typename M::CmdSP cmd = std::make_shared<BlobCmdT>();
+    mgr.undo(cmd);
+    mgr.template invoke<BlobCmdT>(1000);
+    expect(mgr.memory_usage() == one * 2, "discarding the redo tail is accounted");
+
+    mgr.max_bytes(one);
+    expect(mgr.size() == 1 && mgr.memory_usage() == one, "shrink the budget");
+
+    mgr.clear();
+    expect(mgr.memory_usage() == 0 && mgr.counters().entries == 0, "clear() resets the counters");
+  }
+
+  static void test_changed_memento() {
+    using State = dp::undo::test::blob_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using BlobCmdT = dp::undo::test::BlobCmd<State>;
+
+    M mgr;
+    for (int i = 0; i < 3; i++)
+      mgr.invoke<BlobCmdT>(1000);
+    auto three = mgr.memory_usage();
+    M::CmdSP cmd = std::make_shared<BlobCmdT>();
+    mgr.undo(cmd);
+    // the app changes a memento out of the history
+    (*mgr.focused_item())().data.assign(100000, 'x');
+    expect(mgr.memory_usage() == three, "charged by the footprint when it was saved");
+    mgr.erase();
+    expect(mgr.memory_usage() == three / 3 * 2, "released by the bytes it was charged");
+    mgr.undo(cmd);
+    (*mgr.focused_item())().data.clear();
+    mgr.undo(cmd);
+    mgr.erase(2);
+    expect(mgr.empty() && mgr.memory_usage() == 0, "no underflow");
+  }
+
+  static void test_evict_before_cursor() {
+    using State = dp::undo::test::blob_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using BlobCmdT = dp::undo::test::BlobCmd<State>;
+
+    M mgr;
+    for (std::size_t i = 0; i < 4; i++)
+      mgr.invoke<BlobCmdT>(1000 + i);
+    mgr.undo_to(2);
+    mgr.max_bytes(mgr.memory_usage() / 2 + 100);
+    expect(mgr.size() == 2 && mgr.position() == 0, "the cursor is at the oldest one kept");
+    expect((*mgr.focused_item())().data.size() == 1002, "and the position follows it");
+
+    mgr.redo_to(1);
+    mgr.max_bytes(1);
+    expect(mgr.size() == 1 && mgr.position() == 0 && (*mgr.focused_item())().data.size() == 1003, "the position is kept");
+  }
+} // namespace
+
+int main() {
+  test_budget<dp::undo::test::blob_state>();
+  test_budget<dp::undo::test::plain_state>();
+  test_changed_memento();
+  test_evict_before_cursor();
+  return failed;
+}
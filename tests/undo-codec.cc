@@ -0,0 +1,172 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/13.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  struct text_state {
+    std::string text;
+
+    void serialize(std::string &out) const { out += text; }
+    bool deserialize(std::string_view in) {
+      text.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, text_state const &o) { return os << o.text; }
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+  // a user codec: run-length pairs of (count, byte)
+  struct rle_codec_t : undo_cxx::codec_t {
+    void compress(std::string_view in, std::string &out) const override {
+      for (std::size_t i = 0, n; i < in.size(); i += n) {
+        for (n = 1; i + n < in.size() && n < 255 && in[i + n] == in[i];)
+          n++;
+        out.push_back((char) n);
+        out.push_back(in[i]);
+      }
+    }
+    bool decompress(std::string_view in, std::size_t raw_size, std::string &out) const override {
+      auto base = out.size();
+      for (std::size_t i = 0; i + 1 < in.size(); i += 2)
+        out.append((std::size_t) (unsigned char) in[i], in[i + 1]);
+      decompressed++;
+      return out.size() - base == raw_size;
+    }
+    mutable int decompressed{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::text_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+  static constexpr bool spill = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = text_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+
+  static std::string document(int i) {
+    std::string s;
+    for (int k = 0; k < 40; k++)
+      s += "line " + std::to_string(k) + ": the quick brown fox jumps over the lazy dog #" + std::to_string(i) + "\n";
+    return s;
+  }
+
+  static bool round_trip(std::string const &in, std::size_t *packed = nullptr) {
+    undo_cxx::lz_codec_t lz;
+    std::string z, out = "x";
+    lz.compress(in, z);
+    if (packed) *packed = z.size();
+    return lz.decompress(z, in.size(), out) && out == "x" + in;
+  }
+
+  static void test_lz() {
+    std::mt19937 rng{42};
+    std::string random(100000, '\0');
+    for (auto &c : random)
+      c = (char) rng();
+    std::size_t packed{};
+    expect(round_trip("") && round_trip("a") && round_trip("abcd") && round_trip("abcabcabcabc"), "the short ones");
+    expect(round_trip(std::string(70000, 'z'), &packed) && packed < 400, "a long run");
+    expect(round_trip(random, &packed) && packed < random.size() + random.size() / 100, "the incompressible bytes");
+    expect(round_trip(document(1), &packed) && packed * 5 < document(1).size(), "text");
+    expect(round_trip(random.substr(0, 300) + std::string(1000, 'q') + random.substr(0, 300)), "a far match");
+
+    undo_cxx::lz_codec_t lz;
+    std::string z, out;
+    lz.compress(document(2), z);
+    bool rejected = true;
+    for (std::size_t cut = 0; cut < z.size(); cut += 7) {
+      out.clear();
+      rejected = rejected && !lz.decompress(std::string_view{z}.substr(0, cut), document(2).size(), out);
+    }
+    expect(rejected, "the truncated ones are rejected");
+    z[0] = (char) 0x0f; // a match before any output
+    out.clear();
+    expect(!lz.decompress(z, document(2).size(), out), "a bad offset is rejected");
+  }
+
+  static void test_store(undo_cxx::util::worker_pool_t *pool) {
+    undo_cxx::compressed_store_t cold{pool, nullptr, undo_cxx::compressed_store_options_t{16 * 1024}};
+    M mgr;
+    mgr.spill(&cold, undo_cxx::spill_options_t{4, 0});
+    for (int i = 0; i < 50; i++)
+      mgr.invoke<TextCmd<State>>(document(i));
+    cold.flush();
+    expect(cold.size() == 45 && mgr.spilled() == 45, "the cold ones are in the store");
+    expect(cold.stored_bytes() * 5 < cold.raw_bytes(), "they're compressed");
+    auto t = mgr.cold_ticket(*mgr.oldest_iterator());
+    auto sz = t ? cold.sizes(*t) : undo_cxx::compressed_store_t::sizes_t{};
+    expect(sz.raw > document(0).size() && sz.stored * 5 < sz.raw, "the sizes of an entry");
+    expect(!mgr.cold_ticket(mgr.newest_item()), "the hot ones have no ticket");
+
+    auto r = mgr.undo_to(0);
+    bool same = r.size() == 50;
+    int i = 0;
+    for (auto &m : r)
+      same = same && (*m)().text == document(i++);
+    expect(same, "every memento is decompressed on access");
+
+    mgr.invoke<TextCmd<State>>("x");
+    expect(cold.size() == 0 && cold.raw_bytes() == 0 && cold.stored_bytes() == 0, "the dropped ones are released");
+  }
+
+  static void test_user_codec() {
+    rle_codec_t codec;
+    undo_cxx::compressed_store_t cold{nullptr, &codec, undo_cxx::compressed_store_options_t{1}};
+    M mgr;
+    mgr.spill(&cold, undo_cxx::spill_options_t{1, 0});
+    for (char c : {'a', 'b', 'c', 'd'})
+      mgr.invoke<TextCmd<State>>(std::string(100, c));
+    expect(cold.size() == 2 && cold.stored_bytes() < cold.raw_bytes(), "spilled");
+    mgr.undo_to(0);
+    expect((*mgr.focused_item())().text == std::string(100, 'a') && codec.decompressed == 2, "the user codec");
+  }
+} // namespace
+
+int main() {
+  test_lz();
+  test_store(nullptr);
+  undo_cxx::util::worker_pool_t pool{1};
+  test_store(&pool);
+  test_user_codec();
+  return failed;
+}
@@ -0,0 +1,143 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  struct char_state {
+    char ch;
+    friend std::ostream &operator<<(std::ostream &os, char_state const &o) { return os << o.ch; }
+  };
+
+  // appends a char to the text
+  template<typename State>
+  class AppendCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~AppendCmd() {}
+    AppendCmd(std::string *text, char ch)
+        : _text(text)
+        , _ch(ch) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(AppendCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override { _text->push_back(_ch); }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_ch});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override { _text->pop_back(); }
+    void redo_impl(CmdSP &, ContextT &, Memento &memento) override { _text->push_back(memento().ch); }
+
+  private:
+    std::string *_text;
+    char _ch;
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::char_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = char_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using Composite = undo_cxx::composite_cmd_t<State>;
+  using Append = AppendCmd<State>;
+
+  // the chars of s, in a composite
+  static std::shared_ptr<Composite> group(std::string *text, char const *s) {
+    auto c = std::make_shared<Composite>();
+    for (; *s; s++)
+      c->add_command(std::make_shared<Append>(text, *s));
+    return c;
+  }
+
+  static void test_flatten() {
+    std::string text;
+    auto inner = group(&text, "cd");
+    auto middle = group(&text, "b");
+    middle->add_command(inner);
+    middle->add_command(std::make_shared<Append>(&text, 'e'));
+    auto outer = std::make_shared<Composite>();
+    outer->reserve(4);
+    outer->add_command(std::make_shared<Append>(&text, 'a'));
+    outer->add_command(middle);
+    outer->add_command(group(&text, "f"));
+    expect(outer->size() == 3 && !outer->closed(), "nested");
+
+    outer->close();
+    expect(outer->size() == 6 && outer->closed() && middle->size() == 3, "flattened, the nested ones are left as they are");
+    int leaves = 0;
+    outer->for_each([&](Composite::CmdSP &cmd) { leaves += dynamic_cast<Append *>(cmd.get()) != nullptr; });
+    expect(leaves == 6, "the leaves only");
+
+    M mgr;
+    M::CmdSP cmd = outer;
+    mgr.invoke(cmd);
+    expect(text == "abcdef", "executed");
+    auto &memento = *mgr.newest_item();
+    std::string slots;
+    memento.for_each_children([&](Composite::Memento::Pair &p) { slots.push_back(p.second.ch); });
+    expect(memento.size() == 7 && slots == "abcdef", "the memento in the same flat order");
+
+    M::ContextT ctx{mgr};
+    cmd->undo(cmd, ctx, memento);
+    expect(text.empty(), "undo");
+    cmd->redo(cmd, ctx, memento);
+    expect(text == "abcdef", "redo");
+
+    outer->add_command(group(&text, "g"));
+    expect(!outer->closed() && outer->size() == 7, "reopened");
+    outer->close();
+    expect(outer->size() == 7, "closed again");
+  }
+
+  static void test_nested() {
+    std::string text;
+    auto inner = group(&text, "cd");
+    auto middle = group(&text, "b");
+    middle->add_command(inner);
+    auto outer = std::make_shared<Composite>();
+    outer->add_command(std::make_shared<Append>(&text, 'a'));
+    outer->add_command(middle);
+    outer->add_command(std::make_shared<Append>(&text, 'e'));
+    expect(!outer->closed() && !middle->closed(), "not closed");
+
+    M mgr;
+    M::CmdSP cmd = outer;
+    mgr.invoke(cmd);
+    expect(text == "abcde", "executed");
+    auto &memento = *mgr.newest_item();
+    std::string slots;
+    memento.for_each_children([&](Composite::Memento::Pair &p) { slots.push_back(p.second.ch); });
+    expect(memento.size() == 6 && slots == "abcde", "the states of the nested ones are spliced in");
+
+    M::ContextT ctx{mgr};
+    cmd->undo(cmd, ctx, memento);
+    expect(text.empty(), "undo the nested ones");
+    cmd->redo(cmd, ctx, memento);
+    expect(text == "abcde", "redo the nested ones");
+  }
+} // namespace
+
+int main() {
+  test_flatten();
+  test_nested();
+  return failed;
+}
@@ -0,0 +1,96 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/6.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  using cow_state = undo_cxx::cow_state_t<std::string, undo_cxx::fixed_chunker_t<std::string, 4>>;
+
+  static std::string document;
+
+  // overwrite the document at a position
+  template<typename State>
+  class PutCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~PutCmd() {}
+    PutCmd() {}
+    PutCmd(std::size_t at, std::string const &text)
+        : _at(at), _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(PutCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      document.replace(_at, _text.size(), _text);
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) override {
+      return std::make_unique<Memento>(sender, State::snapshot(document, ctx.mgr.previous_state()));
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::size_t _at{};
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+namespace {
+  static void test_snapshot() {
+    using State = dp::undo::test::cow_state;
+
+    auto a = State::snapshot("0123456789");
+    expect(a.size() == 3 && a.document() == "0123456789", "split into chunks");
+
+    auto b = State::snapshot("0123ABCD89", &a);
+    expect(b.shared_with(a) == 2, "unchanged chunks are shared");
+    expect(b.document() == "0123ABCD89", "rebuild the document");
+
+    auto c = b.set(2, "xy");
+    expect(c.shared_with(b) == 2 && c.document() == "0123ABCDxy", "copy-on-write edit");
+    expect(b.document() == "0123ABCD89", "the original snapshot is immutable");
+  }
+
+  static void test_cow_history() {
+    using namespace dp::undo::test;
+    using State = cow_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using PutCmdT = PutCmd<State>;
+
+    document = "aaaabbbbccccdddd";
+    M mgr;
+    expect(mgr.previous_state() == nullptr, "no previous state");
+    mgr.invoke<PutCmdT>(0, "A");
+    mgr.invoke<PutCmdT>(8, "C");
+    mgr.invoke<PutCmdT>(12, "D");
+
+    M::CmdSP cmd = std::make_shared<PutCmdT>();
+    mgr.undo(cmd);
+    auto const &newest = (*mgr.newest_item())();
+    auto const &focused = (*mgr.focused_item())();
+    expect(focused.document() == "AaaabbbbCcccDddd", "the previous snapshot");
+    expect(newest.document() == "AaaabbbbCcccdddd", "the newest snapshot");
+    expect(focused.shared_with(newest) == 3, "consecutive snapshots share 3 of 4 chunks");
+    expect(focused.chunk_ref(1) == (**mgr.oldest_iterator())().chunk_ref(1), "chunk 1 is never copied");
+  }
+} // namespace
+
+int main() {
+  test_snapshot();
+  test_cow_history();
+  return failed;
+}
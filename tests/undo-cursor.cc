@@ -0,0 +1,143 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/10/12.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+
+namespace dp { namespace undo { namespace test {
+
+  // the history is a std::list
+  struct list_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, list_state const &o) { return os << o.value; }
+  };
+  // the history is a ring_buffer_t
+  struct ring_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, ring_state const &o) { return os << o.value; }
+  };
+
+  template<typename State>
+  class ValueCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~ValueCmd() {}
+    ValueCmd(int value)
+        : _value(value) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(ValueCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_value});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    int _value{};
+  };
+
+  struct cursor_traits_t : undo_cxx::default_history_traits_t {
+    using tracer = undo_cxx::trace::null_tracer_t;
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::list_state> : dp::undo::test::cursor_traits_t {
+  template<typename T>
+  using container = std::list<T>;
+};
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::ring_state> : dp::undo::test::cursor_traits_t {
+  template<typename T>
+  using container = undo_cxx::util::ring_buffer_t<T>;
+};
+
+namespace {
+  template<typename M>
+  static bool at(M const &mgr, std::ptrdiff_t pos, bool can_undo, bool can_redo) {
+    return mgr.position() == pos && mgr.can_undo() == can_undo && mgr.can_redo() == can_redo;
+  }
+  template<typename M>
+  static void fill(M &mgr, int from, int to) {
+    for (int i = from; i < to; i++)
+      mgr.template invoke<dp::undo::test::ValueCmd<typename M::StateT>>(i);
+  }
+
+  template<typename State>
+  static void test_cursor() {
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+
+    M mgr;
+    typename M::CmdSP cmd = std::make_shared<dp::undo::test::ValueCmd<State>>(0);
+    expect(at(mgr, 0, false, false), "empty");
+    fill(mgr, 0, 5);
+    expect(at(mgr, 5, true, false), "invoke");
+
+    mgr.undo(cmd);
+    mgr.undo(cmd);
+    expect(at(mgr, 3, true, true) && (*mgr.focused_item())().value == 3, "undo");
+    mgr.redo(cmd);
+    expect(at(mgr, 4, true, true), "redo");
+    mgr.undo_to(0);
+    expect(at(mgr, 0, false, true) && (*mgr.focused_item())().value == 0, "undo_to() the oldest one");
+    mgr.redo_to(5);
+    expect(at(mgr, 5, true, false), "redo_to() the newest one");
+
+    // erase() at the cursor: the entries after it stay
+    mgr.undo_to(3);
+    mgr.erase();
+    expect(mgr.size() == 4 && at(mgr, 3, true, true) && (*mgr.focused_item())().value == 4, "erase() one");
+    mgr.erase(5);
+    expect(mgr.size() == 3 && at(mgr, 3, true, false), "erase() the redo tail");
+    mgr.undo_to(0);
+    mgr.erase(3);
+    expect(mgr.empty() && at(mgr, 0, false, false), "erase() all");
+
+    // max_size(): the oldest ones are evicted on invoke
+    fill(mgr, 0, 3);
+    mgr.max_size(3);
+    fill(mgr, 3, 6);
+    expect(mgr.size() == 3 && at(mgr, 3, true, false) && (*mgr.newest_item())().value == 5, "max_size()");
+    mgr.undo(cmd);
+    fill(mgr, 6, 8);
+    expect(mgr.size() == 3 && at(mgr, 3, true, false) && (*mgr.newest_item())().value == 7, "max_size() after a branch");
+    mgr.undo_to(1);
+    mgr.max_size(SIZE_T_MAX);
+
+    // max_bytes(): the oldest ones are evicted, before the cursor too
+    auto one = mgr.memory_usage() / mgr.size();
+    mgr.max_bytes(one * 2);
+    expect(mgr.size() == 2 && at(mgr, 0, false, true) && (*mgr.focused_item())().value == 6, "max_bytes() passes the cursor");
+    mgr.redo(cmd);
+    mgr.max_bytes(one);
+    expect(mgr.size() == 1 && at(mgr, 0, false, true) && (*mgr.focused_item())().value == 7, "max_bytes() evicts the one undone to");
+    mgr.redo(cmd);
+    expect(at(mgr, 1, true, false), "redo after the eviction");
+    mgr.max_bytes(SIZE_T_MAX);
+    fill(mgr, 8, 10);
+    expect(mgr.size() == 3 && at(mgr, 3, true, false), "invoke after the eviction");
+
+    mgr.clear();
+    expect(mgr.empty() && at(mgr, 0, false, false), "clear()");
+  }
+} // namespace
+
+int main() {
+  test_cursor<dp::undo::test::list_state>();
+  test_cursor<dp::undo::test::ring_state>();
+  return failed;
+}
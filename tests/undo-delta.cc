@@ -0,0 +1,115 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/5.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  // replace [at, at+erase) with insert
+  struct edit_t {
+    std::size_t at{};
+    std::size_t erase{};
+    std::string insert{};
+
+    void apply(std::string &doc) const { doc.replace(at, erase, insert); }
+    friend std::ostream &operator<<(std::ostream &os, edit_t const &o) {
+      return os << '@' << o.at << " -" << o.erase << " +'" << o.insert << '\'';
+    }
+  };
+
+  using delta_state = undo_cxx::delta_state_t<std::string, edit_t>;
+
+  static std::string document;
+
+  template<typename State>
+  class AppendCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~AppendCmd() {}
+    AppendCmd() {}
+    AppendCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(AppendCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      _delta.forward = {document.size(), 0, _text};
+      _delta.backward = {document.size(), _text.size(), {}};
+      document += _text;
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &ctx) override {
+      State s{_delta};
+      if (ctx.mgr.keyframe_due())
+        s.keyframe = document;
+      return std::make_unique<Memento>(sender, s);
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+    State _delta{};
+  };
+
+}}} // namespace dp::undo::test
+
+namespace {
+  static void test_delta() {
+    using namespace dp::undo::test;
+    using State = delta_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using AppendCmdT = AppendCmd<State>;
+    static_assert(undo_cxx::is_delta_state_v<State>);
+
+    document.clear();
+    M mgr;
+    mgr.keyframe_interval(4);
+    std::string const expected{"abcdefghij"};
+    for (auto c : expected)
+      mgr.invoke<AppendCmdT>(std::string(1, c));
+
+    int keyframes = 0;
+    for (auto it = mgr.oldest_iterator(); it != mgr.newest_iterator(); ++it)
+      keyframes += (**it)().is_keyframe() ? 1 : 0;
+    expect(keyframes == 3, "a keyframe per 4 mementos");
+
+    for (std::size_t pos = 0; pos <= mgr.size(); pos++)
+      expect(mgr.materialize(pos) == expected.substr(0, pos), "materialize() at every position");
+    expect(!mgr.materialize(11), "materialize() out of range");
+
+    // undo 3 steps and branch off: the redo tail is discarded
+    mgr.undo_to(7);
+    document = *mgr.materialize(mgr.position());
+    expect(document == "abcdefg", "the document at the cursor");
+    mgr.invoke<AppendCmdT>("X");
+    expect(mgr.materialize(mgr.position()) == "abcdefgX", "branch off");
+    expect(!(*mgr.newest_item())().is_keyframe(), "no keyframe within the interval");
+    expect(mgr.keyframe_due(), "a keyframe per 4 mementos, again");
+
+    // evicting the oldest keyframe promotes the next memento
+    mgr.max_size(8);
+    for (auto const *t : {"Y", "Z"})
+      mgr.invoke<AppendCmdT>(t);
+    expect(mgr.size() == 8, "the history is bounded");
+    expect((**mgr.oldest_iterator())().is_keyframe(), "the oldest one is a keyframe");
+    expect(mgr.materialize(0) == "ab", "the oldest document");
+    expect(mgr.materialize(8) == "abcdefgXYZ", "the newest document");
+  }
+} // namespace
+
+int main() {
+  test_delta();
+  return failed;
+}
@@ -0,0 +1,233 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t n) {
+  allocations++;
+  if (auto *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace dp { namespace undo { namespace test {
+
+  struct char_state {
+    char ch;
+    friend std::ostream &operator<<(std::ostream &os, char_state const &o) { return os << o.ch; }
+  };
+
+  // appends a char to the text, '!' throws, and '#' throws on undo
+  template<typename State>
+  class AppendCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~AppendCmd() {}
+    AppendCmd(std::string *text, char ch)
+        : _text(text)
+        , _ch(ch) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(AppendCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      if (_ch == '!')
+        throw std::runtime_error("!");
+      _text->push_back(_ch);
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_ch});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {
+      if (_ch == '#')
+        throw std::runtime_error("#");
+      _text->pop_back();
+    }
+    void redo_impl(CmdSP &, ContextT &, Memento &memento) override { _text->push_back(memento().ch); }
+
+  private:
+    std::string *_text;
+    char _ch;
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::char_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+  static constexpr bool memento_arena = true;
+  static constexpr bool groups = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = char_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using Append = AppendCmd<State>;
+  using Composite = undo_cxx::composite_cmd_t<State>;
+
+  static void type(M &mgr, std::string &text, char const *s) {
+    for (; *s; s++)
+      mgr.invoke<Append>(&text, *s);
+  }
+
+  static void test_commit() {
+    M mgr;
+    std::string text;
+    type(mgr, text, "a");
+    {
+      auto tx = mgr.begin_group("bcd");
+      type(mgr, text, "bcd");
+      expect(text == "abcd" && mgr.size() == 1 && mgr.in_group(), "executed at once, recorded later");
+    }
+    expect(mgr.size() == 2 && !mgr.in_group(), "one entry");
+    auto &memento = *mgr.newest_item();
+    auto *group = dynamic_cast<M::GroupCmd *>(memento.command().get());
+    expect(group && group->name() == "bcd" && group->size() == 3 && memento.size() == 4, "a group of three");
+    std::string slots;
+    memento.for_each_children([&](M::Memento::Pair &p) { slots.push_back(p.second.ch); });
+    expect(slots == "bcd", "the states in order");
+
+    M::ContextT ctx{mgr};
+    memento.command()->undo(memento.command(), ctx, memento);
+    expect(text == "a", "undone as one");
+    memento.command()->redo(memento.command(), ctx, memento);
+    expect(text == "abcd", "redone as one");
+
+    {
+      auto tx = mgr.begin_group("empty");
+    }
+    expect(mgr.size() == 2, "an empty group records nothing");
+  }
+
+  static void test_rollback() {
+    M mgr;
+    std::string text;
+    try {
+      auto tx = mgr.begin_group("failing");
+      type(mgr, text, "xy!");
+    } catch (std::runtime_error const &) {
+    }
+    expect(text.empty() && mgr.empty() && !mgr.in_group(), "rolled back on an exception");
+
+    {
+      auto outer = mgr.begin_group("outer");
+      type(mgr, text, "ab");
+      try {
+        auto inner = mgr.begin_group("inner");
+        type(mgr, text, "cd!");
+      } catch (std::runtime_error const &) {
+      }
+      expect(text == "ab" && mgr.in_group(), "the inner one only");
+      {
+        auto inner = mgr.begin_group("joined");
+        type(mgr, text, "e");
+      }
+      auto also = mgr.begin_group();
+      type(mgr, text, "f");
+      also.rollback();
+      expect(!also.active() && text == "abe", "an explicit rollback");
+    }
+    expect(mgr.size() == 1 && mgr.newest_item()->size() == 4, "the outer one, with the inner ones joined");
+  }
+
+  static void test_composite() {
+    M mgr;
+    std::string text;
+    auto composite = [&text](char const *s) {
+      auto c = std::make_shared<Composite>();
+      for (; *s; s++)
+        c->add_command(std::make_shared<Append>(&text, *s));
+      return M::CmdSP{c};
+    };
+    {
+      auto tx = mgr.begin_group("composite");
+      type(mgr, text, "a");
+      auto cmd = composite("bc");
+      mgr.invoke(cmd);
+    }
+    auto &memento = *mgr.newest_item();
+    expect(text == "abc" && memento.size() == 4, "the states of the composite are spliced in");
+    M::ContextT ctx{mgr};
+    memento.command()->undo(memento.command(), ctx, memento);
+    expect(text.empty(), "the composite is undone with the group");
+    memento.command()->redo(memento.command(), ctx, memento);
+    expect(text == "abc", "and redone");
+
+    try {
+      auto tx = mgr.begin_group("failing");
+      auto cmd = composite("de");
+      mgr.invoke(cmd);
+      type(mgr, text, "!");
+    } catch (std::runtime_error const &) {
+    }
+    expect(text == "abc" && mgr.size() == 1, "the composite is rolled back");
+  }
+
+  static void test_throwing_undo() {
+    M mgr;
+    std::string text;
+    try {
+      auto tx = mgr.begin_group("failing");
+      type(mgr, text, "a#b!");
+    } catch (std::runtime_error const &e) {
+      expect(std::string{e.what()} == "!", "the original exception");
+    }
+    expect(!mgr.in_group() && mgr.empty(), "closed, though an undo hook threw while unwinding");
+
+    auto tx = mgr.begin_group("explicit");
+    type(mgr, text, "#");
+    bool thrown = false;
+    try {
+      tx.rollback();
+    } catch (std::runtime_error const &) {
+      thrown = true;
+    }
+    expect(thrown && !tx.active() && !mgr.in_group(), "an explicit rollback reports it");
+  }
+
+  static void test_allocations() {
+    M mgr;
+    std::string text;
+    text.reserve(4096);
+    constexpr std::size_t n = 1000;
+    auto before = allocations;
+    type(mgr, text, std::string(n, 'x').c_str());
+    auto plain = allocations - before;
+
+    before = allocations;
+    {
+      auto tx = mgr.begin_group("x");
+      type(mgr, text, std::string(n, 'x').c_str());
+    }
+    auto grouped = allocations - before;
+    expect(grouped < n + 100 && plain >= 2 * n, "a command in a group costs itself only");
+  }
+} // namespace
+
+int main() {
+  test_commit();
+  test_rollback();
+  test_composite();
+  test_throwing_undo();
+  test_allocations();
+  return failed;
+}
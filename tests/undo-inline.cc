@@ -0,0 +1,186 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t n) {
+  allocations++;
+  if (auto *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace dp { namespace undo { namespace test {
+
+  struct doc_t {
+    std::string text;
+  };
+  struct char_state {
+    char before;
+  };
+
+  // overwrites one char
+  struct PutCmd {
+    doc_t *doc;
+    std::size_t pos;
+    char ch;
+
+    template<typename C>
+    void execute(C &ctx) {
+      before = doc->text[pos];
+      redo(ctx, *this);
+    }
+    template<typename C>
+    char_state save_state(C &) const { return {before}; }
+    template<typename C>
+    void undo(C &, char_state &s) { doc->text[pos] = s.before; }
+    template<typename C, typename S>
+    void redo(C &, S &) { doc->text[pos] = ch; }
+
+    char before{};
+  };
+
+  // too big for the buffer
+  struct FillCmd {
+    doc_t *doc;
+    std::array<char, 128> pattern;
+    std::string saved{};
+
+    template<typename C>
+    void execute(C &) {
+      saved = doc->text;
+      for (std::size_t i = 0; i < doc->text.size(); i++)
+        doc->text[i] = pattern[i % pattern.size()];
+    }
+    template<typename C>
+    char_state save_state(C &) const { return {}; }
+    template<typename C>
+    void undo(C &, char_state &) { std::swap(doc->text, saved); }
+    template<typename C>
+    void redo(C &, char_state &) { std::swap(doc->text, saved); }
+  };
+
+  struct FailCmd {
+    template<typename C>
+    void execute(C &) { throw std::runtime_error("failed"); }
+    template<typename C>
+    char_state save_state(C &) const { return {}; }
+    template<typename C>
+    void undo(C &, char_state &) {}
+    template<typename C>
+    void redo(C &, char_state &) {}
+  };
+
+}}} // namespace dp::undo::test
+
+namespace {
+  using namespace dp::undo::test;
+  using M = undo_cxx::inline_cmd_system_t<char_state, 32>;
+
+  static void test_inline() {
+    static_assert(M::fits<PutCmd> && !M::fits<FillCmd>);
+    M mgr;
+    doc_t doc{"abc"};
+    mgr.invoke<PutCmd>(&doc, 0u, 'x');
+    mgr.invoke<PutCmd>(&doc, 1u, 'y');
+    expect(doc.text == "xyc" && mgr.size() == 2, "executed");
+    expect(mgr.at(0).is_inline() && mgr.at(0).state.before == 'a', "inline, with its memento");
+    expect(mgr.at(1).command<PutCmd>()->pos == 1 && !mgr.at(1).command<FillCmd>(), "the command by its type");
+
+    std::array<char, 128> dash{};
+    dash.fill('-');
+    mgr.invoke<FillCmd>(&doc, dash);
+    auto c = mgr.counters();
+    expect(doc.text == "---" && !mgr.at(2).is_inline() && c.spilled == 1, "a big one is on the heap");
+    expect(c.bytes == mgr.counters().bytes && c.bytes >= sizeof(FillCmd), "its bytes are counted");
+
+    expect(mgr.undo() && doc.text == "xyc", "undo the big one");
+    expect(mgr.undo_to(0) == 2 && doc.text == "abc", "undo the small ones");
+    expect(mgr.redo_to(3) == 3 && doc.text == "---", "redo them");
+
+    mgr.undo_to(1);
+    mgr.invoke<PutCmd>(&doc, 2u, 'z');
+    expect(doc.text == "xbz" && mgr.size() == 2 && mgr.counters().spilled == 0, "the redo tail is discarded");
+
+    try {
+      mgr.invoke<FailCmd>();
+    } catch (std::runtime_error const &) {
+    }
+    expect(mgr.size() == 2 && mgr.position() == 2, "a throwing command isn't recorded");
+  }
+
+  static void test_throwing_keeps_history() {
+    M mgr;
+    mgr.max_size(2);
+    doc_t doc{"abc"};
+    mgr.invoke<PutCmd>(&doc, 0u, 'x');
+    mgr.invoke<PutCmd>(&doc, 1u, 'y');
+    try {
+      mgr.invoke<FailCmd>();
+    } catch (std::runtime_error const &) {
+    }
+    expect(mgr.size() == 2 && mgr.at(0).state.before == 'a', "the oldest entry of a full history isn't evicted");
+
+    mgr.undo();
+    try {
+      mgr.invoke<FailCmd>();
+    } catch (std::runtime_error const &) {
+    }
+    expect(mgr.size() == 2 && mgr.position() == 1 && mgr.can_redo(), "the redo tail isn't discarded");
+    expect(mgr.redo() && doc.text == "xyc", "and it can be redone");
+  }
+
+  static void test_no_allocation() {
+    M mgr;
+    mgr.max_size(64);
+    doc_t doc{"abcdefgh"};
+    for (int i = 0; i < 64; i++)
+      mgr.invoke<PutCmd>(&doc, (std::size_t) (i % 8), (char) ('a' + i % 26));
+    auto before = allocations;
+    for (int i = 0; i < 1000; i++) {
+      mgr.invoke<PutCmd>(&doc, (std::size_t) (i % 8), (char) ('a' + i % 26));
+      if (i % 3 == 0) {
+        mgr.undo();
+        mgr.redo();
+      }
+    }
+    expect(allocations == before, "a small edit allocates nothing");
+    expect(mgr.size() == 64 && mgr.position() == 64, "bounded");
+
+    std::array<char, 128> dash{};
+    mgr.invoke<FillCmd>(&doc, dash);
+    mgr.max_size(1);
+    expect(mgr.size() == 1 && mgr.counters().spilled == 1, "the big one is the newest");
+    mgr.invoke<PutCmd>(&doc, 0u, 'q');
+    expect(mgr.counters().spilled == 0, "evicted");
+    mgr.clear();
+    expect(mgr.empty() && mgr.counters().entries == 0, "cleared");
+  }
+} // namespace
+
+int main() {
+  test_inline();
+  test_throwing_keeps_history();
+  test_no_allocation();
+  return failed;
+}
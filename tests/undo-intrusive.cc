@@ -0,0 +1,174 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/8.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  using st_base = undo_cxx::intrusive_base_cmd_t<undo_cxx::single_thread_ref_count_t>;
+  using mt_base = undo_cxx::intrusive_base_cmd_t<undo_cxx::multi_thread_ref_count_t>;
+
+  static int alive = 0;
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State, st_base> {
+  public:
+    ~TextCmd() { alive--; }
+    TextCmd() { alive++; }
+    TextCmd(std::string const &text)
+        : _text(text) { alive++; }
+    UNDO_CXX_DEFINE_BASED_CMD_TYPES(TextCmd, undo_cxx::cmd_t, st_base);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+  template<typename State>
+  class AtomicTextCmd : public undo_cxx::cmd_t<State, mt_base> {
+  public:
+    AtomicTextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_BASED_CMD_TYPES(AtomicTextCmd, undo_cxx::cmd_t, mt_base);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+  template<typename State>
+  class UndoCmd : public undo_cxx::base_undo_cmd_t<State, mt_base> {
+  public:
+    using undo_cxx::base_undo_cmd_t<State, mt_base>::base_undo_cmd_t;
+    UNDO_CXX_DEFINE_BASED_CMD_TYPES(UndoCmd, undo_cxx::base_undo_cmd_t, mt_base);
+
+  protected:
+    MementoPtr save_state_impl(CmdSP &, ContextT &) override { return {}; }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+  };
+
+  template<typename State>
+  class RedoCmd : public undo_cxx::base_redo_cmd_t<State, mt_base> {
+  public:
+    using undo_cxx::base_redo_cmd_t<State, mt_base>::base_redo_cmd_t;
+    UNDO_CXX_DEFINE_BASED_CMD_TYPES(RedoCmd, undo_cxx::base_redo_cmd_t, mt_base);
+
+  protected:
+    MementoPtr save_state_impl(CmdSP &, ContextT &) override { return {}; }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+  };
+
+}}} // namespace dp::undo::test
+
+namespace {
+  static void test_intrusive_ptr() {
+    using namespace dp::undo::test;
+    using P = undo_cxx::intrusive_ptr<TextCmd<std::string>>;
+    static_assert(sizeof(P) == sizeof(void *));
+
+    {
+      P a = undo_cxx::make_intrusive<TextCmd<std::string>>("a");
+      expect(alive == 1 && a->use_count() == 1, "make_intrusive");
+      P b{a};
+      expect(a->use_count() == 2 && a == b, "copy");
+      P c{std::move(b)};
+      expect(a->use_count() == 2 && !b && b == nullptr, "move");
+      undo_cxx::intrusive_ptr<st_base> base{c};
+      expect(a->use_count() == 3, "convert to the base");
+      c.reset();
+      base.reset();
+      expect(a->use_count() == 1 && alive == 1, "reset");
+    }
+    expect(alive == 0, "the last reference deletes the command");
+  }
+
+  static void test_intrusive_history() {
+    using namespace dp::undo::test;
+    using State = std::string;
+    using M = undo_cxx::intrusive_cmd_system_t<State, undo_cxx::single_thread_ref_count_t>;
+    using TextCmdT = TextCmd<State>;
+    static_assert(std::is_same_v<M::CmdSP, undo_cxx::intrusive_ptr<undo_cxx::cmd_t<State, st_base>>>);
+    static_assert(std::is_same_v<TextCmdT::CmdSP, M::CmdSP>);
+
+    {
+      M mgr;
+      for (auto const *t : {"a", "b", "c", "d"})
+        mgr.invoke<TextCmdT>(t);
+      expect(mgr.size() == 4 && alive == 4, "the history holds the commands");
+      expect(mgr.newest_item()->command()->use_count() == 1, "one reference per memento");
+
+      M::CmdSP undo_cmd{undo_cxx::make_intrusive<TextCmdT>("undo")};
+      mgr.undo(undo_cmd, 2);
+      expect(mgr.position() == 2 && (*mgr.focused_item())() == "c", "undo twice");
+      mgr.redo(undo_cmd);
+      expect(mgr.position() == 3 && (*mgr.focused_item())() == "d", "redo");
+
+      mgr.invoke<TextCmdT>("e");
+      expect(mgr.size() == 4 && alive == 5, "the redo branch is released");
+      mgr.clear();
+      expect(alive == 1, "clear releases the commands");
+    }
+    expect(alive == 0, "no leaks");
+  }
+
+  static void test_atomic_history() {
+    using namespace dp::undo::test;
+    using State = std::string;
+    using M = undo_cxx::intrusive_cmd_system_t<State>;
+    using UndoCmdT = UndoCmd<State>;
+    using RedoCmdT = RedoCmd<State>;
+    using CompositeCmdT = undo_cxx::composite_cmd_t<State, mt_base>;
+
+    M mgr;
+    for (auto const *t : {"a", "b", "c"})
+      mgr.invoke<AtomicTextCmd<State>>(t);
+
+    auto group = undo_cxx::make_intrusive<CompositeCmdT>();
+    group->add_command(undo_cxx::make_intrusive<AtomicTextCmd<State>>("d"));
+    group->add_command(undo_cxx::make_intrusive<AtomicTextCmd<State>>("e"));
+    M::CmdSP sp{group};
+    mgr.invoke(sp);
+    expect(mgr.size() == 4, "a composite command is one entry");
+
+    mgr.invoke<UndoCmdT>(2);
+    expect(mgr.position() == 2, "the undo command");
+    mgr.invoke<RedoCmdT>();
+    expect(mgr.position() == 3, "the redo command");
+  }
+} // namespace
+
+int main() {
+  test_intrusive_ptr();
+  test_intrusive_history();
+  test_atomic_history();
+  return failed;
+}
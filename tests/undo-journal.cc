@@ -0,0 +1,232 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/11.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  // the footprint of a journal_state per char, it may differ between
+  // the sessions like a capacity()
+  static std::size_t bytes_per_char = 1;
+
+  // a state with its own serializer
+  struct journal_state {
+    std::string text;
+
+    std::size_t memory_usage() const { return text.size() * bytes_per_char; }
+
+    void serialize(std::string &out) const { out += text; }
+    bool deserialize(std::string_view in) {
+      text.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, journal_state const &o) { return os << o.text; }
+  };
+
+  // trivially copyable, the second one opts in to be journaled by memcpy
+  struct pod_state {
+    int a;
+    int b;
+  };
+  struct opted_state {
+    std::int32_t a;
+    std::int32_t b;
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::is_journal_pod<dp::undo::test::opted_state> : std::true_type {};
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::journal_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+  static constexpr bool journal = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = journal_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using J = undo_cxx::journal_t<State>;
+
+  static std::string join(M &mgr) {
+    std::string s;
+    for (auto it = mgr.oldest_iterator(); it != mgr.newest_iterator(); ++it)
+      s += (**it)().text;
+    return s;
+  }
+
+  static void test_journal(std::filesystem::path const &path) {
+    {
+      J j{path, undo_cxx::journal_options_t{64, false}};
+      M mgr;
+      mgr.journal(&j);
+      for (auto const *t : {"a", "b", "c", "d", "e"})
+        mgr.invoke<TextCmd<State>>(t);
+      mgr.undo_to(3);
+      mgr.invoke<TextCmd<State>>("f"); // drops d, e
+      M::CmdSP cmd = std::make_shared<TextCmd<State>>("undo");
+      mgr.undo(cmd);
+      mgr.undo(cmd);
+      mgr.redo(cmd);
+      expect(join(mgr) == "abcf" && mgr.position() == 3, "the session");
+      expect(j.records() == 10, "one record per change");
+    } // crash-free exit: committed on close
+
+    J j{path};
+    M mgr;
+    expect(mgr.replay(j) == 10, "every record is replayed");
+    expect(join(mgr) == "abcf" && mgr.position() == 3, "the history is rebuilt");
+    expect((*mgr.focused_item())().text == "f" && !mgr.focused_item()->command(), "the states without the commands");
+
+    // continue the session
+    mgr.journal(&j);
+    mgr.erase();
+    mgr.max_size(2);
+    mgr.invoke<TextCmd<State>>("g");
+    expect(join(mgr) == "bcg", "the continued session");
+    j.commit();
+
+    M again;
+    again.replay(j);
+    expect(join(again) == "bcg" && again.position() == 3, "the limits and erase() are replayed");
+  }
+
+  static void test_evictions(std::filesystem::path const &path) {
+    std::filesystem::remove(path);
+    {
+      J j{path};
+      M mgr;
+      mgr.journal(&j);
+      mgr.invoke<TextCmd<State>>("a");
+      mgr.max_bytes(3 * mgr.newest_item()->memory_usage());
+      for (auto const *t : {"b", "c", "d", "e"})
+        mgr.invoke<TextCmd<State>>(t);
+      expect(join(mgr) == "cde", "evicted by the budget");
+      mgr.undo_to(1);
+    }
+
+    bytes_per_char = 100; // the states are bigger now
+    J j{path};
+    M mgr;
+    mgr.replay(j);
+    bytes_per_char = 1;
+    expect(join(mgr) == "cde" && mgr.position() == 1, "the evictions are replayed as journaled");
+  }
+
+  static void test_torn_tail(std::filesystem::path const &path) {
+    std::filesystem::remove(path);
+    {
+      J j{path};
+      M mgr;
+      mgr.journal(&j);
+      for (auto const *t : {"a", "b", "c"})
+        mgr.invoke<TextCmd<State>>(t);
+    }
+    auto good = std::filesystem::file_size(path);
+    {
+      // a record which was being written when it crashed
+      std::ofstream os(path, std::ios::binary | std::ios::app);
+      os.write("\x40\x00\x00\x00\x12\x34", 6);
+    }
+
+    J j{path};
+    M mgr;
+    expect(mgr.replay(j) == 3 && join(mgr) == "abc", "the valid records are replayed");
+    expect(std::filesystem::file_size(path) == good, "the torn tail is cut off");
+
+    {
+      // flip a byte in the payload of the last record
+      std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+      fs.seekp((std::streamoff) good - 1);
+      fs.put('x');
+    }
+    M corrupted;
+    expect(corrupted.replay(j) == 2 && join(corrupted) == "ab", "a corrupted record is detected by the checksum");
+  }
+
+  static void test_write_errors() {
+#if defined(__linux__)
+    // every write to /dev/full fails with ENOSPC
+    bool thrown = false;
+    {
+      J j{"/dev/full"};
+      M mgr;
+      mgr.journal(&j);
+      mgr.invoke<TextCmd<State>>("a");
+      try {
+        j.commit();
+      } catch (std::runtime_error const &) {
+        thrown = true;
+      }
+      mgr.invoke<TextCmd<State>>("b");
+    } // the destructor swallows the error
+    expect(thrown, "commit() reports a failed write");
+#endif
+  }
+
+  static void test_serializers() {
+    std::string out;
+    undo_cxx::state_serializer_t<double>::write(out, 1.5);
+    double d{};
+    expect(out.size() == sizeof(double) && undo_cxx::state_serializer_t<double>::read(out, d) && d == 1.5, "an arithmetic type");
+    static_assert(!undo_cxx::is_serializable_v<pod_state>, "a trivially copyable State isn't journaled by default");
+    static_assert(undo_cxx::is_spillable_v<pod_state>, "but it can be spilled");
+    out.clear();
+    undo_cxx::state_serializer_t<opted_state>::write(out, opted_state{1, 2});
+    opted_state o{};
+    expect(undo_cxx::state_serializer_t<opted_state>::read(out, o) && o.a == 1 && o.b == 2, "a State opted in by is_journal_pod");
+    std::string s;
+    expect(undo_cxx::state_serializer_t<std::string>::read("abc", s) && s == "abc", "std::string");
+  }
+} // namespace
+
+int main() {
+  auto path = std::filesystem::temp_directory_path() / "undo-cxx-test.journal";
+  std::filesystem::remove(path);
+  test_journal(path);
+  test_evictions(path);
+  test_torn_tail(path);
+  test_write_errors();
+  test_serializers();
+  std::filesystem::remove(path);
+  return failed;
+}
@@ -0,0 +1,105 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/4.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  struct jump_state {
+    std::string text;
+    friend std::ostream &operator<<(std::ostream &os, jump_state const &o) { return os << o.text; }
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::jump_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<8>;
+};
+
+namespace {
+  template<typename Range>
+  static std::string join(Range const &r) {
+    std::string s;
+    for (auto const &m : r)
+      s += (*m)().text;
+    return s;
+  }
+
+  static void test_jump() {
+    using namespace dp::undo::test;
+    using State = jump_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using TextCmdT = TextCmd<State>;
+
+    M mgr;
+    for (auto const *t : {"a", "b", "c", "d", "e", "f"})
+      mgr.invoke<TextCmdT>(t);
+    auto events = mgr.tracer().count();
+
+    auto r = mgr.undo_to(2);
+    expect(mgr.position() == 2, "undo_to() moves the cursor");
+    expect(r.size() == 4 && join(r) == "cdef", "undo_to() returns the undone mementos");
+    expect((*mgr.focused_item())().text == "c", "focused item after undo_to()");
+    expect(mgr.tracer().count() == events + 1, "one trace event for the whole jump");
+
+    expect(mgr.undo_to(3).empty() && mgr.position() == 2, "undo_to() can't go forward");
+
+    r = mgr.redo_to(5);
+    expect(mgr.position() == 5, "redo_to() moves the cursor");
+    expect(r.size() == 3 && join(r) == "cde", "redo_to() returns the redone mementos");
+    expect(mgr.redo_to(7).empty() && mgr.position() == 5, "redo_to() can't go beyond the newest");
+
+    r = mgr.undo_to(0);
+    expect(mgr.position() == 0 && !mgr.can_undo(), "undo_to(0) reverts everything");
+    expect(join(r) == "abcde", "undo_to(0) range");
+
+    M::CmdSP cmd = std::make_shared<TextCmdT>("undo");
+    mgr.redo(cmd, 6);
+    expect(mgr.position() == 6 && !mgr.can_redo(), "redo(cmd, delta) to the newest");
+    mgr.undo(cmd, 6);
+    expect(mgr.position() == 0, "undo(cmd, delta) to the oldest");
+    mgr.undo(cmd, 1);
+    mgr.redo(cmd, 7);
+    expect(mgr.position() == 0, "out of range deltas are ignored");
+  }
+} // namespace
+
+int main() {
+  test_jump();
+  return failed;
+}
@@ -0,0 +1,185 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/13.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace dp { namespace undo { namespace test {
+
+  struct merge_state {
+    std::string text;
+
+    void serialize(std::string &out) const { out += text; }
+    bool deserialize(std::string_view in) {
+      text.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, merge_state const &o) { return os << o.text; }
+  };
+
+  // a keystroke, the consecutive ones of a word are merged
+  template<typename State>
+  class TypeCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TypeCmd() {}
+    TypeCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TypeCmd, undo_cxx::cmd_t);
+
+    bool merge_with(TypeCmd const &next) {
+      if (next._text == " ")
+        return false;
+      _text += next._text;
+      return true;
+    }
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  protected:
+    std::string _text{};
+  };
+
+  // a keystroke in the overwrite mode
+  template<typename State>
+  class OverwriteCmd : public TypeCmd<State> {
+  public:
+    using TypeCmd<State>::TypeCmd;
+  };
+
+  // no merge_with()
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::merge_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+  static constexpr bool journal = true;
+  static constexpr bool merge = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = merge_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+
+  static std::string join(M &mgr) {
+    std::string s;
+    for (auto it = mgr.oldest_iterator(); it != mgr.newest_iterator(); ++it)
+      s += (**it)().text + "|";
+    return s;
+  }
+
+  static void type(M &mgr, std::string const &keys) {
+    for (char c : keys)
+      mgr.invoke<TypeCmd<State>>(std::string(1, c));
+  }
+
+  static void test_merge() {
+    M mgr;
+    type(mgr, "hello");
+    expect(mgr.size() == 1 && join(mgr) == "hello|", "the keystrokes are merged");
+    expect(mgr.tracer()[mgr.tracer().size() - 1].event == undo_cxx::trace::event_t::merge, "traced as merge");
+    type(mgr, " world");
+    expect(join(mgr) == "hello| world|", "merge_with() refuses the space");
+
+    mgr.seal();
+    type(mgr, "!");
+    mgr.invoke<TextCmd<State>>("x");
+    type(mgr, "ab");
+    expect(join(mgr) == "hello| world|!|x|ab|", "seal() and the other commands end a merge");
+
+    M::CmdSP cmd = std::make_shared<TextCmd<State>>("undo");
+    mgr.undo(cmd);
+    mgr.redo(cmd);
+    type(mgr, "c");
+    expect(join(mgr) == "hello| world|!|x|ab|c|", "undo/redo ends a merge");
+    mgr.undo(cmd);
+    type(mgr, "d");
+    expect(join(mgr) == "hello| world|!|x|ab|d|", "no merge into the redo branch");
+
+    mgr.clear();
+    type(mgr, "ab");
+    mgr.invoke<OverwriteCmd<State>>("c");
+    expect(join(mgr) == "ab|c|", "the other types aren't merged");
+    mgr.merge_same_id(false);
+    mgr.invoke<OverwriteCmd<State>>("d");
+    expect(join(mgr) == "ab|cd|", "the subclasses may be merged");
+    type(mgr, "e");
+    expect(join(mgr) == "ab|cde|", "a TypeCmd merges into an OverwriteCmd");
+
+    mgr.clear();
+    mgr.merge_window(std::chrono::milliseconds{0});
+    type(mgr, "ab");
+    expect(join(mgr) == "a|b|", "merging is off");
+    mgr.merge_window(std::chrono::milliseconds{1});
+    mgr.seal();
+    type(mgr, "c");
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    type(mgr, "d");
+    expect(join(mgr) == "a|b|c|d|", "out of the window");
+  }
+
+  static void test_journal() {
+    auto path = std::filesystem::temp_directory_path() / "undo-cxx-merge.journal";
+    std::filesystem::remove(path);
+    {
+      undo_cxx::journal_t<State> j{path};
+      M mgr;
+      mgr.journal(&j);
+      type(mgr, "hello world");
+    }
+    undo_cxx::journal_t<State> j{path};
+    M mgr;
+    mgr.replay(j);
+    expect(join(mgr) == "hello| world|" && mgr.position() == 2, "the merges are replayed");
+    type(mgr, "s");
+    expect(join(mgr) == "hello| world|s|", "the replayed mementos have no command to merge into");
+    std::filesystem::remove(path);
+  }
+} // namespace
+
+int main() {
+  test_merge();
+  test_journal();
+  return failed;
+}
@@ -0,0 +1,166 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/9.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace dp { namespace undo { namespace test {
+
+  struct mpsc_state {
+    int producer;
+    int seq;
+    friend std::ostream &operator<<(std::ostream &os, mpsc_state const &o) { return os << o.producer << '.' << o.seq; }
+  };
+
+  template<typename State>
+  class SeqCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~SeqCmd() {}
+    SeqCmd(int producer, int seq)
+        : _producer(producer)
+        , _seq(seq) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(SeqCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      if (_seq < 0)
+        throw std::runtime_error("bad command");
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_producer, _seq});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    int _producer{};
+    int _seq{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::mpsc_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+};
+
+namespace {
+  static void test_mpsc_queue() {
+    undo_cxx::util::mpsc_queue_t<int> q;
+    int v{};
+    expect(q.empty() && !q.pop(v), "empty queue");
+    for (int i = 0; i < 5; i++)
+      q.push(i);
+    expect(!q.empty(), "not empty");
+    bool ordered = true;
+    for (int i = 0; i < 5; i++)
+      ordered = ordered && q.pop(v) && v == i;
+    expect(ordered, "fifo");
+    expect(q.empty() && !q.pop(v), "drained");
+    q.push(9);
+    expect(q.pop(v) && v == 9, "reuse after drained");
+
+    constexpr int producers = 4, n = 10000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+      threads.emplace_back([&q, p] {
+        for (int i = 0; i < n; i++)
+          q.push(p * n + i);
+      });
+    std::vector<int> last(producers, -1);
+    int got = 0;
+    bool in_order = true;
+    while (got < producers * n) {
+      if (q.pop(v)) {
+        in_order = in_order && v % n > last[(std::size_t) (v / n)];
+        last[(std::size_t) (v / n)] = v % n;
+        got++;
+      }
+    }
+    for (auto &t : threads)
+      t.join();
+    expect(in_order, "fifo per producer");
+    expect(q.empty(), "every element is popped");
+  }
+
+  static void test_cmd_queue() {
+    using namespace dp::undo::test;
+    using State = mpsc_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using SeqCmdT = SeqCmd<State>;
+
+    constexpr int producers = 4, n = 500;
+    M mgr;
+    {
+      undo_cxx::cmd_queue_t<M> q{mgr};
+      std::vector<std::thread> threads;
+      for (int p = 0; p < producers; p++)
+        threads.emplace_back([&q, p, n] {
+          for (int i = 0; i < n; i++) {
+            if (i % 2)
+              q.post(std::make_shared<SeqCmdT>(p, i));
+            else
+              q.submit<SeqCmdT>(p, i);
+          }
+          q.submit<SeqCmdT>(p, n).wait();
+        });
+      for (auto &t : threads)
+        t.join();
+      expect(q.applied() == producers * (n + 1), "a waited command and its predecessors are applied");
+
+      auto bad = q.submit<SeqCmdT>(0, -1);
+      bool thrown = false;
+      try {
+        bad.get();
+      } catch (std::runtime_error const &) {
+        thrown = true;
+      }
+      expect(thrown, "the exception is delivered to the producer");
+    }
+    expect(mgr.size() == producers * (n + 1), "every command is saved");
+
+    std::vector<int> last(producers, -1);
+    bool in_order = true;
+    for (auto it = mgr.oldest_iterator(); it != mgr.newest_iterator(); ++it) {
+      auto const &s = (**it)();
+      in_order = in_order && s.seq > last[(std::size_t) s.producer];
+      last[(std::size_t) s.producer] = s.seq;
+    }
+    expect(in_order, "the commands of a producer are applied in order");
+  }
+
+  static void test_manual_drain() {
+    using namespace dp::undo::test;
+    using State = mpsc_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+
+    M mgr;
+    undo_cxx::cmd_queue_t<M> q{mgr, false};
+    auto c = q.submit<SeqCmd<State>>(0, 1);
+    q.post(std::make_shared<SeqCmd<State>>(0, 2));
+    expect(!c.done() && mgr.size() == 0, "nothing is applied before drain()");
+    expect(q.drain() == 2 && c.done() && mgr.size() == 2, "drain() applies them on this thread");
+    expect(undo_cxx::completion_t{}.done(), "an empty handle is done");
+  }
+} // namespace
+
+int main() {
+  test_mpsc_queue();
+  test_cmd_queue();
+  test_manual_drain();
+  return failed;
+}
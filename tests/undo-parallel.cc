@@ -0,0 +1,214 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace dp { namespace undo { namespace test {
+
+  using cells_t = std::vector<int>;
+
+  // a cell edit: the value before and after
+  struct cell_state {
+    int before;
+    int after;
+    friend std::ostream &operator<<(std::ostream &os, cell_state const &o) { return os << o.after; }
+  };
+
+  // cells[to] = cells[from] + delta
+  template<typename State>
+  class AddCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~AddCmd() {}
+    AddCmd(cells_t *cells, std::size_t from, std::size_t to, int delta)
+        : _cells(cells)
+        , _from(from)
+        , _to(to)
+        , _delta(delta) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(AddCmd, undo_cxx::cmd_t);
+
+    void footprint(undo_cxx::footprint_t &fp) const {
+      fp.read(_from);
+      fp.write(_to);
+    }
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      _before = (*_cells)[_to];
+      _after = (*_cells)[_from] + _delta;
+      (*_cells)[_to] = _after;
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_before, _after});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &memento) override { (*_cells)[_to] = memento().before; }
+    void redo_impl(CmdSP &, ContextT &, Memento &memento) override { (*_cells)[_to] = memento().after; }
+
+  private:
+    cells_t *_cells;
+    std::size_t _from, _to;
+    int _delta;
+    int _before{}, _after{};
+  };
+
+  // doubles every cell, with no footprint
+  template<typename State>
+  class DoubleCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~DoubleCmd() {}
+    DoubleCmd(cells_t *cells)
+        : _cells(cells) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(DoubleCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      for (auto &c : *_cells)
+        c *= 2;
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {
+      for (auto &c : *_cells)
+        c /= 2;
+    }
+    void redo_impl(CmdSP &sender, ContextT &ctx, Memento &) override { do_execute(sender, ctx); }
+
+  private:
+    cells_t *_cells;
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::cell_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = cell_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using Parallel = undo_cxx::parallel_composite_cmd_t<State>;
+  using Composite = undo_cxx::composite_cmd_t<State>;
+  using Add = AddCmd<State>;
+  using Double = DoubleCmd<State>;
+
+  static void test_pool() {
+    undo_cxx::util::stealing_pool_t pool{4};
+    std::vector<int> v(10000);
+    pool.parallel_for(v.size(), [&](std::size_t i) { v[i] = (int) i; });
+    expect(std::accumulate(v.begin(), v.end(), 0L) == 49995000L, "parallel_for() covers the range");
+
+    std::atomic<int> runs{0};
+    try {
+      pool.parallel_for(100, [&](std::size_t i) {
+        runs++;
+        if (i == 42)
+          throw std::runtime_error("42");
+      });
+      expect(false, "the exception is rethrown");
+    } catch (std::runtime_error const &) {
+    }
+    expect(runs >= 1, "the others run");
+  }
+
+  // 1000 independent cells, then a chain on cell 0, and a barrier
+  static std::shared_ptr<Parallel> make(cells_t &cells, undo_cxx::util::stealing_pool_t *pool) {
+    auto c = std::make_shared<Parallel>(pool);
+    for (std::size_t i = 1; i < cells.size(); i++)
+      c->add_command(std::make_shared<Add>(&cells, i, i, 1));
+    c->add_command(std::make_shared<Add>(&cells, 1, 0, 10)); // after cell 1 is written
+    c->add_command(std::make_shared<Add>(&cells, 0, 0, 1));  // after cell 0 is written
+    c->add_command(std::make_shared<Double>(&cells));
+    c->add_command(std::make_shared<Add>(&cells, 2, 1, 0)); // after the barrier
+    return c;
+  }
+
+  static void test_waves() {
+    cells_t cells(1001);
+    auto c = make(cells, nullptr);
+    expect(c->size() == 1004 && c->waves() == 5, "the waves");
+    expect(c->wave_of(0) == 0 && c->wave_of(999) == 0 && c->wave_of(1000) == 1 && c->wave_of(1001) == 2, "a chain of dependencies");
+    expect(c->wave_of(1002) == 3 && c->wave_of(1003) == 4, "the barrier");
+  }
+
+  static void test_parallel() {
+    cells_t serial(1001), parallel(1001);
+    std::iota(serial.begin(), serial.end(), 0);
+    std::iota(parallel.begin(), parallel.end(), 0);
+    auto original = serial;
+
+    undo_cxx::util::stealing_pool_t pool{4};
+    M ms, mp;
+    M::CmdSP s = make(serial, nullptr), p = make(parallel, &pool);
+    ms.invoke(s);
+    mp.invoke(p);
+    expect(parallel == serial && serial[0] == 2 * 13 && serial[1] == 2 * 3 + 0, "the same result");
+
+    auto &a = *ms.newest_item();
+    auto &b = *mp.newest_item();
+    bool same = a.size() == b.size();
+    for (std::size_t i = 1; same && i < a.size(); i++)
+      same = a.at(i).second.before == b.at(i).second.before && a.at(i).second.after == b.at(i).second.after;
+    expect(same && b.size() == 1005, "the same memento, a slot per child in order");
+
+    M::ContextT ctx{mp};
+    p->undo(p, ctx, b);
+    expect(parallel == original, "undo backward, wave by wave");
+    p->redo(p, ctx, b);
+    expect(parallel == serial, "redo");
+  }
+
+  // a nested composite child: its pairs are spliced into the slot of the child
+  static void test_nested(undo_cxx::util::stealing_pool_t *pool) {
+    cells_t cells(4);
+    auto inner = std::make_shared<Composite>();
+    inner->add_command(std::make_shared<Add>(&cells, 1, 1, 5));
+    inner->add_command(std::make_shared<Add>(&cells, 2, 2, 7));
+    auto p = std::make_shared<Parallel>(pool);
+    p->add_command(inner);
+    p->add_command(std::make_shared<Add>(&cells, 3, 3, 9));
+    p->add_command(std::make_shared<Add>(&cells, 1, 0, 1)); // reads cell 1
+
+    M mgr;
+    M::CmdSP cmd = p;
+    mgr.invoke(cmd);
+    expect(cells == cells_t{6, 5, 7, 9}, "the nested composite runs");
+    auto &memento = *mgr.newest_item();
+    expect(memento.size() == 5, "a pair per leaf");
+
+    M::ContextT ctx{mgr};
+    cmd->undo(cmd, ctx, memento);
+    expect(cells == cells_t{0, 0, 0, 0}, "undo restores the cells of the nested composite");
+    cmd->redo(cmd, ctx, memento);
+    expect(cells == cells_t{6, 5, 7, 9}, "redo");
+  }
+} // namespace
+
+int main() {
+  test_pool();
+  test_waves();
+  test_parallel();
+  test_nested(nullptr);
+  {
+    undo_cxx::util::stealing_pool_t pool{4};
+    test_nested(&pool);
+  }
+  return failed;
+}
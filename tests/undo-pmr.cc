@@ -0,0 +1,141 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/6.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+static std::size_t global_news = 0;
+
+void *operator new(std::size_t n) {
+  ++global_news;
+  if (void *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace dp { namespace undo { namespace test {
+
+  struct pmr_state {
+    int value;
+    friend std::ostream &operator<<(std::ostream &os, pmr_state const &o) { return os << o.value; }
+  };
+
+  template<typename State>
+  class ValueCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~ValueCmd() {}
+    ValueCmd() {}
+    ValueCmd(int value)
+        : _value(value) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(ValueCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_value});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    int _value{};
+  };
+
+  // counts the bytes held by the arena
+  class counting_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t in_use{};
+    std::size_t calls{};
+
+  private:
+    void *do_allocate(std::size_t n, std::size_t align) override {
+      in_use += n;
+      calls++;
+      return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+    void do_deallocate(void *p, std::size_t n, std::size_t align) override {
+      in_use -= n;
+      std::pmr::new_delete_resource()->deallocate(p, n, align);
+    }
+    bool do_is_equal(std::pmr::memory_resource const &o) const noexcept override { return this == &o; }
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::pmr_state> : undo_cxx::pmr_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+};
+
+namespace {
+  static void test_arena() {
+    using namespace dp::undo::test;
+    using State = pmr_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using ValueCmdT = ValueCmd<State>;
+
+    counting_resource upstream;
+    {
+      M mgr{&upstream};
+      expect(mgr.resource() != nullptr, "the manager owns an arena");
+
+      auto news = global_news;
+      for (int i = 0; i < 1000; i++)
+        mgr.invoke<ValueCmdT>(i);
+      expect(global_news == news, "no global allocation while invoking");
+      expect(upstream.in_use > 0, "the arena is used");
+      expect(upstream.calls < 100, "the arena allocates in chunks");
+
+      mgr.undo_to(10);
+      news = global_news;
+      mgr.invoke<ValueCmdT>(-1);
+      expect(global_news == news, "discarding the redo tail returns to the arena");
+      expect(mgr.size() == 11 && (*mgr.newest_item())().value == -1, "the history is intact");
+
+      auto held = mgr.newest_item()->command();
+      auto in_use = upstream.in_use;
+      mgr.clear();
+      expect(dynamic_cast<ValueCmdT *>(held.get()) != nullptr && held.use_count() == 1, "clear() frees what the manager owns only");
+      held.reset();
+      for (int i = 0; i < 100; i++)
+        mgr.invoke<ValueCmdT>(i);
+      expect(mgr.size() == 100 && upstream.in_use == in_use, "clear() returns the memory to the arena");
+    }
+    expect(upstream.in_use == 0, "the arena is released with the manager");
+  }
+
+  static void test_default_resource() {
+    using namespace dp::undo::test;
+    using M = undo_cxx::undoable_cmd_system_t<pmr_state>;
+    M mgr;
+    expect(mgr.resource() == nullptr, "no arena by default");
+    using Plain = undo_cxx::state_t<int>;
+    using Routed = undo_cxx::state_t<pmr_state>;
+    expect(Routed{}.memory_usage() > sizeof(Routed) && Plain{}.memory_usage() == sizeof(Plain), "a header only if the mementos are in the arena");
+    mgr.invoke<ValueCmd<pmr_state>>(1);
+    expect(undo_cxx::memento_resource() == std::pmr::get_default_resource(), "the scope is restored");
+  }
+} // namespace
+
+int main() {
+  test_arena();
+  test_default_resource();
+  return failed;
+}
@@ -0,0 +1,228 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  using sheet_t = std::map<std::uint64_t, int>;
+
+  // a cell edit: the cell, and its value before and after
+  struct cell_state {
+    std::uint64_t cell;
+    int before;
+    int after;
+    friend std::ostream &operator<<(std::ostream &os, cell_state const &o) { return os << o.cell << '=' << o.after; }
+  };
+
+  // sets a cell, with no footprint
+  template<typename State>
+  class CellCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~CellCmd() {}
+    CellCmd(sheet_t *sheet, std::uint64_t cell, int value)
+        : _sheet(sheet)
+        , _cell(cell)
+        , _value(value) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(CellCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {
+      _before = (*_sheet)[_cell];
+      (*_sheet)[_cell] = _value;
+    }
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_cell, _before, _value});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &memento) override { (*_sheet)[memento().cell] = memento().before; }
+    void redo_impl(CmdSP &, ContextT &, Memento &memento) override { (*_sheet)[memento().cell] = memento().after; }
+
+  protected:
+    sheet_t *_sheet;
+    std::uint64_t _cell;
+    int _value;
+    int _before{};
+  };
+
+  template<typename State>
+  class SetCmd : public CellCmd<State> {
+  public:
+    using CellCmd<State>::CellCmd;
+    void footprint(undo_cxx::footprint_t &fp) const { fp.write(this->_cell); }
+  };
+
+  // to = from
+  template<typename State>
+  class CopyCmd : public CellCmd<State> {
+  public:
+    CopyCmd(sheet_t *sheet, std::uint64_t from, std::uint64_t to)
+        : CellCmd<State>(sheet, to, (*sheet)[from])
+        , _from(from) {}
+
+    void footprint(undo_cxx::footprint_t &fp) const {
+      fp.read(_from);
+      fp.write(this->_cell);
+    }
+
+  private:
+    std::uint64_t _from;
+  };
+
+}}} // namespace dp::undo::test
+
+// no padding and no pointers, its bytes can be journaled
+template<>
+struct undo_cxx::is_journal_pod<dp::undo::test::cell_state> : std::true_type {};
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::cell_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+  static constexpr bool journal = true;
+  static constexpr bool tree = true;
+  static constexpr bool selective = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = cell_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+
+  enum : std::uint64_t { A = 1, B, C };
+
+  struct fixture {
+    M mgr;
+    sheet_t sheet;
+
+    M::Iterator set(std::uint64_t cell, int value) {
+      mgr.invoke<SetCmd<State>>(&sheet, cell, value);
+      return std::prev(mgr.newest_iterator());
+    }
+    M::Iterator copy(std::uint64_t from, std::uint64_t to) {
+      mgr.invoke<CopyCmd<State>>(&sheet, from, to);
+      return std::prev(mgr.newest_iterator());
+    }
+    M::Iterator opaque(std::uint64_t cell, int value) {
+      mgr.invoke<CellCmd<State>>(&sheet, cell, value);
+      return std::prev(mgr.newest_iterator());
+    }
+    void undo() {
+      M::CmdSP cmd = std::make_shared<SetCmd<State>>(&sheet, 0, 0);
+      mgr.undo(cmd);
+    }
+  };
+
+  static void test_independent() {
+    fixture f;
+    auto a = f.set(A, 1);
+    f.set(B, 2);
+    f.set(C, 3);
+    expect(f.mgr.undo_entry(a), "A is independent");
+    expect(f.sheet[A] == 0 && f.sheet[B] == 2 && f.sheet[C] == 3, "only A is reverted");
+    expect(f.mgr.size() == 2 && f.mgr.position() == 2, "its entry is removed");
+    expect(!f.mgr.can_undo_entry(f.mgr.newest_iterator()), "end() isn't an entry");
+  }
+
+  static void test_dependent() {
+    fixture f;
+    auto a = f.set(A, 1);
+    auto copy = f.copy(A, B);
+    expect(!f.mgr.undo_entry(a), "B reads A");
+    expect(f.mgr.undo_entry(copy) && f.sheet[B] == 0 && f.sheet[A] == 1, "the copy is independent");
+    expect(f.mgr.undo_entry(a) && f.sheet[A] == 0, "A is free now");
+
+    auto a1 = f.set(A, 1);
+    auto a2 = f.set(A, 2);
+    expect(!f.mgr.undo_entry(a1), "a later write of A");
+    f.undo();
+    expect(!f.mgr.can_undo_entry(a1), "the redo tail counts");
+    expect(!f.mgr.can_undo_entry(a2), "an undone entry can't be");
+  }
+
+  static void test_opaque() {
+    fixture f;
+    auto a = f.opaque(A, 1);
+    auto b = f.opaque(B, 2);
+    expect(!f.mgr.can_undo_entry(a), "no index: only the newest one");
+    expect(f.mgr.undo_entry(b) && f.sheet[B] == 0, "the newest one, like undo()");
+
+    auto c = f.set(C, 3);
+    auto d = f.opaque(B, 4);
+    expect(!f.mgr.can_undo_entry(c) && !f.mgr.can_undo_entry(a), "an opaque entry depends on all the earlier ones");
+    expect(f.mgr.undo_entry(d), "an opaque newest entry");
+    expect(f.mgr.undo_entry(c) && f.sheet[C] == 0, "C is independent");
+  }
+
+  static void test_hot_key() {
+    fixture f;
+    f.mgr.max_size(8);
+    for (int i = 1; i <= 100; i++)
+      f.set(A, i);
+    auto b = f.set(B, 1);
+    auto a = f.set(A, 101);
+    expect(f.mgr.size() == 8, "the history is capped");
+    expect(!f.mgr.can_undo_entry(f.mgr.oldest_iterator()), "a later write of A, after the evictions");
+    expect(f.mgr.undo_entry(b) && f.mgr.undo_entry(a), "B, then the newest A");
+    expect(f.sheet[A] == 100 && f.sheet[B] == 0, "reverted");
+    expect(f.mgr.can_undo_entry(std::prev(f.mgr.newest_iterator())), "the newest A left");
+  }
+
+  static void test_tree() {
+    fixture f;
+    f.mgr.tree_mode(true);
+    auto a1 = f.set(A, 1);
+    f.set(A, 2);
+    f.undo();
+    f.set(B, 3);
+    expect(f.mgr.can_undo_entry(a1), "the other branches don't count");
+    f.undo();
+    f.mgr.switch_branch(0);
+    expect(!f.mgr.can_undo_entry(a1), "unless they're switched in");
+    f.mgr.switch_branch(1);
+    expect(f.mgr.undo_entry(a1) && f.mgr.tree()->size() == 1, "the branches off it are dropped");
+  }
+
+  static void test_journal() {
+    auto path = std::filesystem::temp_directory_path() / "undo-cxx-selective.journal";
+    std::filesystem::remove(path);
+    {
+      fixture f;
+      undo_cxx::journal_t<State> j{path};
+      f.mgr.journal(&j);
+      auto a = f.set(A, 1);
+      f.set(B, 2);
+      f.set(C, 3);
+      f.undo();
+      f.mgr.undo_entry(a);
+    }
+    undo_cxx::journal_t<State> j{path};
+    M mgr;
+    mgr.replay(j);
+    expect(mgr.size() == 2 && mgr.position() == 1 && (*mgr.focused_item())().cell == C, "the removal is replayed");
+    std::filesystem::remove(path);
+  }
+} // namespace
+
+int main() {
+  test_independent();
+  test_dependent();
+  test_opaque();
+  test_hot_key();
+  test_tree();
+  test_journal();
+  return failed;
+}
@@ -0,0 +1,142 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace dp { namespace undo { namespace test {
+
+  struct doc_state {
+    std::size_t size;
+    friend std::ostream &operator<<(std::ostream &os, doc_state const &o) { return os << o.size << " bytes"; }
+  };
+
+  template<typename State>
+  class EditCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~EditCmd() {}
+    EditCmd() {}
+    EditCmd(std::size_t size)
+        : _size(size) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(EditCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_size});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::size_t _size{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::doc_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+  static std::size_t memory_usage(dp::undo::test::doc_state const &s) { return s.size; }
+  static constexpr bool shared_pool = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = doc_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using Edit = EditCmd<State>;
+
+  static void edit(M &doc, int n, std::size_t size = 100) {
+    for (int i = 0; i < n; i++)
+      doc.invoke<Edit>(size);
+  }
+
+  // the footprint of a memento of size bytes
+  static std::size_t footprint(std::size_t size = 100) {
+    M doc;
+    edit(doc, 1, size);
+    return doc.memory_usage();
+  }
+
+  static void test_budget() {
+    auto u = footprint(), h = footprint(5000);
+    undo_cxx::history_pool_t pool{10 * u};
+    M a{pool}, b{pool};
+    expect(a.resource() == pool.resource() && a.pool() == &pool, "the shared allocator");
+    edit(a, 4);
+    edit(b, 4);
+    auto c = pool.counters();
+    expect(c.documents == 2 && c.bytes == 8 * u, "the usage of both documents");
+    expect(a.pool_counters().bytes == 4 * u && b.pool_counters().bytes == 4 * u, "the usage of each document");
+
+    edit(b, 3);
+    expect(pool.counters().bytes == 10 * u && b.size() == 7, "b is the most recently active one");
+    expect(a.size() == 3 && a.pool_counters().reclaimed == u, "the least recently active one is evicted first");
+    expect(a.counters().evicted == 1, "the manager counts the evictions too");
+
+    edit(a, 1);
+    expect(a.size() == 4 && b.size() == 6 && pool.counters().bytes == 10 * u, "then b, with a most recently active");
+
+    edit(a, 1, 5000);
+    expect(b.size() == 1 && a.size() == 1 && pool.counters().bytes == h + u, "a huge one is kept alone, and the newest one of b");
+    expect(pool.counters().reclaimed == 11 * u, "reclaimed in total");
+
+    pool.max_bytes(100 * h);
+    edit(b, 3);
+    {
+      M c3{pool};
+      edit(c3, 2);
+      expect(pool.counters().documents == 3 && pool.counters().bytes == h + 6 * u, "a third one");
+    }
+    expect(pool.counters().documents == 2 && pool.counters().bytes == h + 4 * u, "detached on destruction");
+    b.clear();
+    expect(pool.counters().bytes == h, "clear() is reported");
+  }
+
+  // a document in use by another thread isn't evicted
+  static void test_busy() {
+    undo_cxx::history_pool_t pool{10 * footprint()};
+    M a{pool}, b{pool};
+    edit(a, 5);
+    std::promise<void> locked, done;
+    std::thread t([&] {
+      auto lk = a.pool_guard();
+      locked.set_value();
+      done.get_future().wait();
+    });
+    locked.get_future().wait();
+    {
+      auto lk = b.pool_guard();
+      edit(b, 7);
+    }
+    expect(a.size() == 5 && b.size() == 5, "a is skipped, b evicts its own");
+    done.set_value();
+    t.join();
+    {
+      auto lk = b.pool_guard();
+      edit(b, 1);
+    }
+    expect(a.size() == 4 && b.size() == 6, "a is evicted once it's free");
+  }
+} // namespace
+
+int main() {
+  test_budget();
+  test_busy();
+  return failed;
+}
@@ -0,0 +1,170 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/12.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dp { namespace undo { namespace test {
+
+  struct spill_state {
+    std::string text;
+
+    void serialize(std::string &out) const { out += text; }
+    bool deserialize(std::string_view in) {
+      text.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, spill_state const &o) { return os << o.text; }
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::spill_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::null_tracer_t;
+  static constexpr bool spill = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = spill_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using F = undo_cxx::spill_file_t;
+
+  static void fill(M &mgr, int n) {
+    for (int i = 0; i < n; i++)
+      mgr.invoke<TextCmd<State>>("s" + std::to_string(i));
+  }
+
+  static void test_spill() {
+    F file;
+    M mgr;
+    mgr.spill(&file, undo_cxx::spill_options_t{4, 0});
+    fill(mgr, 20);
+    expect(mgr.spilled() == 15 && file.size() == 15, "the cold mementos are spilled in batches");
+    expect((**mgr.oldest_iterator())().text.empty(), "the states of a spilled memento are dropped");
+    expect((*mgr.newest_item())().text == "s19", "the hot tail stays live");
+
+    auto r = mgr.undo_to(2);
+    expect(r.size() == 18 && (*r.front())().text == "s2" && (*r.back())().text == "s19", "undo_to() pages its range in");
+    expect(mgr.spilled() == 2, "the others stay in the file");
+    M::CmdSP cmd = std::make_shared<TextCmd<State>>("undo");
+    mgr.undo(cmd);
+    expect((*mgr.focused_item())().text == "s1", "undo() pages the memento it reaches in");
+
+    mgr.invoke<TextCmd<State>>("x");
+    expect(mgr.size() == 2 && file.size() == 1, "the dropped redo branch is released from the file");
+    fill(mgr, 10);
+    expect(mgr.size() == 12 && mgr.spilled() == 6 && file.size() == 6, "the history goes on");
+    mgr.undo_to(0);
+    expect((*mgr.focused_item())().text == "s0", "the oldest one is read back");
+
+    mgr.clear();
+    expect(mgr.spilled() == 0 && file.size() == 0 && file.bytes() == 0, "clear() releases the file");
+  }
+
+  static void test_repage_and_detach() {
+    F file;
+    M mgr;
+    mgr.spill(&file, undo_cxx::spill_options_t{2, 0});
+    fill(mgr, 10);
+    auto written = file.bytes();
+    M::CmdSP cmd = std::make_shared<TextCmd<State>>("undo");
+    mgr.undo(cmd, 9);
+    expect((*mgr.focused_item())().text == "s1", "deep undo");
+    mgr.redo(cmd, 9);
+    expect(mgr.spilled() == 1, "s1..s5 are paged in");
+    mgr.invoke<TextCmd<State>>("a");
+    expect(mgr.spilled() == 7 && file.bytes() == written + 3 * 6, "the paged-in ones are dropped again without writing");
+    mgr.invoke<TextCmd<State>>("b");
+
+    mgr.spill(nullptr);
+    expect(file.size() == 0 && mgr.spilled() == 0, "detached");
+    std::string all;
+    for (auto it = mgr.oldest_iterator(); it != mgr.newest_iterator(); ++it)
+      all += (**it)().text;
+    expect(all == "s0s1s2s3s4s5s6s7s8s9ab", "every state is read back on detaching");
+  }
+
+  static void test_min_bytes() {
+    F file;
+    M mgr;
+    mgr.spill(&file, undo_cxx::spill_options_t{1, 1 << 20});
+    fill(mgr, 10);
+    expect(mgr.spilled() == 0, "the small mementos stay live");
+  }
+
+  static void test_reuse() {
+    F file;
+    auto a = file.put("aaaa"), b = file.put("bbbbbbbb"), c = file.put("cc"), d = file.put("dddd");
+    file.release(b);
+    auto e = file.put("eee");
+    expect(e.offset == b.offset && file.bytes() == 18, "a hole is reused before growing the file");
+    file.release(c);
+    expect(file.holes() == 1, "the free neighbours are coalesced");
+    auto f = file.put("ffffff");
+    expect(f.offset == e.offset + 3 && file.bytes() == 18, "the coalesced hole takes a bigger one");
+    std::string out;
+    file.get(a, out);
+    expect(out == "aaaa", "the others stay in place");
+    file.get(f, out);
+    expect(out == "ffffff", "the reused extent is read back");
+    file.release(d);
+    expect(file.bytes() == 13 && file.holes() == 0, "the free tail is given back");
+
+    // a long session: the file stays around the size of its live mementos
+    std::vector<F::ticket_t> live{a, e, f};
+    for (int i = 0; i < 1000; i++) {
+      live.push_back(file.put(std::string(std::size_t(8 + i % 13), 'x')));
+      if (live.size() > 16) {
+        file.release(live[std::size_t(i * 7) % live.size()]);
+        live.erase(live.begin() + std::ptrdiff_t(std::size_t(i * 7) % live.size()));
+      }
+    }
+    expect(file.bytes() <= 3 * file.live_bytes(), "the file doesn't grow without bound");
+    for (auto const &t : live)
+      file.release(t);
+    expect(file.bytes() == 0 && file.holes() == 0, "all released");
+  }
+} // namespace
+
+int main() {
+  test_spill();
+  test_repage_and_detach();
+  test_min_bytes();
+  test_reuse();
+  return failed;
+}
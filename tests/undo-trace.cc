@@ -0,0 +1,105 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/2.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  struct traced_state {
+    std::string text;
+    friend std::ostream &operator<<(std::ostream &os, traced_state const &o) {
+      ++formatted;
+      return os << o.text;
+    }
+    static inline int formatted{0};
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::traced_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<4>;
+};
+
+namespace {
+  static void test_null_tracer() {
+    static_assert(!undo_cxx::trace::null_tracer_t::enabled);
+    static_assert(std::is_empty_v<undo_cxx::trace::null_tracer_t>);
+  }
+
+  static void test_ring_tracer() {
+    using namespace dp::undo::test;
+    using State = traced_state;
+    using M = undo_cxx::undoable_cmd_system_t<State>;
+    using TextCmdT = TextCmd<State>;
+
+    M mgr;
+    mgr.invoke<TextCmdT>("a");
+    mgr.invoke<TextCmdT>("b");
+    mgr.invoke<TextCmdT>("c");
+    expect(State::formatted == 0, "recording must not format the memento");
+    expect(mgr.tracer().size() == 3, "3 events recorded");
+
+    M::CmdSP undo_cmd = std::make_shared<TextCmdT>("undo");
+    mgr.undo(undo_cmd);
+    mgr.undo(undo_cmd);
+    mgr.redo(undo_cmd);
+    expect(mgr.tracer().size() == 4, "ring buffer keeps the last 4 events");
+    expect(mgr.tracer().count() == 6, "6 events recorded in total");
+    expect(mgr.tracer()[3].event == undo_cxx::trace::event_t::replay, "the last event is a replay");
+
+    // "c" will be discarded from the redo branch
+    mgr.invoke<TextCmdT>("d");
+    expect(State::formatted == 0, "discarding must not format the memento");
+
+    std::ostringstream os;
+    os << mgr.tracer();
+    std::cout << os.str();
+    expect(os.str().find("(released)") != std::string::npos, "the discarded memento is released");
+    expect(os.str().find(": d, size=3") != std::string::npos, "the newest memento is formatted");
+    expect(State::formatted > 0, "reading formats the memento");
+
+    mgr.clear();
+    expect(mgr.tracer()[3].released(), "clear() releases all mementos");
+  }
+} // namespace
+
+int main() {
+  test_null_tracer();
+  test_ring_tracer();
+  return failed;
+}
@@ -0,0 +1,232 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+namespace dp { namespace undo { namespace test {
+
+  struct tree_state {
+    std::string text;
+
+    void serialize(std::string &out) const { out += text; }
+    bool deserialize(std::string_view in) {
+      text.assign(in);
+      return true;
+    }
+    friend std::ostream &operator<<(std::ostream &os, tree_state const &o) { return os << o.text; }
+  };
+
+  template<typename State>
+  class TextCmd : public undo_cxx::cmd_t<State> {
+  public:
+    ~TextCmd() {}
+    TextCmd(std::string const &text)
+        : _text(text) {}
+    UNDO_CXX_DEFINE_DEFAULT_CMD_TYPES(TextCmd, undo_cxx::cmd_t);
+
+  protected:
+    void do_execute(CmdSP &, ContextT &) override {}
+    MementoPtr save_state_impl(CmdSP &sender, ContextT &) override {
+      return std::make_unique<Memento>(sender, State{_text});
+    }
+    void undo_impl(CmdSP &, ContextT &, Memento &) override {}
+    void redo_impl(CmdSP &, ContextT &, Memento &) override {}
+
+  private:
+    std::string _text{};
+  };
+
+}}} // namespace dp::undo::test
+
+template<>
+struct undo_cxx::history_traits_t<dp::undo::test::tree_state> : undo_cxx::default_history_traits_t {
+  using tracer = undo_cxx::trace::ring_tracer_t<16>;
+  static constexpr bool journal = true;
+  static constexpr bool tree = true;
+};
+
+namespace {
+  using namespace dp::undo::test;
+  using State = tree_state;
+  using M = undo_cxx::undoable_cmd_system_t<State>;
+  using T = M::tree_type;
+
+  static std::string join(M &mgr) {
+    std::string s;
+    for (auto it = mgr.oldest_iterator(); it != mgr.newest_iterator(); ++it)
+      s += (**it)().text + "|";
+    return s;
+  }
+
+  static void type(M &mgr, std::string const &words) {
+    for (char c : words)
+      mgr.invoke<TextCmd<State>>(std::string(1, c));
+  }
+
+  static std::string text_of(M &mgr, M::node_id n) {
+    return (*mgr.tree()->memento(n))().text;
+  }
+
+  static void undo(M &mgr, int n = 1) {
+    M::CmdSP cmd = std::make_shared<TextCmd<State>>("undo");
+    mgr.undo(cmd, n);
+  }
+
+  static void test_branch() {
+    M mgr;
+    mgr.tree_mode(true);
+    type(mgr, "ab");
+    undo(mgr);
+    type(mgr, "c");
+    expect(join(mgr) == "a|c|", "a new command starts a branch");
+    expect(mgr.tree()->size() == 3, "the redo tail is kept");
+    auto c = mgr.current_node();
+    expect(text_of(mgr, c) == "c", "current_node() is the newest one");
+
+    undo(mgr);
+    expect(mgr.branch_count() == 2, "two branches at a");
+    expect(mgr.switch_branch(0) && join(mgr) == "a|b|" && mgr.position() == 1, "switched to b");
+    expect(mgr.tracer()[mgr.tracer().size() - 1].event == undo_cxx::trace::event_t::branch, "traced as branch");
+    expect(!mgr.switch_branch(2), "no such branch");
+    M::CmdSP cmd = std::make_shared<TextCmd<State>>("redo");
+    mgr.redo(cmd);
+    expect(mgr.position() == 2 && (*mgr.newest_item())().text == "b", "redo takes the branch");
+    expect(mgr.memory_usage() == 3 * mgr.newest_item()->memory_usage(), "the branches are counted");
+
+    mgr.tree_mode(false);
+    expect(join(mgr) == "a|b|" && mgr.memory_usage() == 2 * mgr.newest_item()->memory_usage(), "turned off, the branches are dropped");
+  }
+
+  static void test_goto() {
+    M mgr;
+    mgr.tree_mode(true);
+    type(mgr, "abc");
+    auto c = mgr.current_node();
+    undo(mgr, 2);
+    type(mgr, "de");
+    expect(join(mgr) == "a|d|e|", "a branch off a");
+
+    expect(mgr.goto_node(c) && join(mgr) == "a|b|c|" && mgr.position() == 3, "goto c");
+    auto a = mgr.tree()->parent(mgr.tree()->parent(c));
+    expect(mgr.goto_node(a) && join(mgr) == "a|b|c|" && mgr.position() == 1, "goto a, on the active path");
+    expect(mgr.switch_branch(1) && join(mgr) == "a|d|e|", "the last visited children are followed");
+    expect(mgr.goto_node(T::root) && mgr.position() == 0, "goto the root");
+    expect(!mgr.goto_node(42), "no such node");
+
+    // a branch off b, then back to e by the lowest common ancestor a
+    mgr.goto_node(mgr.tree()->parent(c));
+    type(mgr, "f");
+    auto e = mgr.tree()->child(mgr.tree()->child(a, 1), 0);
+    expect(text_of(mgr, e) == "e" && mgr.goto_node(e) && join(mgr) == "a|d|e|", "goto e");
+    mgr.goto_node(a);
+    mgr.switch_branch(0);
+    expect(join(mgr) == "a|b|f|", "b remembers f");
+  }
+
+  static void test_prune() {
+    M mgr;
+    mgr.tree_mode(true);
+    type(mgr, "a");
+    for (char ch : std::string("bcde")) {
+      type(mgr, std::string(1, ch));
+      undo(mgr);
+    }
+    expect(mgr.tree()->size() == 5 && mgr.branch_count() == 4, "four branches");
+    mgr.max_nodes(3);
+    auto a = mgr.current_node();
+    expect(mgr.tree()->size() == 3 && mgr.counters().evicted == 2, "two leaves pruned");
+    expect(text_of(mgr, mgr.tree()->child(a, 0)) == "d" && text_of(mgr, mgr.tree()->child(a, 1)) == "e", "the least recently visited ones");
+    auto one = mgr.newest_item()->memory_usage();
+    expect(mgr.memory_usage() == 3 * one, "their bytes are released");
+
+    mgr.max_nodes(SIZE_T_MAX);
+    type(mgr, "f");
+    mgr.max_bytes(3 * one);
+    expect(mgr.tree()->size() == 3 && join(mgr) == "a|f|", "the branches are evicted first by max_bytes()");
+    expect(text_of(mgr, mgr.tree()->child(a, 0)) == "e", "e is kept");
+
+    // evicting a node of the active path drops its branches
+    mgr.max_bytes(SIZE_T_MAX);
+    mgr.max_size(2);
+    type(mgr, "g");
+    expect(join(mgr) == "f|g|" && mgr.tree()->size() == 2, "a and e are gone");
+    expect(mgr.tree()->parent(mgr.tree()->parent(mgr.current_node())) == T::root, "f is a child of the root");
+
+    mgr.clear();
+    expect(mgr.tree()->size() == 0 && mgr.memory_usage() == 0, "cleared");
+  }
+
+  static void test_erase() {
+    M mgr;
+    mgr.tree_mode(true);
+    type(mgr, "abc");
+    undo(mgr, 2);
+    type(mgr, "x");
+    undo(mgr);
+    mgr.erase(1);
+    expect(join(mgr) == "a|" && mgr.tree()->size() == 3, "x is erased");
+    expect(mgr.switch_branch(0) && join(mgr) == "a|b|c|", "b is still there");
+    mgr.erase(1);
+    expect(join(mgr) == "a|c|" && mgr.tree()->parent(mgr.tree()->find(mgr.oldest_iterator()->get())) == T::root, "c takes the place of b");
+    expect(mgr.tree()->parent(mgr.tree()->find(std::next(mgr.oldest_iterator())->get())) == mgr.current_node(), "c is a child of a");
+  }
+
+  static void test_journal() {
+    auto path = std::filesystem::temp_directory_path() / "undo-cxx-tree.journal";
+    std::filesystem::remove(path);
+    {
+      undo_cxx::journal_t<State> j{path};
+      M mgr;
+      mgr.tree_mode(true);
+      mgr.journal(&j);
+      type(mgr, "abc");
+      undo(mgr, 2);
+      type(mgr, "d");
+      undo(mgr);
+      mgr.switch_branch(0);
+    }
+    undo_cxx::journal_t<State> j{path};
+    M mgr;
+    mgr.replay(j);
+    expect(join(mgr) == "a|b|c|" && mgr.position() == 1, "the active path is replayed");
+    std::filesystem::remove(path);
+  }
+
+  static void test_arena() {
+    M mgr{std::pmr::new_delete_resource()};
+    mgr.tree_mode(true);
+    for (int i = 0; i < 100; i++) {
+      type(mgr, "abc");
+      undo(mgr, 2);
+    }
+    expect(mgr.tree()->size() == 300 && mgr.size() == 102, "a bush");
+    mgr.clear();
+    type(mgr, "a");
+    expect(mgr.tree()->size() == 1, "the arena is released");
+  }
+} // namespace
+
+int main() {
+  test_branch();
+  test_goto();
+  test_prune();
+  test_erase();
+  test_journal();
+  test_arena();
+  return failed;
+}
@@ -0,0 +1,165 @@
+// undo_cxx Library
+// Copyright © 2021 Hedzr Yeh.
+//
+// This file is released under the terms of the MIT license.
+// Read /LICENSE for more information.
+
+//
+// Created by Hedzr Yeh on 2021/11/14.
+//
+
+#include "undo_cxx.hh"
+
+#include "test-expect.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t n) {
+  allocations++;
+  if (auto *p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace dp { namespace undo { namespace test {
+
+  // the document is the text, the memento is the text removed
+  struct doc_t {
+    std::string text;
+  };
+  struct edit_state {
+    std::string removed;
+  };
+
+  struct InsertCmd {
+    doc_t *doc;
+    std::size_t pos;
+    char ch;
+
+    template<typename C>
+    void execute(C &) { doc->text.insert(pos, 1, ch); }
+    template<typename C>
+    edit_state save_state(C &) const { return {}; }
+    template<typename C>
+    void undo(C &, edit_state &) { doc->text.erase(pos, 1); }
+    template<typename C>
+    void redo(C &ctx, edit_state &) { execute(ctx); }
+  };
+
+  struct EraseCmd {
+    doc_t *doc;
+    std::size_t pos;
+    std::size_t n;
+
+    template<typename C>
+    void execute(C &) { doc->text.erase(pos, n); }
+    template<typename C>
+    edit_state save_state(C &) const { return {}; }
+    template<typename C>
+    void undo(C &, edit_state &s) { doc->text.insert(pos, s.removed); }
+    template<typename C>
+    void redo(C &, edit_state &s) {
+      s.removed = doc->text.substr(pos, n);
+      doc->text.erase(pos, n);
+    }
+  };
+
+  // erases, and keeps the text removed in its memento
+  struct CutCmd : EraseCmd {
+    std::string removed{};
+
+    template<typename C>
+    void execute(C &ctx) {
+      removed = doc->text.substr(pos, n);
+      EraseCmd::execute(ctx);
+    }
+    template<typename C>
+    edit_state save_state(C &) const { return {removed}; }
+  };
+
+  // not recorded
+  struct SelectCmd {
+    std::size_t *selection;
+    std::size_t pos;
+
+    template<typename C>
+    void execute(C &) { *selection = pos; }
+    template<typename C>
+    edit_state save_state(C &) const { return {}; }
+    template<typename C>
+    void undo(C &, edit_state &) {}
+    template<typename C>
+    void redo(C &, edit_state &) {}
+    bool can_be_memento() const { return false; }
+  };
+
+}}} // namespace dp::undo::test
+
+namespace {
+  using namespace dp::undo::test;
+  using M = undo_cxx::variant_cmd_system_t<edit_state, InsertCmd, CutCmd, SelectCmd>;
+
+  static void type(M &mgr, doc_t &doc, std::string const &s) {
+    for (char c : s)
+      mgr.invoke<InsertCmd>(&doc, doc.text.size(), c);
+  }
+
+  static void test_dispatch() {
+    M mgr;
+    doc_t doc;
+    type(mgr, doc, "hello");
+    mgr.invoke<CutCmd>(EraseCmd{&doc, 1, 3});
+    expect(doc.text == "ho" && mgr.size() == 6, "executed");
+    expect(mgr.at(5).cmd.index() == M::index_of<CutCmd>() && mgr.at(5).state.removed == "ell", "the command and its memento by value");
+
+    std::size_t selection = 0;
+    mgr.invoke<SelectCmd>(&selection, 1u);
+    expect(selection == 1 && mgr.size() == 6, "can_be_memento() is honored");
+
+    expect(mgr.undo() && doc.text == "hello", "undo by the command");
+    expect(mgr.undo_to(2) == 3 && doc.text == "he" && mgr.position() == 2, "undo_to()");
+    expect(mgr.redo_to(6) == 4 && doc.text == "ho", "redo_to()");
+    expect(!mgr.redo() && mgr.undo_to(0) == 6 && doc.text.empty() && !mgr.undo(), "the ends");
+
+    mgr.redo();
+    mgr.invoke(M::CmdT{InsertCmd{&doc, 1, '!'}});
+    expect(doc.text == "h!" && mgr.size() == 2 && !mgr.can_redo(), "invoke(CmdT) discards the redo tail");
+  }
+
+  static void test_bounded() {
+    M mgr;
+    doc_t doc;
+    mgr.max_size(4);
+    type(mgr, doc, "ab");
+    mgr.undo();
+    mgr.max_size(1);
+    expect(mgr.size() == 1 && mgr.position() == 0 && mgr.at(0).cmd.index() == M::index_of<InsertCmd>(), "the oldest one is evicted");
+    mgr.max_size(4);
+    type(mgr, doc, "bcdef");
+    expect(mgr.size() == 4 && mgr.position() == 4 && doc.text == "abcdef", "a full history evicts on invoke");
+
+    doc.text.reserve(256);
+    auto before = allocations;
+    for (int i = 0; i < 100; i++) {
+      type(mgr, doc, "x");
+      mgr.undo();
+      mgr.redo();
+    }
+    expect(allocations == before, "no allocation per command");
+    mgr.clear();
+    expect(mgr.empty() && mgr.position() == 0, "cleared");
+  }
+} // namespace
+
+int main() {
+  test_dispatch();
+  test_bounded();
+  return failed;
+}